@@ -0,0 +1,748 @@
+#include "AssetCook.h"
+#include "CompileCache.h"
+#include "FileSync.h"
+#include "LevelHash.h"
+#include "LevelNumbers.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+    // Part of every cooked file's name; bump it whenever a cook step
+    // changes what it writes for the same source
+    const uint64_t ASSET_COOK_VERSION = 1;
+    const char* const COOK_MANIFEST = ".cook";
+    const char* const KIND_NAMES[] = { "model", "material", "texture", "script", "sound" };
+
+    struct AssetExtension {
+        const char* extension;
+        AssetKind kind;
+    };
+
+    const AssetExtension ASSET_EXTENSIONS[] = {
+        { ".obj", AssetKind::Model },
+        { ".mtl", AssetKind::Material },
+        { ".png", AssetKind::Texture }, { ".jpg", AssetKind::Texture }, { ".jpeg", AssetKind::Texture },
+        { ".tga", AssetKind::Texture }, { ".bmp", AssetKind::Texture }, { ".dds", AssetKind::Texture },
+        { ".lua", AssetKind::Script }, { ".js", AssetKind::Script }, { ".py", AssetKind::Script },
+        { ".wav", AssetKind::Sound }, { ".ogg", AssetKind::Sound }, { ".mp3", AssetKind::Sound }
+    };
+
+    // MTL statements that name a texture; options come first, the file last
+    const char* const TEXTURE_STATEMENTS[] = {
+        "map_Ka", "map_Kd", "map_Ks", "map_Ke", "map_Ns", "map_d", "map_bump", "map_Bump",
+        "bump", "disp", "decal", "refl", "norm", "map_Pr", "map_Pm"
+    };
+
+    std::string ToLower(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    std::string FormatKey(uint64_t key) {
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(key));
+        return text;
+    }
+
+    std::string_view NextToken(std::string_view& line) {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string_view::npos) {
+            line = std::string_view();
+            return std::string_view();
+        }
+        size_t end = line.find_first_of(" \t\r", begin);
+        if (end == std::string_view::npos) {
+            end = line.size();
+        }
+        std::string_view token = line.substr(begin, end - begin);
+        line.remove_prefix(end);
+        return token;
+    }
+
+    // Calls visit(offset, length) for each file name text references: the
+    // material libraries of an .obj, the textures of an .mtl
+    void ForEachReference(AssetKind kind, std::string_view text, const std::function<void(size_t, size_t)>& visit) {
+        size_t lineStart = 0;
+        while (lineStart < text.size()) {
+            size_t lineEnd = text.find('\n', lineStart);
+            if (lineEnd == std::string_view::npos) {
+                lineEnd = text.size();
+            }
+            std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+            std::string_view keyword = NextToken(line);
+            if (kind == AssetKind::Model && keyword == "mtllib") {
+                for (std::string_view name = NextToken(line); !name.empty(); name = NextToken(line)) {
+                    visit(static_cast<size_t>(name.data() - text.data()), name.size());
+                }
+            }
+            else if (kind == AssetKind::Material && std::find(std::begin(TEXTURE_STATEMENTS), std::end(TEXTURE_STATEMENTS), keyword) != std::end(TEXTURE_STATEMENTS)) {
+                std::string_view name;
+                for (std::string_view token = NextToken(line); !token.empty(); token = NextToken(line)) {
+                    name = token;
+                }
+                if (!name.empty()) {
+                    visit(static_cast<size_t>(name.data() - text.data()), name.size());
+                }
+            }
+            lineStart = lineEnd + 1;
+        }
+    }
+
+    // What a kind's references are: fixed per kind and always further down
+    // the chain model -> material -> texture. CookAssets rejects references
+    // to files whose extension names another kind, so the graph has no cycles.
+    AssetKind GetReferencedKind(AssetKind kind) {
+        return kind == AssetKind::Model ? AssetKind::Material : AssetKind::Texture;
+    }
+
+    bool ReadWholeFile(const fs::path& path, std::string& text) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        text = contents.str();
+        return !file.bad();
+    }
+
+    struct ScannedAsset {
+        uint64_t size = 0;
+        int64_t writeTime = 0;
+        uint64_t hash = 0;
+        AssetKind kind = AssetKind::Texture;
+        std::vector<std::string> references;  // resolved, generic form
+    };
+
+    typedef std::map<std::string, ScannedAsset> CookManifest;
+
+    // "S <hash> <size> <write time> <kind> <path>", then one "R <path>"
+    // line per reference
+    CookManifest ReadManifest(const fs::path& path) {
+        CookManifest manifest;
+        std::ifstream file(path);
+        std::string line;
+        ScannedAsset* current = nullptr;
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            std::string tag;
+            fields >> tag;
+            fields.get();
+            if (tag == "S") {
+                ScannedAsset entry;
+                int kind = 0;
+                std::string name;
+                fields >> std::hex >> entry.hash >> std::dec >> entry.size >> entry.writeTime >> kind;
+                fields.get();
+                current = nullptr;
+                if (fields && std::getline(fields, name) && !name.empty() && kind >= 0 && kind <= static_cast<int>(AssetKind::Sound)) {
+                    entry.kind = static_cast<AssetKind>(kind);
+                    current = &(manifest[name] = entry);
+                }
+            }
+            else if (tag == "R" && current) {
+                std::string name;
+                std::getline(fields, name);
+                current->references.push_back(name);
+            }
+        }
+        return manifest;
+    }
+
+    void WriteManifest(const fs::path& path, const CookManifest& manifest) {
+        fs::path tempPath = path;
+        tempPath += ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::out | std::ios::trunc);
+            for (const auto& [name, entry] : manifest) {
+                file << "S " << std::hex << entry.hash << std::dec << " " << entry.size << " " << entry.writeTime << " "
+                    << static_cast<int>(entry.kind) << " " << name << "\n";
+                for (const std::string& reference : entry.references) {
+                    file << "R " << reference << "\n";
+                }
+            }
+            file.close();
+            if (file.fail()) {
+                throw fs::filesystem_error("Failed to write cook manifest", tempPath, std::make_error_code(std::errc::io_error));
+            }
+        }
+        fs::rename(tempPath, path);
+    }
+
+    struct AssetNode {
+        std::string name;  // resolved source path, generic form
+        ScannedAsset scan;
+        bool missing = false;
+        std::string invalidReference;  // reference of the wrong kind, which fails the cook
+        std::vector<size_t> references;  // node of each scan.references entry
+        std::vector<size_t> dependents;
+        size_t waiting = 0;
+        bool failed = false;
+        std::string cookedName;
+    };
+
+    // Stats and size of the file, plus its hash and references unless the
+    // manifest already has them for the same size and write time
+    void ScanAsset(AssetNode& node, const CookManifest& previous) {
+        fs::path path(node.name);
+        std::error_code error;
+        node.scan.size = static_cast<uint64_t>(fs::file_size(path, error));
+        if (!error) {
+            node.scan.writeTime = static_cast<int64_t>(fs::last_write_time(path, error).time_since_epoch().count());
+        }
+        if (error) {
+            node.missing = true;
+            return;
+        }
+
+        auto known = previous.find(node.name);
+        if (known != previous.end() && known->second.kind == node.scan.kind && known->second.size == node.scan.size
+            && known->second.writeTime == node.scan.writeTime) {
+            node.scan.hash = known->second.hash;
+            node.scan.references = known->second.references;
+            return;
+        }
+
+        if (node.scan.kind != AssetKind::Model && node.scan.kind != AssetKind::Material) {
+            node.scan.hash = HashFile(path);
+            return;
+        }
+        std::string text;
+        if (!ReadWholeFile(path, text)) {
+            node.missing = true;
+            return;
+        }
+        node.scan.hash = HashString(text);
+        fs::path directory = path.parent_path();
+        ForEachReference(node.scan.kind, text, [&](size_t offset, size_t length) {
+            node.scan.references.push_back((directory / text.substr(offset, length)).lexically_normal().generic_string());
+        });
+    }
+
+    // Index of an OBJ position, texture coordinate or normal; negative
+    // numbers count back from the last one read
+    bool ResolveIndex(std::string_view text, size_t count, int& index) {
+        int value = 0;
+        std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (result.ec != std::errc() || result.ptr != text.data() + text.size() || value == 0) {
+            return false;
+        }
+        index = value > 0 ? value - 1 : static_cast<int>(count) + value;
+        return index >= 0 && static_cast<size_t>(index) < count;
+    }
+
+    struct VertexKey {
+        int position;
+        int uv;
+        int normal;
+
+        bool operator==(const VertexKey& other) const { return position == other.position && uv == other.uv && normal == other.normal; }
+    };
+
+    struct VertexKeyHash {
+        size_t operator()(const VertexKey& key) const {
+            return static_cast<size_t>(CombineHash(CombineHash(static_cast<uint64_t>(key.position), static_cast<uint64_t>(key.uv)), static_cast<uint64_t>(key.normal)));
+        }
+    };
+
+    template <typename T>
+    void AppendRecords(std::string& out, const T* records, size_t count) {
+        out.append(reinterpret_cast<const char*>(records), count * sizeof(T));
+    }
+
+    uint32_t AppendString(std::string& strings, std::string_view text) {
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.append(text.data(), text.size());
+        return offset;
+    }
+
+    // Wavefront OBJ to a cooked mesh. Faces are fanned into triangles and
+    // each distinct position/uv/normal triple becomes one vertex.
+    bool CookModel(const std::string& text, const std::function<std::string(std::string_view)>& cookedLibrary, std::string& out, std::string& error) {
+        std::vector<Float3> positions;
+        std::vector<Float3> normals;
+        std::vector<std::pair<float, float>> uvs;
+        std::vector<CookedVertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<CookedSubmesh> submeshes;
+        std::vector<CookedString> libraries;
+        std::string strings;
+        std::unordered_map<VertexKey, uint32_t, VertexKeyHash> vertexIds;
+        CookedSubmesh submesh = {};
+        std::vector<uint32_t> face;
+
+        size_t lineNumber = 0;
+        size_t lineStart = 0;
+        while (lineStart < text.size()) {
+            size_t lineEnd = text.find('\n', lineStart);
+            if (lineEnd == std::string::npos) {
+                lineEnd = text.size();
+            }
+            std::string_view line(text.data() + lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+            ++lineNumber;
+
+            std::string_view keyword = NextToken(line);
+            if (keyword == "v" || keyword == "vn" || keyword == "vt") {
+                float values[3] = { 0.0f, 0.0f, 0.0f };
+                int wanted = keyword == "vt" ? 2 : 3;
+                for (int i = 0; i < wanted; ++i) {
+                    if (!ParseFloat(NextToken(line), values[i])) {
+                        error = "bad " + std::string(keyword) + " on line " + std::to_string(lineNumber);
+                        return false;
+                    }
+                }
+                if (keyword == "v") {
+                    positions.push_back({ values[0], values[1], values[2] });
+                }
+                else if (keyword == "vn") {
+                    normals.push_back({ values[0], values[1], values[2] });
+                }
+                else {
+                    uvs.emplace_back(values[0], values[1]);
+                }
+            }
+            else if (keyword == "f") {
+                face.clear();
+                for (std::string_view corner = NextToken(line); !corner.empty(); corner = NextToken(line)) {
+                    // "p", "p/t", "p//n" or "p/t/n"
+                    VertexKey key = { -1, -1, -1 };
+                    size_t slash = corner.find('/');
+                    size_t secondSlash = slash == std::string_view::npos ? std::string_view::npos : corner.find('/', slash + 1);
+                    std::string_view uvText = slash == std::string_view::npos ? std::string_view() : corner.substr(slash + 1, secondSlash - slash - 1);
+                    std::string_view normalText = secondSlash == std::string_view::npos ? std::string_view() : corner.substr(secondSlash + 1);
+                    if (!ResolveIndex(corner.substr(0, slash), positions.size(), key.position)
+                        || (!uvText.empty() && !ResolveIndex(uvText, uvs.size(), key.uv))
+                        || (!normalText.empty() && !ResolveIndex(normalText, normals.size(), key.normal))) {
+                        error = "bad face index on line " + std::to_string(lineNumber);
+                        return false;
+                    }
+
+                    auto found = vertexIds.find(key);
+                    if (found == vertexIds.end()) {
+                        CookedVertex vertex = {};
+                        const Float3& position = positions[key.position];
+                        vertex.position[0] = position.x;
+                        vertex.position[1] = position.y;
+                        vertex.position[2] = position.z;
+                        if (key.normal >= 0) {
+                            vertex.normal[0] = normals[key.normal].x;
+                            vertex.normal[1] = normals[key.normal].y;
+                            vertex.normal[2] = normals[key.normal].z;
+                        }
+                        if (key.uv >= 0) {
+                            vertex.uv[0] = uvs[key.uv].first;
+                            vertex.uv[1] = uvs[key.uv].second;
+                        }
+                        found = vertexIds.emplace(key, static_cast<uint32_t>(vertices.size())).first;
+                        vertices.push_back(vertex);
+                    }
+                    face.push_back(found->second);
+                }
+                if (face.size() < 3) {
+                    error = "face with fewer than 3 corners on line " + std::to_string(lineNumber);
+                    return false;
+                }
+                for (size_t i = 1; i + 1 < face.size(); ++i) {
+                    indices.push_back(face[0]);
+                    indices.push_back(face[i]);
+                    indices.push_back(face[i + 1]);
+                }
+            }
+            else if (keyword == "usemtl") {
+                submesh.indexCount = static_cast<uint32_t>(indices.size()) - submesh.firstIndex;
+                if (submesh.indexCount > 0) {
+                    submeshes.push_back(submesh);
+                }
+                std::string_view material = NextToken(line);
+                submesh = CookedSubmesh();
+                submesh.materialOffset = AppendString(strings, material);
+                submesh.materialLength = static_cast<uint32_t>(material.size());
+                submesh.firstIndex = static_cast<uint32_t>(indices.size());
+            }
+            else if (keyword == "mtllib") {
+                for (std::string_view name = NextToken(line); !name.empty(); name = NextToken(line)) {
+                    std::string cooked = cookedLibrary(name);
+                    CookedString library;
+                    library.offset = AppendString(strings, cooked);
+                    library.length = static_cast<uint32_t>(cooked.size());
+                    libraries.push_back(library);
+                }
+            }
+        }
+        submesh.indexCount = static_cast<uint32_t>(indices.size()) - submesh.firstIndex;
+        if (submesh.indexCount > 0) {
+            submeshes.push_back(submesh);
+        }
+
+        CookedMeshHeader header = {};
+        header.magic = COOKED_MESH_MAGIC;
+        header.version = COOKED_MESH_VERSION;
+        header.vertexCount = static_cast<uint32_t>(vertices.size());
+        header.indexCount = static_cast<uint32_t>(indices.size());
+        header.submeshCount = static_cast<uint32_t>(submeshes.size());
+        header.libraryCount = static_cast<uint32_t>(libraries.size());
+        header.stringBytes = static_cast<uint32_t>(strings.size());
+
+        out.clear();
+        out.reserve(sizeof(header) + vertices.size() * sizeof(CookedVertex) + indices.size() * sizeof(uint32_t)
+            + submeshes.size() * sizeof(CookedSubmesh) + libraries.size() * sizeof(CookedString) + strings.size());
+        AppendRecords(out, &header, 1);
+        AppendRecords(out, vertices.data(), vertices.size());
+        AppendRecords(out, indices.data(), indices.size());
+        AppendRecords(out, submeshes.data(), submeshes.size());
+        AppendRecords(out, libraries.data(), libraries.size());
+        out += strings;
+        return true;
+    }
+
+    // Writes the cooked form of node to target
+    bool CookAsset(const AssetNode& node, const std::vector<AssetNode>& nodes, const fs::path& target, std::string& error) {
+        fs::path source(node.name);
+        if (node.scan.kind != AssetKind::Model && node.scan.kind != AssetKind::Material) {
+            std::error_code copyError;
+            if (!fs::copy_file(source, target, fs::copy_options::overwrite_existing, copyError) || copyError) {
+                error = copyError.message();
+                return false;
+            }
+            return true;
+        }
+
+        std::string text;
+        if (!ReadWholeFile(source, text)) {
+            error = "cannot read the file";
+            return false;
+        }
+        // References resolve the way ScanAsset resolved them
+        fs::path directory = source.parent_path();
+        auto cookedName = [&](std::string_view reference) {
+            std::string resolved = (directory / reference).lexically_normal().generic_string();
+            for (size_t i = 0; i < node.scan.references.size(); ++i) {
+                if (node.scan.references[i] == resolved) {
+                    return nodes[node.references[i]].cookedName;
+                }
+            }
+            return std::string(reference);
+        };
+
+        std::string out;
+        if (node.scan.kind == AssetKind::Model) {
+            if (!CookModel(text, cookedName, out, error)) {
+                return false;
+            }
+        }
+        else {
+            size_t copied = 0;
+            ForEachReference(AssetKind::Material, text, [&](size_t offset, size_t length) {
+                out.append(text, copied, offset - copied);
+                out += cookedName(std::string_view(text).substr(offset, length));
+                copied = offset + length;
+            });
+            out.append(text, copied, std::string::npos);
+        }
+
+        std::ofstream file(target, std::ios::out | std::ios::trunc | std::ios::binary);
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        file.close();
+        if (file.fail()) {
+            error = "cannot write the cooked file";
+            return false;
+        }
+        return true;
+    }
+
+}
+
+bool GetAssetKind(const fs::path& path, AssetKind& kind) {
+    std::string extension = ToLower(path.extension().string());
+    for (const AssetExtension& entry : ASSET_EXTENSIONS) {
+        if (extension == entry.extension) {
+            kind = entry.kind;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CookAssets(const LevelData& level, const fs::path& assetDirectory, const fs::path& destination, unsigned jobs,
+    const BuildLogCallback& log, AssetCookStats& stats, const BuildHooks& hooks) {
+    stats = AssetCookStats();
+    fs::path root = fs::absolute(assetDirectory);
+
+    // Every object shares the level's string pool, so each distinct value
+    // is looked at once however many objects use it
+    std::map<std::string, std::string> levelReferences;  // as written -> resolved
+    std::unordered_set<uint32_t> seen;
+    for (size_t type = 0; type < OBJECT_TYPE_COUNT; ++type) {
+        for (const LevelObject* obj : level.GetObjectsByType(static_cast<ObjectType>(type))) {
+            for (const PropertyEntry& entry : obj->GetProperties()) {
+                if (entry.value.type != PropertyType::String || !seen.insert(entry.value.s).second) {
+                    continue;
+                }
+                std::string text(obj->GetStrings().Get(entry.value.s));
+                AssetKind kind;
+                if (GetAssetKind(text, kind)) {
+                    levelReferences[text] = (root / text).lexically_normal().generic_string();
+                }
+            }
+        }
+    }
+    if (levelReferences.empty() && !fs::exists(destination)) {
+        return true;
+    }
+    fs::create_directories(destination);
+
+    // The graph is discovered a level at a time: scanning a file finds the
+    // files it references, which are scanned together in the next round
+    fs::path manifestPath = destination / COOK_MANIFEST;
+    CookManifest previous = ReadManifest(manifestPath);
+    std::vector<AssetNode> nodes;
+    std::unordered_map<std::string, size_t> nodeIds;
+    auto addNode = [&](const std::string& name, AssetKind kind) {
+        auto found = nodeIds.find(name);
+        if (found != nodeIds.end()) {
+            return found->second;
+        }
+        nodeIds.emplace(name, nodes.size());
+        nodes.emplace_back();
+        nodes.back().name = name;
+        nodes.back().scan.kind = kind;
+        return nodes.size() - 1;
+    };
+    for (const auto& [text, name] : levelReferences) {
+        AssetKind kind;
+        GetAssetKind(text, kind);
+        addNode(name, kind);
+    }
+
+    // Declared before the pool, whose workers are then joined before these
+    // go away
+    std::mutex mutex;
+    std::condition_variable allFinished;
+    size_t finished = 0;
+    std::unordered_set<uint64_t> claimed;
+    std::function<void(size_t)> cook;
+    ThreadPool pool(jobs);
+
+    for (size_t begin = 0; begin < nodes.size();) {
+        size_t end = nodes.size();
+        pool.ParallelFor(end - begin, [&](size_t i) { ScanAsset(nodes[begin + i], previous); });
+        for (size_t id = begin; id < end; ++id) {
+            AssetKind referencedKind = GetReferencedKind(nodes[id].scan.kind);
+            for (size_t i = 0; i < nodes[id].scan.references.size(); ++i) {
+                // Copied: adding a node may move the one it came from
+                std::string name = nodes[id].scan.references[i];
+
+                // A material naming itself or a model would close a cycle
+                // that never becomes ready. Unknown extensions are taken to
+                // be the expected kind.
+                AssetKind kind;
+                if (GetAssetKind(name, kind) && kind != referencedKind) {
+                    nodes[id].invalidReference = name;
+                    nodes[id].references.clear();
+                    break;
+                }
+                size_t reference = addNode(name, referencedKind);
+                nodes[id].references.push_back(reference);
+            }
+        }
+        begin = end;
+    }
+    stats.assets = nodes.size();
+
+    CookManifest current;
+    for (const AssetNode& node : nodes) {
+        if (!node.missing) {
+            current[node.name] = node.scan;
+        }
+    }
+    WriteManifest(manifestPath, current);
+
+    // A step is ready once every asset it references has its cooked name
+    for (size_t id = 0; id < nodes.size(); ++id) {
+        for (size_t reference : nodes[id].references) {
+            nodes[reference].dependents.push_back(id);
+        }
+        nodes[id].waiting = nodes[id].references.size();
+    }
+
+    cook = [&](size_t id) {
+        AssetNode& node = nodes[id];
+        std::string message;
+        bool cancelled = hooks.cancel && hooks.cancel();
+        bool referenceFailed = false;
+        for (size_t reference : node.references) {
+            referenceFailed = referenceFailed || nodes[reference].failed;
+        }
+
+        enum class Outcome { Cooked, Cached, UpToDate, Duplicate, Failed, Skipped } outcome = Outcome::Skipped;
+        if (cancelled || referenceFailed) {
+            node.failed = true;
+        }
+        else if (node.missing) {
+            node.failed = true;
+            outcome = Outcome::Failed;
+            message = "missing";
+        }
+        else if (!node.invalidReference.empty()) {
+            node.failed = true;
+            outcome = Outcome::Failed;
+            message = node.invalidReference + " is not a " + KIND_NAMES[static_cast<size_t>(GetReferencedKind(node.scan.kind))];
+        }
+        else {
+            uint64_t key = CombineHash(HashString(KIND_NAMES[static_cast<size_t>(node.scan.kind)], ASSET_COOK_VERSION), node.scan.hash);
+            for (size_t reference : node.references) {
+                key = CombineHash(key, HashString(nodes[reference].cookedName));
+            }
+            node.cookedName = FormatKey(key) + (node.scan.kind == AssetKind::Model ? std::string(".mesh") : ToLower(fs::path(node.name).extension().string()));
+            fs::path target = destination / node.cookedName;
+
+            bool first = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                first = claimed.insert(key).second;
+            }
+            std::error_code error;
+            if (!first) {
+                outcome = Outcome::Duplicate;
+            }
+            else if (fs::exists(target, error)) {
+                outcome = Outcome::UpToDate;
+            }
+            else if (hooks.cache && hooks.cache->Fetch(key, target)) {
+                outcome = Outcome::Cached;
+            }
+            else {
+                try {
+                    fs::path tempPath = target;
+                    tempPath += ".tmp";
+                    if (CookAsset(node, nodes, tempPath, message)) {
+                        fs::rename(tempPath, target);
+                        outcome = Outcome::Cooked;
+                        if (hooks.cache) {
+                            hooks.cache->Store(key, target);
+                        }
+                    }
+                    else {
+                        fs::remove(tempPath, error);
+                    }
+                }
+                catch (const std::exception& e) {
+                    message = e.what();
+                }
+                if (outcome != Outcome::Cooked) {
+                    node.failed = true;
+                    outcome = Outcome::Failed;
+                }
+            }
+        }
+
+        std::vector<size_t> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            switch (outcome) {
+            case Outcome::Cooked:
+                ++stats.cooked;
+                log("Cooked " + node.name + " -> " + node.cookedName);
+                break;
+            case Outcome::Cached:
+                ++stats.cached;
+                log("Cooked " + node.name + " -> " + node.cookedName + " (cached)");
+                break;
+            case Outcome::UpToDate:
+                ++stats.upToDate;
+                break;
+            case Outcome::Duplicate:
+                ++stats.duplicates;
+                break;
+            case Outcome::Failed:
+                ++stats.failed;
+                log("Failed to cook " + node.name + ": " + message);
+                break;
+            case Outcome::Skipped:
+                stats.cancelled = stats.cancelled || cancelled;
+                break;
+            }
+            for (size_t dependent : node.dependents) {
+                if (--nodes[dependent].waiting == 0) {
+                    ready.push_back(dependent);
+                }
+            }
+            ++finished;
+            if (hooks.progress) {
+                hooks.progress(finished, nodes.size());
+            }
+            if (finished == nodes.size()) {
+                allFinished.notify_all();
+            }
+        }
+        for (size_t dependent : ready) {
+            pool.Submit([&cook, dependent]() { cook(dependent); });
+        }
+    };
+
+    if (hooks.progress) {
+        hooks.progress(0, nodes.size());
+    }
+    for (size_t id = 0; id < nodes.size(); ++id) {
+        if (nodes[id].waiting == 0) {
+            pool.Submit([&cook, id]() { cook(id); });
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        allFinished.wait(lock, [&]() { return finished == nodes.size(); });
+    }
+
+    if (stats.cancelled || (hooks.cancel && hooks.cancel())) {
+        stats.cancelled = true;
+        log("Asset cooking cancelled.");
+        return false;
+    }
+    if (stats.failed > 0) {
+        return false;
+    }
+
+    // The table names exactly the files the game needs; the rest is stale
+    std::ostringstream table;
+    std::set<std::string> keep = { COOK_MANIFEST, COOKED_ASSET_TABLE };
+    for (const auto& [text, name] : levelReferences) {
+        table << text << "\t" << nodes[nodeIds[name]].cookedName << "\n";
+    }
+    for (const AssetNode& node : nodes) {
+        keep.insert(node.cookedName);
+    }
+    bool written = false;
+    if (!WriteFileIfChanged(destination / COOKED_ASSET_TABLE, table.str(), written)) {
+        throw fs::filesystem_error("Failed to write asset table", destination / COOKED_ASSET_TABLE, std::make_error_code(std::errc::io_error));
+    }
+
+    std::vector<fs::path> stale;
+    for (const auto& entry : fs::directory_iterator(destination)) {
+        if (keep.count(entry.path().filename().string()) == 0) {
+            stale.push_back(entry.path());
+        }
+    }
+    for (const fs::path& path : stale) {
+        std::error_code error;
+        if (fs::remove_all(path, error) > 0) {
+            ++stats.removed;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "GameBuild.h"
+#include "LevelEditor.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// Asset cooking
+//
+// A string property whose value names a file with an asset extension (see
+// GetAssetKind) is a reference, resolved against the asset directory. The
+// cook follows references into the files themselves, models to their
+// material libraries and materials to their textures, and so builds a graph
+// of everything the level reaches. A reference to a file of another kind,
+// such as a material naming a model, fails the cook. Each asset is then
+// cooked into destination once the assets it references are, with up to
+// jobs steps running at once:
+//
+//   Model (.obj)       binary mesh, laid out below; material libraries are
+//                      named by their cooked files
+//   Material (.mtl)    the same text with texture names replaced by cooked ones
+//   Texture, Script, Sound    copied unchanged
+//
+// A cooked file is named by a hash of its kind, its source's contents and
+// the names of the cooked files it references. Identical sources therefore
+// cook once, and a step only runs when the file it would write is missing.
+// COOKED_ASSET_TABLE maps each reference the level makes to its cooked file;
+// cooked files nothing maps to any more are deleted. Source hashes and
+// references are remembered by size and write time, so an unchanged asset
+// tree costs one stat per file. File names containing spaces are not
+// supported inside .obj and .mtl files.
+//
+// Cooked mesh, all integers little-endian:
+//
+//   CookedMeshHeader
+//   CookedVertex[vertexCount]
+//   uint32_t[indexCount]             triangle list
+//   CookedSubmesh[submeshCount]      index ranges by material, in file order
+//   CookedString[libraryCount]       cooked material library file names
+//   char[stringBytes]                material and library names
+
+const char* const COOKED_ASSET_DIR = "Assets";
+const char* const COOKED_ASSET_TABLE = "AssetTable.txt";
+const uint32_t COOKED_MESH_MAGIC = 0x534D5550; // "PUMS"
+const uint32_t COOKED_MESH_VERSION = 1;
+
+enum class AssetKind {
+    Model,
+    Material,
+    Texture,
+    Script,
+    Sound
+};
+
+// False for files that are not assets
+bool GetAssetKind(const fs::path& path, AssetKind& kind);
+
+struct CookedMeshHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t submeshCount;
+    uint32_t libraryCount;
+    uint32_t stringBytes;
+    uint32_t reserved;
+};
+
+struct CookedVertex {
+    float position[3];
+    float normal[3];
+    float uv[2];
+};
+
+struct CookedSubmesh {
+    uint32_t materialOffset;
+    uint32_t materialLength;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+struct CookedString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+static_assert(sizeof(CookedMeshHeader) == 32, "CookedMeshHeader layout changed");
+static_assert(sizeof(CookedVertex) == 32, "CookedVertex layout changed");
+static_assert(sizeof(CookedSubmesh) == 16, "CookedSubmesh layout changed");
+static_assert(sizeof(CookedString) == 8, "CookedString layout changed");
+
+struct AssetCookStats {
+    size_t assets = 0;      // files in the graph
+    size_t cooked = 0;
+    size_t cached = 0;      // fetched from hooks.cache instead
+    size_t upToDate = 0;
+    size_t duplicates = 0;  // same contents as an asset cooked in this run
+    size_t removed = 0;
+    size_t failed = 0;
+    bool cancelled = false;
+};
+
+// Cooks what level references into destination; jobs == 0 uses every core.
+// Progress, cancel and cache work as in BuildDirectory. Returns false when
+// an asset is missing or fails to cook, or the cook is cancelled; the
+// reasons go to log. Throws fs::filesystem_error when destination cannot be
+// written.
+bool CookAssets(const LevelData& level, const fs::path& assetDirectory, const fs::path& destination, unsigned jobs,
+    const BuildLogCallback& log, AssetCookStats& stats, const BuildHooks& hooks = BuildHooks());
@@ -0,0 +1,281 @@
+#include "CompileCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+    const char* const INDEX_FILE = "index";
+    const char* const TEMP_EXTENSION = ".tmp";
+
+    std::string FormatKey(uint64_t key) {
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(key));
+        return text;
+    }
+
+    bool ParseKey(const std::string& text, uint64_t& key) {
+        if (text.size() != 16 || text.find_first_not_of("0123456789abcdef") != std::string::npos) {
+            return false;
+        }
+        key = std::stoull(text, nullptr, 16);
+        return true;
+    }
+
+}
+
+CompileCache::CompileCache()
+    : maxBytes_(DEFAULT_COMPILE_CACHE_BYTES), totalBytes_(0), clock_(0), tempCounter_(0), dirty_(false) {
+}
+
+CompileCache::~CompileCache() {
+    if (IsOpen() && dirty_) {
+        Flush();
+    }
+}
+
+bool CompileCache::Open(const fs::path& directory, uint64_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_.clear();
+    entries_.clear();
+    totalBytes_ = 0;
+    clock_ = 0;
+    stats_ = CompileCacheStats();
+    maxBytes_ = maxBytes;
+
+    std::error_code error;
+    fs::create_directories(directory, error);
+    if (error) {
+        return false;
+    }
+
+    // "clock <n>", "stats <hits> <misses> <stores> <evictions>", then entries
+    std::map<uint64_t, Entry> listed;
+    std::ifstream index(directory / INDEX_FILE);
+    std::string line;
+    while (std::getline(index, line)) {
+        std::istringstream fields(line);
+        std::string first;
+        fields >> first;
+        uint64_t key = 0;
+        Entry entry;
+        if (first == "clock") {
+            fields >> clock_;
+        }
+        else if (first == "stats") {
+            fields >> stats_.hits >> stats_.misses >> stats_.stores >> stats_.evictions;
+        }
+        else if (ParseKey(first, key) && fields >> entry.size >> entry.lastUse) {
+            listed[key] = entry;
+        }
+    }
+
+    // The files are the truth: an interrupted compile may have stored
+    // entries the index never recorded, or left temporary files behind
+    for (auto it = fs::recursive_directory_iterator(directory, error); !error && it != fs::recursive_directory_iterator(); it.increment(error)) {
+        if (!it->is_regular_file()) {
+            continue;
+        }
+        const fs::path& path = it->path();
+        uint64_t key = 0;
+        if (path.extension() == TEMP_EXTENSION) {
+            std::error_code removeError;
+            fs::remove(path, removeError);
+        }
+        else if (path.parent_path() != directory && ParseKey(path.filename().string(), key)) {
+            Entry entry;
+            auto found = listed.find(key);
+            if (found != listed.end()) {
+                entry.lastUse = found->second.lastUse;
+            }
+            entry.size = static_cast<uint64_t>(it->file_size());
+            entries_[key] = entry;
+            totalBytes_ += entry.size;
+        }
+    }
+    if (error) {
+        entries_.clear();
+        totalBytes_ = 0;
+        return false;
+    }
+
+    directory_ = directory;
+    dirty_ = entries_.size() != listed.size();
+    return true;
+}
+
+void CompileCache::SetMaxBytes(uint64_t maxBytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    maxBytes_ = maxBytes;
+}
+
+fs::path CompileCache::GetEntryPath(uint64_t key) const {
+    std::string name = FormatKey(key);
+    return directory_ / name.substr(0, 2) / name;
+}
+
+fs::path CompileCache::GetTempPath(uint64_t key) {
+    fs::path path = GetEntryPath(key);
+    path += "." + std::to_string(tempCounter_.fetch_add(1)) + TEMP_EXTENSION;
+    return path;
+}
+
+bool CompileCache::FindEntry(uint64_t key, fs::path& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        ++stats_.misses;
+        dirty_ = true;
+        return false;
+    }
+    ++stats_.hits;
+    it->second.lastUse = ++clock_;
+    dirty_ = true;
+    path = GetEntryPath(key);
+    return true;
+}
+
+bool CompileCache::AddEntry(uint64_t key, const fs::path& tempPath) {
+    std::error_code error;
+    uint64_t size = static_cast<uint64_t>(fs::file_size(tempPath, error));
+    if (!error) {
+        fs::rename(tempPath, GetEntryPath(key), error);
+    }
+    if (error) {
+        fs::remove(tempPath, error);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& entry = entries_[key];
+    totalBytes_ += size - entry.size;
+    entry.size = size;
+    entry.lastUse = ++clock_;
+    ++stats_.stores;
+    dirty_ = true;
+    return true;
+}
+
+// Entries are only deleted in Flush, so a found entry can be copied
+// without holding the lock. The copy may keep the entry's write time (it
+// does on Windows), which would make the target older than the sources it
+// was built from, so it is stamped as written now.
+bool CompileCache::Fetch(uint64_t key, const fs::path& target) {
+    fs::path path;
+    if (!IsOpen() || !FindEntry(key, path)) {
+        return false;
+    }
+    std::error_code error;
+    if (!fs::copy_file(path, target, fs::copy_options::overwrite_existing, error) || error) {
+        return false;
+    }
+    fs::last_write_time(target, fs::file_time_type::clock::now(), error);
+    return !error;
+}
+
+bool CompileCache::FetchText(uint64_t key, std::string& text) {
+    fs::path path;
+    if (!IsOpen() || !FindEntry(key, path)) {
+        return false;
+    }
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    text = contents.str();
+    return !file.bad();
+}
+
+bool CompileCache::Store(uint64_t key, const fs::path& source) {
+    if (!IsOpen()) {
+        return false;
+    }
+    fs::path tempPath = GetTempPath(key);
+    std::error_code error;
+    fs::create_directories(tempPath.parent_path(), error);
+    if (error || !fs::copy_file(source, tempPath, fs::copy_options::overwrite_existing, error) || error) {
+        fs::remove(tempPath, error);
+        return false;
+    }
+    return AddEntry(key, tempPath);
+}
+
+bool CompileCache::StoreText(uint64_t key, const std::string& text) {
+    if (!IsOpen()) {
+        return false;
+    }
+    fs::path tempPath = GetTempPath(key);
+    std::error_code error;
+    fs::create_directories(tempPath.parent_path(), error);
+    {
+        std::ofstream file(tempPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+        file.close();
+        if (file.fail()) {
+            fs::remove(tempPath, error);
+            return false;
+        }
+    }
+    return AddEntry(key, tempPath);
+}
+
+bool CompileCache::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!IsOpen()) {
+        return false;
+    }
+
+    if (totalBytes_ > maxBytes_) {
+        std::vector<std::pair<uint64_t, uint64_t>> byAge;
+        byAge.reserve(entries_.size());
+        for (const auto& [key, entry] : entries_) {
+            byAge.emplace_back(entry.lastUse, key);
+        }
+        std::sort(byAge.begin(), byAge.end());
+
+        for (size_t i = 0; i < byAge.size() && totalBytes_ > maxBytes_; ++i) {
+            std::error_code error;
+            fs::remove(GetEntryPath(byAge[i].second), error);
+            totalBytes_ -= entries_[byAge[i].second].size;
+            entries_.erase(byAge[i].second);
+            ++stats_.evictions;
+        }
+        dirty_ = true;
+    }
+
+    if (!dirty_) {
+        return true;
+    }
+
+    fs::path indexPath = directory_ / INDEX_FILE;
+    fs::path tempPath = indexPath;
+    tempPath += TEMP_EXTENSION;
+    {
+        std::ofstream index(tempPath, std::ios::out | std::ios::trunc);
+        index << "clock " << clock_ << "\n";
+        index << "stats " << stats_.hits << " " << stats_.misses << " " << stats_.stores << " " << stats_.evictions << "\n";
+        for (const auto& [key, entry] : entries_) {
+            index << FormatKey(key) << " " << entry.size << " " << entry.lastUse << "\n";
+        }
+        index.close();
+        if (index.fail()) {
+            return false;
+        }
+    }
+    std::error_code error;
+    fs::rename(tempPath, indexPath, error);
+    if (error) {
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+CompileCacheStats CompileCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CompileCacheStats stats = stats_;
+    stats.entries = entries_.size();
+    stats.bytes = totalBytes_;
+    return stats;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// Local content-addressed cache for compile outputs
+//
+// Entries are files named by a 64-bit key that hashes everything the output
+// depends on, so an entry is valid for as long as it exists and a lookup
+// needs no other checks. The compiler keys generated sources by the level's
+// content hash, object files by the toolchain and the contents of every
+// file the unit read, and executables by the toolchain and the object
+// contents. A repeated or reverted compile then copies its outputs instead
+// of producing them again. Keys cover the compiler command and flags but
+// not the compiler binary, so clear the cache after a toolchain upgrade.
+//
+// The directory holds the entries, fanned out by the key's first byte, and
+// an index with one "<key> <size> <last use>" line per entry. Entries are
+// only deleted in Flush, which evicts the least recently used until the
+// total fits the limit. Safe to use from several threads of one process;
+// processes sharing a directory are not coordinated.
+
+const uint64_t DEFAULT_COMPILE_CACHE_BYTES = 1024ull * 1024 * 1024;
+
+struct CompileCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t stores = 0;
+    size_t evictions = 0;
+    size_t entries = 0;
+    uint64_t bytes = 0;
+
+    double GetHitRate() const { return hits + misses > 0 ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0; }
+};
+
+class CompileCache {
+public:
+    CompileCache();
+    ~CompileCache();
+
+    // Loads the index, creating the directory if needed. Entry files the
+    // index does not list are kept as least recently used; listed entries
+    // whose file is gone are dropped.
+    bool Open(const fs::path& directory, uint64_t maxBytes = DEFAULT_COMPILE_CACHE_BYTES);
+    bool IsOpen() const { return !directory_.empty(); }
+    void SetMaxBytes(uint64_t maxBytes);
+
+    // Copy the entry for key out of the cache; false on a miss
+    bool Fetch(uint64_t key, const fs::path& target);
+    bool FetchText(uint64_t key, std::string& text);
+    // Copy an output into the cache under key
+    bool Store(uint64_t key, const fs::path& source);
+    bool StoreText(uint64_t key, const std::string& text);
+
+    // Evicts down to the size limit and saves the index
+    bool Flush();
+
+    // Totals since the cache directory was created
+    CompileCacheStats GetStats() const;
+
+private:
+    struct Entry {
+        uint64_t size = 0;
+        uint64_t lastUse = 0;
+    };
+
+    fs::path GetEntryPath(uint64_t key) const;
+    fs::path GetTempPath(uint64_t key);
+    bool FindEntry(uint64_t key, fs::path& path);
+    bool AddEntry(uint64_t key, const fs::path& tempPath);
+
+    mutable std::mutex mutex_;
+    fs::path directory_;
+    std::map<uint64_t, Entry> entries_;
+    uint64_t maxBytes_;
+    uint64_t totalBytes_;
+    uint64_t clock_;  // last use stamps; higher is more recent
+    CompileCacheStats stats_;
+    std::atomic<uint64_t> tempCounter_;
+    bool dirty_;
+};
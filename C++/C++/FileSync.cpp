@@ -0,0 +1,190 @@
+#include "FileSync.h"
+#include "LevelHash.h"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace {
+
+    struct SyncedFile {
+        uint64_t size = 0;
+        int64_t writeTime = 0;
+        uint64_t hash = 0;
+    };
+
+    typedef std::map<std::string, SyncedFile> SyncManifest;
+
+    // One "<hash> <size> <write time> <relative path>" line per file
+    SyncManifest ReadManifest(const fs::path& path) {
+        SyncManifest manifest;
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            SyncedFile entry;
+            std::string name;
+            fields >> std::hex >> entry.hash >> std::dec >> entry.size >> entry.writeTime;
+            fields.get();
+            if (fields && std::getline(fields, name) && !name.empty()) {
+                manifest[name] = entry;
+            }
+        }
+        return manifest;
+    }
+
+    void WriteManifest(const fs::path& path, const SyncManifest& manifest) {
+        fs::path tempPath = path;
+        tempPath += ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::out | std::ios::trunc);
+            for (const auto& [name, entry] : manifest) {
+                file << std::hex << entry.hash << std::dec << " " << entry.size << " " << entry.writeTime << " " << name << "\n";
+            }
+            file.close();
+            if (file.fail()) {
+                throw fs::filesystem_error("Failed to write sync manifest", tempPath, std::make_error_code(std::errc::io_error));
+            }
+        }
+        fs::rename(tempPath, path);
+    }
+
+    bool ReadWholeFile(const fs::path& path, std::string& text) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        text = contents.str();
+        return true;
+    }
+
+    // Removes target first: it may be a hard link whose other name is in source
+    bool PlaceFile(const fs::path& source, const fs::path& target) {
+        fs::remove(target);
+
+        std::error_code error;
+        fs::create_hard_link(source, target, error);
+        if (!error) {
+            return true;
+        }
+        fs::copy_file(source, target);
+        return false;
+    }
+
+}
+
+FileSyncStats SyncDirectory(const fs::path& source, const fs::path& destination, const std::vector<std::string>& excluded) {
+    FileSyncStats stats;
+    fs::create_directories(destination);
+
+    fs::path manifestPath = destination / FILE_SYNC_MANIFEST;
+    SyncManifest previous = ReadManifest(manifestPath);
+    SyncManifest current;
+
+    for (const auto& entry : fs::recursive_directory_iterator(source)) {
+        // Entries are built from source, so no canonicalization is needed
+        fs::path relative = entry.path().lexically_relative(source);
+        std::string name = relative.generic_string();
+        if (std::find(excluded.begin(), excluded.end(), name) != excluded.end()) {
+            continue;
+        }
+        fs::path target = destination / relative;
+        if (entry.is_directory()) {
+            fs::create_directories(target);
+            continue;
+        }
+
+        SyncedFile file;
+        file.size = entry.file_size();
+        file.writeTime = static_cast<int64_t>(entry.last_write_time().time_since_epoch().count());
+
+        auto known = previous.find(name);
+        std::error_code error;
+        bool present = known != previous.end() && fs::file_size(target, error) == known->second.size && !error;
+        if (present && known->second.size == file.size && known->second.writeTime == file.writeTime) {
+            file.hash = known->second.hash;
+            ++stats.unchanged;
+        }
+        else {
+            file.hash = HashFile(entry.path());
+            if (present && known->second.size == file.size && known->second.hash == file.hash) {
+                ++stats.unchanged;
+            }
+            else if (PlaceFile(entry.path(), target)) {
+                ++stats.linked;
+            }
+            else {
+                ++stats.copied;
+            }
+        }
+        current[name] = file;
+    }
+
+    for (const auto& [name, entry] : previous) {
+        if (current.count(name) == 0 && std::find(excluded.begin(), excluded.end(), name) == excluded.end()) {
+            std::error_code error;
+            if (fs::remove(destination / fs::path(name), error)) {
+                ++stats.removed;
+
+                // Directories the file leaves empty go too; removing one
+                // that still holds anything fails and ends the walk
+                for (fs::path directory = fs::path(name).parent_path(); !directory.empty(); directory = directory.parent_path()) {
+                    if (!fs::remove(destination / directory, error)) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    WriteManifest(manifestPath, current);
+    return stats;
+}
+
+uint64_t HashFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        throw fs::filesystem_error("Failed to read", path, std::make_error_code(std::errc::io_error));
+    }
+
+    char buffer[64 * 1024];
+    uint64_t hash = 0;
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+        hash = HashBytes(buffer, static_cast<size_t>(file.gcount()), hash);
+    }
+    return hash;
+}
+
+bool WriteFileIfChanged(const fs::path& path, const std::string& text, bool& written) {
+    written = false;
+    std::string existing;
+    if (ReadWholeFile(path, existing) && existing == text) {
+        return true;
+    }
+
+    fs::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+        file.close();
+        if (file.fail()) {
+            return false;
+        }
+    }
+
+    // Renaming gives path a new file instead of writing through a hard link
+    std::error_code error;
+    fs::rename(tempPath, path, error);
+    if (error) {
+        fs::remove(tempPath, error);
+        return false;
+    }
+    written = true;
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Incremental directory mirroring for build output
+//
+// SyncDirectory keeps destination in step with source across calls. It
+// records what it placed in a manifest inside destination (size, write time
+// and content hash per file). A file whose size and write time match the
+// manifest is skipped without being read; one that was only touched is
+// hashed and skipped when its content is the same. Changed files are hard
+// linked where the volume allows and copied otherwise. Files a previous
+// sync placed that no longer exist in source are deleted, along with any
+// directories that leaves empty; anything else in destination, such as
+// generated code or build output, is left alone.
+//
+// Because destination files may be hard links into source, never write one
+// in place: replace it with WriteFileIfChanged or remove it first.
+
+const char* const FILE_SYNC_MANIFEST = ".filesync";
+
+struct FileSyncStats {
+    size_t linked = 0;
+    size_t copied = 0;
+    size_t unchanged = 0;
+    size_t removed = 0;
+};
+
+// Relative paths (generic form, "dir/file.cpp") in excluded are neither
+// placed nor deleted. Throws fs::filesystem_error on failure.
+FileSyncStats SyncDirectory(const fs::path& source, const fs::path& destination, const std::vector<std::string>& excluded);
+
+// HashBytes of the file's contents. Throws fs::filesystem_error when it
+// cannot be read.
+uint64_t HashFile(const fs::path& path);
+
+// Replaces path with text through a temporary file unless it already holds
+// exactly text, so unchanged output keeps its write time. Bytes are written
+// as given, without newline translation. Returns false on failure; written
+// tells whether the file changed.
+bool WriteFileIfChanged(const fs::path& path, const std::string& text, bool& written);
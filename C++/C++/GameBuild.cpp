@@ -0,0 +1,519 @@
+#include "GameBuild.h"
+#include "CompileCache.h"
+#include "FileSync.h"
+#include "LevelHash.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+namespace {
+
+    // Printed by cl.exe for every file a unit opens. English toolsets only;
+    // with another language the record holds just the source, so header
+    // edits alone would not trigger a rebuild there.
+    const char* const SHOW_INCLUDES_PREFIX = "Note: including file:";
+
+    struct BuildUnit {
+        std::string name;   // relative to the build directory, for the log
+        fs::path source;
+        fs::path object;
+        fs::path record;    // command hash, then one dependency per line
+        fs::path depFile;   // GCC's make-style output, read once and removed
+        std::string command;
+        uint64_t commandHash = 0;
+        std::vector<std::string> lastDependencies;  // from the record, source first
+    };
+
+    std::string Quote(const fs::path& path) {
+        return "\"" + path.string() + "\"";
+    }
+
+    // Runs command with stderr folded into output and returns its exit code,
+    // or -1 when it could not be started
+    int RunCommand(const std::string& command, std::string& output) {
+#ifdef _WIN32
+        // cmd.exe drops the first and last quote when the line starts with
+        // one, so wrap the whole line in a pair it can drop
+        std::string line = "\"" + command + " 2>&1\"";
+        FILE* pipe = _popen(line.c_str(), "r");
+#else
+        std::string line = command + " 2>&1";
+        FILE* pipe = popen(line.c_str(), "r");
+#endif
+        if (!pipe) {
+            return -1;
+        }
+
+        char buffer[4096];
+        size_t count;
+        while ((count = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+            output.append(buffer, count);
+        }
+
+#ifdef _WIN32
+        return _pclose(pipe);
+#else
+        int status = pclose(pipe);
+        return status != -1 && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+    }
+
+    // Dependencies of "object: source header \<newline> header ..."
+    std::vector<std::string> ParseMakeDependencies(const std::string& text) {
+        std::vector<std::string> files;
+        size_t start = text.find(": ");
+        if (start == std::string::npos) {
+            return files;
+        }
+
+        std::string current;
+        for (size_t i = start + 2; i < text.size(); ++i) {
+            char c = text[i];
+            if (c == '\\' && i + 1 < text.size() && (text[i + 1] == ' ' || text[i + 1] == '#')) {
+                current += text[++i];
+                continue;
+            }
+            if (c == '$' && i + 1 < text.size() && text[i + 1] == '$') {
+                current += text[++i];
+                continue;
+            }
+            if (c == '\\' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                if (!current.empty()) {
+                    files.push_back(current);
+                    current.clear();
+                }
+                continue;
+            }
+            current += c;
+        }
+        if (!current.empty()) {
+            files.push_back(current);
+        }
+        return files;
+    }
+
+    // Moves cl.exe's include notes into files and returns the rest of output
+    std::string TakeShowIncludes(const std::string& output, const std::string& sourceName, std::vector<std::string>& files) {
+        std::string rest;
+        std::istringstream lines(output);
+        std::string line;
+        size_t prefixLength = strlen(SHOW_INCLUDES_PREFIX);
+        while (std::getline(lines, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.compare(0, prefixLength, SHOW_INCLUDES_PREFIX) == 0) {
+                size_t first = line.find_first_not_of(' ', prefixLength);
+                if (first != std::string::npos) {
+                    files.push_back(line.substr(first));
+                }
+            }
+            else if (line != sourceName) {
+                rest += line;
+                rest += "\n";
+            }
+        }
+        return rest;
+    }
+
+    // Write times of dependencies, shared by every unit that includes them
+    class WriteTimeCache {
+    public:
+        // max() for a file that no longer exists, which is never up to date
+        fs::file_time_type Get(const std::string& path) {
+            auto it = times_.find(path);
+            if (it != times_.end()) {
+                return it->second;
+            }
+
+            std::error_code error;
+            fs::file_time_type time = fs::last_write_time(path, error);
+            if (error) {
+                time = fs::file_time_type::max();
+            }
+            times_.emplace(path, time);
+            return time;
+        }
+
+    private:
+        std::unordered_map<std::string, fs::file_time_type> times_;
+    };
+
+    // Content hashes of dependencies for cache keys; used by the compile
+    // threads at once
+    class ContentHashCache {
+    public:
+        bool Get(const std::string& path, uint64_t& hash) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = hashes_.find(path);
+                if (it != hashes_.end()) {
+                    hash = it->second;
+                    return true;
+                }
+            }
+
+            try {
+                hash = HashFile(path);
+            }
+            catch (const fs::filesystem_error&) {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            hashes_.emplace(path, hash);
+            return true;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::unordered_map<std::string, uint64_t> hashes_;
+    };
+
+    // Returns the command hash, or 0 with dependencies empty when there is
+    // no usable record
+    uint64_t ReadRecord(const fs::path& path, std::vector<std::string>& dependencies) {
+        std::ifstream record(path);
+        uint64_t commandHash = 0;
+        if (!(record >> std::hex >> commandHash)) {
+            return 0;
+        }
+
+        std::string dependency;
+        std::getline(record, dependency);
+        while (std::getline(record, dependency)) {
+            if (!dependency.empty()) {
+                dependencies.push_back(dependency);
+            }
+        }
+        return dependencies.empty() ? 0 : commandHash;
+    }
+
+    bool IsUpToDate(const BuildUnit& unit, uint64_t commandHash, WriteTimeCache& times) {
+        if (unit.lastDependencies.empty() || commandHash != unit.commandHash) {
+            return false;
+        }
+
+        std::error_code error;
+        fs::file_time_type objectTime = fs::last_write_time(unit.object, error);
+        if (error) {
+            return false;
+        }
+        for (const std::string& dependency : unit.lastDependencies) {
+            if (times.Get(dependency) > objectTime) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Paths inside the build directory are hashed relative to it, so games
+    // built from the same sources under other names share entries
+    bool GetObjectKey(uint64_t toolchainKey, const std::string& root, const BuildUnit& unit,
+        const std::vector<std::string>& dependencies, ContentHashCache& hashes, uint64_t& key) {
+        key = HashString(unit.name, toolchainKey);
+        for (const std::string& dependency : dependencies) {
+            uint64_t contentHash = 0;
+            if (!hashes.Get(dependency, contentHash)) {
+                return false;
+            }
+            std::string_view path = dependency;
+            if (path.compare(0, root.size(), root) == 0) {
+                path.remove_prefix(root.size());
+            }
+            key = CombineHash(HashString(path, key), contentHash);
+        }
+        return !dependencies.empty();
+    }
+
+    bool WriteRecord(const BuildUnit& unit, const std::vector<std::string>& dependencies) {
+        std::ofstream record(unit.record, std::ios::out | std::ios::trunc);
+        record << std::hex << unit.commandHash << "\n";
+        for (const std::string& dependency : dependencies) {
+            record << dependency << "\n";
+        }
+        record.close();
+        return !record.fail();
+    }
+
+    std::string FormatSeconds(double seconds) {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(2) << seconds << " s";
+        return text.str();
+    }
+
+}
+
+BuildToolchain GetDefaultToolchain() {
+    BuildToolchain toolchain;
+#ifdef _WIN32
+    toolchain.style = ToolchainStyle::Msvc;
+    toolchain.compiler = "cl.exe";
+    toolchain.compileFlags = "/EHsc /O2 /std:c++17 /DUNICODE /D_UNICODE";
+    toolchain.linkFlags = "user32.lib gdi32.lib";
+#else
+    toolchain.style = ToolchainStyle::Gnu;
+    const char* compiler = std::getenv("CXX");
+    toolchain.compiler = compiler && *compiler ? compiler : "g++";
+    toolchain.compileFlags = "-std=c++17 -O2";
+    if (const char* flags = std::getenv("CXXFLAGS")) {
+        toolchain.compileFlags += std::string(" ") + flags;
+    }
+    if (const char* flags = std::getenv("LDFLAGS")) {
+        toolchain.linkFlags = flags;
+    }
+#endif
+    return toolchain;
+}
+
+bool BuildDirectory(const fs::path& directory, const std::string& outputName, const BuildToolchain& toolchain,
+    const BuildLogCallback& log, GameBuildStats& stats, const BuildHooks& hooks) {
+    stats = GameBuildStats();
+    const BuildProgressCallback& progress = hooks.progress;
+    const BuildCancelCallback& cancel = hooks.cancel;
+    CompileCache* cache = hooks.cache;
+
+    // Absolute paths make the compiler report absolute dependencies, so the
+    // records do not depend on the editor's working directory
+    fs::path root = fs::absolute(directory);
+    fs::path objectDir = root / BUILD_OBJECT_DIR;
+    bool msvc = toolchain.style == ToolchainStyle::Msvc;
+
+    std::vector<BuildUnit> units;
+    for (auto it = fs::recursive_directory_iterator(root); it != fs::recursive_directory_iterator(); ++it) {
+        if (it->is_directory() && it->path() == objectDir) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        if (!it->is_regular_file() || it->path().extension() != ".cpp") {
+            continue;
+        }
+
+        BuildUnit unit;
+        fs::path relative = it->path().lexically_relative(root);
+        unit.name = relative.generic_string();
+        unit.source = it->path();
+        unit.object = objectDir / relative;
+        unit.object.replace_extension(msvc ? ".obj" : ".o");
+        unit.record = unit.object;
+        unit.record += ".deps";
+        if (msvc) {
+            unit.command = toolchain.compiler + " /nologo " + toolchain.compileFlags + " /showIncludes /c " + Quote(unit.source)
+                + " /Fo" + Quote(unit.object);
+        }
+        else {
+            unit.depFile = unit.object;
+            unit.depFile += ".d";
+            unit.command = toolchain.compiler + " " + toolchain.compileFlags + " -MMD -MF " + Quote(unit.depFile) + " -c "
+                + Quote(unit.source) + " -o " + Quote(unit.object);
+        }
+        unit.commandHash = HashString(unit.command);
+        units.push_back(std::move(unit));
+    }
+    std::sort(units.begin(), units.end(), [](const BuildUnit& a, const BuildUnit& b) { return a.name < b.name; });
+
+    if (units.empty()) {
+        log("No source files to build.");
+        return false;
+    }
+
+    std::vector<const BuildUnit*> stale;
+    WriteTimeCache times;
+    for (BuildUnit& unit : units) {
+        uint64_t commandHash = ReadRecord(unit.record, unit.lastDependencies);
+        if (IsUpToDate(unit, commandHash, times)) {
+            ++stats.upToDate;
+        }
+        else {
+            fs::create_directories(unit.object.parent_path());
+            stale.push_back(&unit);
+        }
+    }
+
+    // Cache keys start from everything in the toolchain that shapes objects
+    uint64_t toolchainKey = HashString(toolchain.compileFlags, HashString(toolchain.compiler, static_cast<uint64_t>(toolchain.style)));
+    std::string rootText = root.string();
+    ContentHashCache contentHashes;
+
+    // Each task spends its time waiting on a compiler process; the pool's
+    // size is the number of compilers running at once
+    if (progress) {
+        progress(0, stale.size());
+    }
+    if (!stale.empty()) {
+        std::mutex logMutex;
+        size_t finished = 0;
+        ThreadPool jobs(toolchain.jobs);
+        jobs.ParallelFor(stale.size(), [&](size_t index) {
+            const BuildUnit& unit = *stale[index];
+            if (cancel && cancel()) {
+                std::lock_guard<std::mutex> lock(logMutex);
+                stats.cancelled = true;
+                return;
+            }
+
+            // The record names every file the last compile read; if their
+            // contents match a compile the cache has seen, so does the object
+            uint64_t key = 0;
+            if (cache && GetObjectKey(toolchainKey, rootText, unit, unit.lastDependencies, contentHashes, key)
+                && cache->Fetch(key, unit.object) && WriteRecord(unit, unit.lastDependencies)) {
+                std::lock_guard<std::mutex> lock(logMutex);
+                ++finished;
+                ++stats.cached;
+                log("[" + std::to_string(finished) + "/" + std::to_string(stale.size()) + "] " + unit.name + " (cached)");
+                if (progress) {
+                    progress(finished, stale.size());
+                }
+                return;
+            }
+            auto start = std::chrono::steady_clock::now();
+
+            std::string output;
+            int exitCode = RunCommand(unit.command, output);
+            std::vector<std::string> reported;
+            if (msvc) {
+                output = TakeShowIncludes(output, unit.source.filename().string(), reported);
+            }
+            else {
+                std::ifstream depFile(unit.depFile);
+                std::stringstream text;
+                text << depFile.rdbuf();
+                depFile.close();
+                reported = ParseMakeDependencies(text.str());
+                std::error_code error;
+                fs::remove(unit.depFile, error);
+            }
+            std::vector<std::string> dependencies(1, unit.source.string());
+            for (std::string& dependency : reported) {
+                if (dependency != dependencies.front()) {
+                    dependencies.push_back(std::move(dependency));
+                }
+            }
+
+            // A unit without a record is rebuilt next time, so a failed or
+            // unrecorded compile is never mistaken for an up-to-date one
+            std::error_code objectError;
+            bool succeeded = exitCode == 0 && fs::exists(unit.object, objectError) && WriteRecord(unit, dependencies);
+            if (!succeeded) {
+                std::error_code error;
+                fs::remove(unit.record, error);
+            }
+            else if (cache && GetObjectKey(toolchainKey, rootText, unit, dependencies, contentHashes, key)) {
+                cache->Store(key, unit.object);
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard<std::mutex> lock(logMutex);
+            ++finished;
+            std::string counter = "[" + std::to_string(finished) + "/" + std::to_string(stale.size()) + "] " + unit.name;
+            if (succeeded) {
+                ++stats.compiled;
+                log(counter + " (" + FormatSeconds(seconds) + ")");
+            }
+            else {
+                ++stats.failed;
+                log(counter + " failed with exit code " + std::to_string(exitCode));
+            }
+            if (!output.empty()) {
+                log(output);
+            }
+            if (progress) {
+                progress(finished, stale.size());
+            }
+        });
+    }
+
+    if (stats.cancelled || (cancel && cancel())) {
+        stats.cancelled = true;
+        log("Build cancelled.");
+        return false;
+    }
+    if (stats.failed > 0) {
+        return false;
+    }
+
+    fs::path executable = root / outputName;
+    if (msvc) {
+        executable += ".exe";
+    }
+
+    std::error_code error;
+    fs::file_time_type executableTime = fs::last_write_time(executable, error);
+    bool relink = error || stats.compiled > 0 || stats.cached > 0;
+    for (size_t i = 0; i < units.size() && !relink; ++i) {
+        relink = fs::last_write_time(units[i].object) > executableTime;
+    }
+    if (!relink) {
+        log(executable.filename().string() + " is up to date.");
+        return true;
+    }
+
+    // Recompiled objects often come out byte for byte the same, and then so
+    // does the executable
+    uint64_t linkKey = HashString(outputName, HashString(toolchain.linkFlags, toolchainKey));
+    bool linkKeyed = cache != nullptr;
+    for (size_t i = 0; i < units.size() && linkKeyed; ++i) {
+        uint64_t contentHash = 0;
+        linkKeyed = contentHashes.Get(units[i].object.string(), contentHash);
+        linkKey = CombineHash(HashString(units[i].name, linkKey), contentHash);
+    }
+    if (linkKeyed && cache->Fetch(linkKey, executable)) {
+        stats.linked = true;
+        log("Linked " + executable.filename().string() + " (cached)");
+        return true;
+    }
+
+    // Objects go through a response file so the command line stays short
+    // however many units there are; both toolsets read "@file"
+    fs::path responseFile = objectDir / "link.rsp";
+    {
+        std::ofstream response(responseFile, std::ios::out | std::ios::trunc);
+        for (const BuildUnit& unit : units) {
+            response << "\"" << unit.object.generic_string() << "\"\n";
+        }
+        response.close();
+        if (response.fail()) {
+            throw fs::filesystem_error("Failed to write link response file", responseFile, std::make_error_code(std::errc::io_error));
+        }
+    }
+
+    std::string command;
+    if (msvc) {
+        command = toolchain.compiler + " /nologo " + toolchain.compileFlags + " @" + Quote(responseFile) + " /Fe" + Quote(executable)
+            + " " + toolchain.linkFlags;
+    }
+    else {
+        command = toolchain.compiler + " " + toolchain.compileFlags + " @" + Quote(responseFile) + " -o " + Quote(executable)
+            + " " + toolchain.linkFlags;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string output;
+    int exitCode = RunCommand(command, output);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (exitCode != 0) {
+        log("Linking " + executable.filename().string() + " failed with exit code " + std::to_string(exitCode));
+    }
+    else {
+        stats.linked = true;
+        log("Linked " + executable.filename().string() + " (" + FormatSeconds(seconds) + ")");
+        if (linkKeyed) {
+            cache->Store(linkKey, executable);
+        }
+    }
+    if (!output.empty()) {
+        log(output);
+    }
+    return exitCode == 0;
+}
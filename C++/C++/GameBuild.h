@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+namespace fs = std::filesystem;
+
+class CompileCache;
+
+// Incremental native build of a game directory
+//
+// Every .cpp under the directory is a translation unit. Units are compiled
+// into BUILD_OBJECT_DIR with up to toolchain.jobs compiler processes running
+// at once, then linked into one executable. Beside each object the build
+// records the command that produced it and every file the compiler read,
+// taken from its dependency output (-MMD for GCC and Clang, /showIncludes
+// for MSVC). A unit is recompiled only when its object is missing, its
+// command changed, or one of those files is newer than the object, and the
+// executable is relinked only when an object is newer than it. With a
+// CompileCache, a unit to rebuild is first looked up by the contents of the
+// files its record lists, and a relink by the contents of the objects.
+
+const char* const BUILD_OBJECT_DIR = "obj";
+
+enum class ToolchainStyle {
+    Gnu,    // g++, clang++
+    Msvc    // cl.exe
+};
+
+struct BuildToolchain {
+    ToolchainStyle style = ToolchainStyle::Gnu;
+    std::string compiler;       // run through the shell; may include a path
+    std::string compileFlags;   // used for compiling and linking
+    std::string linkFlags;      // after the objects, e.g. libraries
+    unsigned jobs = 0;          // compiles at once; 0 uses every core
+};
+
+// cl.exe on Windows. Elsewhere $CXX (g++ when unset) with $CXXFLAGS and
+// $LDFLAGS appended to the defaults.
+BuildToolchain GetDefaultToolchain();
+
+struct GameBuildStats {
+    size_t compiled = 0;
+    size_t cached = 0;      // objects fetched from the cache instead
+    size_t upToDate = 0;
+    size_t failed = 0;
+    bool linked = false;
+    bool cancelled = false;
+};
+
+// Receives progress and compiler output one line or block at a time. Calls
+// come from the compile threads but never overlap.
+typedef std::function<void(const std::string&)> BuildLogCallback;
+// Units finished and units to compile; called like BuildLogCallback
+typedef std::function<void(size_t finished, size_t total)> BuildProgressCallback;
+// Polled before each unit starts and before linking
+typedef std::function<bool()> BuildCancelCallback;
+
+// Optional parts of a build
+struct BuildHooks {
+    BuildProgressCallback progress;
+    BuildCancelCallback cancel;
+    CompileCache* cache = nullptr;
+};
+
+// Builds directory/outputName (".exe" is added for MSVC). Returns false when
+// a unit or the link fails or the build is cancelled; the compiler's
+// messages go to log. Units already compiling when cancel turns true run to
+// the end and keep their records. Throws fs::filesystem_error when the
+// build directory cannot be read or written.
+bool BuildDirectory(const fs::path& directory, const std::string& outputName, const BuildToolchain& toolchain,
+    const BuildLogCallback& log, GameBuildStats& stats, const BuildHooks& hooks = BuildHooks());
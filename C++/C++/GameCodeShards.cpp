@@ -0,0 +1,101 @@
+#include "GameCodeShards.h"
+#include "LevelHash.h"
+#include "LevelNumbers.h"
+#include <algorithm>
+
+namespace {
+
+    // Appends straight to one string reserved up front; a stream costs a
+    // virtual call and a locale lookup for every piece of every line
+    class CodeBuffer {
+    public:
+        explicit CodeBuffer(size_t capacity) { text_.reserve(capacity); }
+
+        CodeBuffer& operator<<(std::string_view text) {
+            text_.append(text.data(), text.size());
+            return *this;
+        }
+        CodeBuffer& operator<<(size_t value) {
+            text_ += std::to_string(value);
+            return *this;
+        }
+        // Shortest text that reads back to the same float
+        CodeBuffer& operator<<(float value) {
+            char buffer[FLOAT_TEXT_MAX];
+            text_.append(buffer, FormatFloat(buffer, value));
+            return *this;
+        }
+
+        std::string Take() { return std::move(text_); }
+
+    private:
+        std::string text_;
+    };
+
+    // Generous for a typical "// Create" comment plus CreateObject call
+    const size_t BYTES_PER_OBJECT = 160;
+
+}
+
+size_t GetGameCodeShardCount(size_t objectCount) {
+    size_t count = 1;
+    while (count < GAME_CODE_MAX_SHARDS && count * GAME_CODE_OBJECTS_PER_SHARD < objectCount) {
+        count *= 2;
+    }
+    return count;
+}
+
+size_t GetGameCodeShard(std::string_view objectName, size_t shardCount) {
+    return static_cast<size_t>(HashString(objectName) % shardCount);
+}
+
+std::string GetGameCodeShardFile(size_t shard) {
+    return std::string(GAME_CODE_SHARD_DIR) + "/Shard" + std::to_string(shard) + ".cpp";
+}
+
+size_t GenerateShardedLevelCode(const LevelData& level, std::vector<std::pair<std::string, std::string>>& files) {
+    ObjectSpan meshes = level.GetObjectsByType(ObjectType::Mesh);
+    size_t shardCount = GetGameCodeShardCount(meshes.size());
+
+    std::vector<std::vector<const LevelObject*>> shards(shardCount);
+    for (const LevelObject* obj : meshes) {
+        shards[GetGameCodeShard(obj->GetName(), shardCount)].push_back(obj);
+    }
+
+    // GameLevel.cpp only runs the shards
+    CodeBuffer initFile(512 + shardCount * 32);
+    initFile << "#include \"Engine.h\"\n";
+    initFile << "#include \"GameLevel.h\"\n\n";
+    initFile << "void GameLevel::Initialize(Engine* engine) {\n";
+    initFile << "    // Generated from level editor; the objects are created in " << GAME_CODE_SHARD_DIR << "\n";
+    for (size_t shard = 0; shard < shardCount; ++shard) {
+        initFile << "    CreateObjects" << shard << "();\n";
+    }
+    initFile << "}\n\n";
+    initFile << "void GameLevel::Update(float deltaTime) {\n";
+    initFile << "    // Custom update logic\n";
+    initFile << "}\n\n";
+    initFile << "void GameLevel::Render() {\n";
+    initFile << "    // Custom render logic\n";
+    initFile << "}\n";
+    files.emplace_back("GameLevel.cpp", initFile.Take());
+
+    for (size_t shard = 0; shard < shardCount; ++shard) {
+        std::vector<const LevelObject*>& objects = shards[shard];
+        std::stable_sort(objects.begin(), objects.end(), [](const LevelObject* a, const LevelObject* b) { return a->GetName() < b->GetName(); });
+
+        CodeBuffer code(256 + objects.size() * BYTES_PER_OBJECT);
+        code << "#include \"../Engine.h\"\n";
+        code << "#include \"../GameLevel.h\"\n\n";
+        code << "void GameLevel::CreateObjects" << shard << "() {\n";
+        for (const LevelObject* obj : objects) {
+            code << "    // Create " << obj->GetName() << "\n";
+            code << "    CreateObject(\"" << obj->GetName() << "\", ";
+            code << "XMFLOAT3(" << obj->GetFloatProperty("posX") << ", " << obj->GetFloatProperty("posY") << ", " << obj->GetFloatProperty("posZ") << "), ";
+            code << "XMFLOAT3(" << obj->GetFloatProperty("rotX") << ", " << obj->GetFloatProperty("rotY") << ", " << obj->GetFloatProperty("rotZ") << "));\n";
+        }
+        code << "}\n";
+        files.emplace_back(GetGameCodeShardFile(shard), code.Take());
+    }
+    return shardCount;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "LevelEditor.h"
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Sharded game code
+//
+// In GameCodeMode::Generated every mesh becomes a line of code. Written into
+// one GameLevel.cpp, a large level keeps a single compiler busy for minutes,
+// so the objects are spread over GAME_CODE_SHARD_DIR/ShardN.cpp, each of
+// which defines GameLevel::CreateObjectsN, and the build compiles the shards
+// in parallel. An object's shard comes from a hash of its name and objects
+// are sorted by name within a shard, so the text does not depend on level
+// order and editing, adding or removing an object rewrites only its shard.
+// The shard count is the power of two that keeps about
+// GAME_CODE_OBJECTS_PER_SHARD objects in each; when the level crosses a
+// threshold every shard is rewritten once.
+
+const char* const GAME_CODE_SHARD_DIR = "GameLevelShards";
+const size_t GAME_CODE_OBJECTS_PER_SHARD = 512;
+const size_t GAME_CODE_MAX_SHARDS = 64;
+
+size_t GetGameCodeShardCount(size_t objectCount);
+size_t GetGameCodeShard(std::string_view objectName, size_t shardCount);
+// Path of the shard's file relative to the game directory
+std::string GetGameCodeShardFile(size_t shard);
+
+// Appends GameLevel.cpp and the shard files. GameLevel.h must declare
+// CreateObjects0 through CreateObjectsN-1 for the returned shard count.
+size_t GenerateShardedLevelCode(const LevelData& level, std::vector<std::pair<std::string, std::string>>& files);
@@ -0,0 +1,63 @@
+#include "LevelArena.h"
+#include <cstdint>
+#include <new>
+
+namespace {
+
+    inline uintptr_t AlignUp(const char* pointer, size_t alignment) {
+        return (reinterpret_cast<uintptr_t>(pointer) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    }
+
+}
+
+LevelArena::LevelArena()
+    : cursor_(nullptr), end_(nullptr), nextBlockSize_(INITIAL_BLOCK_SIZE), reservedBytes_(0), usedBytes_(0), allocationCount_(0) {
+}
+
+LevelArena::~LevelArena() {
+    Release();
+}
+
+void LevelArena::Release() {
+    for (const Block& block : blocks_) {
+        ::operator delete(block.data, std::align_val_t(alignof(std::max_align_t)));
+    }
+    blocks_.clear();
+    cursor_ = nullptr;
+    end_ = nullptr;
+    nextBlockSize_ = INITIAL_BLOCK_SIZE;
+    reservedBytes_ = 0;
+    usedBytes_ = 0;
+    allocationCount_ = 0;
+}
+
+char* LevelArena::AllocateBlock(size_t size) {
+    char* data = static_cast<char*>(::operator new(size, std::align_val_t(alignof(std::max_align_t))));
+    blocks_.push_back({ data, size });
+    reservedBytes_ += size;
+    return data;
+}
+
+void* LevelArena::do_allocate(size_t bytes, size_t alignment) {
+    ++allocationCount_;
+
+    // Large requests get their own block and leave the current one in place
+    if (bytes + alignment > nextBlockSize_ / 2) {
+        usedBytes_ += bytes;
+        return reinterpret_cast<void*>(AlignUp(AllocateBlock(bytes + alignment), alignment));
+    }
+
+    uintptr_t aligned = AlignUp(cursor_, alignment);
+    if (!cursor_ || aligned + bytes > reinterpret_cast<uintptr_t>(end_)) {
+        cursor_ = AllocateBlock(nextBlockSize_);
+        end_ = cursor_ + nextBlockSize_;
+        if (nextBlockSize_ < MAX_BLOCK_SIZE) {
+            nextBlockSize_ *= 2;
+        }
+        aligned = AlignUp(cursor_, alignment);
+    }
+
+    usedBytes_ += aligned + bytes - reinterpret_cast<uintptr_t>(cursor_);
+    cursor_ = reinterpret_cast<char*>(aligned + bytes);
+    return reinterpret_cast<void*>(aligned);
+}
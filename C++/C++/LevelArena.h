@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Monotonic allocator backing a level's objects
+//
+// Hands out memory from large blocks and never frees single allocations;
+// Release() drops every block at once. Block sizes double from
+// INITIAL_BLOCK_SIZE up to MAX_BLOCK_SIZE, so filling the arena costs a
+// handful of heap allocations however many small requests it serves.
+// Requests larger than half a block get a block of their own. Not thread-safe.
+class LevelArena : public std::pmr::memory_resource {
+public:
+    LevelArena();
+    ~LevelArena();
+
+    LevelArena(const LevelArena&) = delete;
+    LevelArena& operator=(const LevelArena&) = delete;
+
+    void Release();
+
+    size_t GetBlockCount() const { return blocks_.size(); }
+    size_t GetReservedBytes() const { return reservedBytes_; }
+    size_t GetUsedBytes() const { return usedBytes_; }  // including alignment padding
+    size_t GetAllocationCount() const { return allocationCount_; }
+
+private:
+    static const size_t INITIAL_BLOCK_SIZE = 64 * 1024;
+    static const size_t MAX_BLOCK_SIZE = 4 * 1024 * 1024;
+
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    char* AllocateBlock(size_t size);
+
+    std::vector<Block> blocks_;
+    char* cursor_;
+    char* end_;
+    size_t nextBlockSize_;
+    size_t reservedBytes_;
+    size_t usedBytes_;
+    size_t allocationCount_;
+};
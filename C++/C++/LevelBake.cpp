@@ -0,0 +1,170 @@
+#include "LevelBake.h"
+#include <cstring>
+
+namespace {
+
+    template <typename T>
+    void AppendRecord(std::string& out, const T& record) {
+        out.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+
+    uint32_t AppendString(std::string& strings, std::string_view text) {
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.append(text.data(), text.size());
+        return offset;
+    }
+
+    // Kept in step with the structs in LevelBake.h; the static_asserts in
+    // the generated code fail the game's build if the two drift apart
+    const char* const BAKED_LEVEL_LOADER = R"(#include "GameLevel.h"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+    const uint32_t BAKED_LEVEL_MAGIC = 0x4B425550;
+    const uint32_t BAKED_LEVEL_VERSION = 1;
+
+    struct BakedLevelHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t objectCount;
+        uint32_t settingCount;
+        uint32_t stringBytes;
+        uint32_t reserved;
+    };
+
+    struct BakedObject {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        float position[3];
+        float rotation[3];
+    };
+
+    struct BakedSetting {
+        uint32_t keyOffset;
+        uint32_t keyLength;
+        uint32_t valueOffset;
+        uint32_t valueLength;
+    };
+
+    static_assert(sizeof(BakedLevelHeader) == 24, "BakedLevelHeader layout changed");
+    static_assert(sizeof(BakedObject) == 32, "BakedObject layout changed");
+    static_assert(sizeof(BakedSetting) == 16, "BakedSetting layout changed");
+
+    std::filesystem::path GetAssetPath() {
+        wchar_t path[MAX_PATH];
+        DWORD length = GetModuleFileNameW(nullptr, path, MAX_PATH);
+        return std::filesystem::path(std::wstring(path, length)).replace_filename("GameLevel.dat");
+    }
+
+    bool InStrings(uint32_t offset, uint32_t length, uint32_t stringBytes) {
+        return offset <= stringBytes && length <= stringBytes - offset;
+    }
+
+}
+
+void GameLevel::Initialize(Engine* engine) {
+    engine_ = engine;
+
+    std::ifstream file(GetAssetPath(), std::ios::in | std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    BakedLevelHeader header = {};
+    if (data.size() < sizeof(header)) {
+        return;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    size_t settingsOffset = sizeof(header) + header.objectCount * sizeof(BakedObject);
+    size_t stringsOffset = settingsOffset + header.settingCount * sizeof(BakedSetting);
+    if (header.magic != BAKED_LEVEL_MAGIC || header.version != BAKED_LEVEL_VERSION || stringsOffset + header.stringBytes != data.size()) {
+        return;
+    }
+    const char* strings = data.data() + stringsOffset;
+
+    for (uint32_t i = 0; i < header.settingCount; ++i) {
+        BakedSetting setting;
+        memcpy(&setting, data.data() + settingsOffset + i * sizeof(setting), sizeof(setting));
+        if (InStrings(setting.keyOffset, setting.keyLength, header.stringBytes) && InStrings(setting.valueOffset, setting.valueLength, header.stringBytes)) {
+            settings_[std::string(strings + setting.keyOffset, setting.keyLength)] = std::string(strings + setting.valueOffset, setting.valueLength);
+        }
+    }
+
+    for (uint32_t i = 0; i < header.objectCount; ++i) {
+        BakedObject object;
+        memcpy(&object, data.data() + sizeof(header) + i * sizeof(object), sizeof(object));
+        if (InStrings(object.nameOffset, object.nameLength, header.stringBytes)) {
+            CreateObject(std::string(strings + object.nameOffset, object.nameLength),
+                XMFLOAT3(object.position[0], object.position[1], object.position[2]),
+                XMFLOAT3(object.rotation[0], object.rotation[1], object.rotation[2]));
+        }
+    }
+}
+
+std::string GameLevel::GetSetting(const std::string& key) const {
+    auto it = settings_.find(key);
+    return it != settings_.end() ? it->second : std::string();
+}
+
+void GameLevel::Update(float deltaTime) {
+    // Custom update logic
+}
+
+void GameLevel::Render() {
+    // Custom render logic
+}
+)";
+
+}
+
+void BakeLevel(const LevelData& level, std::string& out) {
+    ObjectSpan meshes = level.GetObjectsByType(ObjectType::Mesh);
+    const std::map<std::string, std::string>& settings = level.GetSettings();
+
+    std::string strings;
+    out.clear();
+    out.reserve(sizeof(BakedLevelHeader) + meshes.size() * sizeof(BakedObject) + settings.size() * sizeof(BakedSetting));
+
+    BakedLevelHeader header = {};
+    header.magic = BAKED_LEVEL_MAGIC;
+    header.version = BAKED_LEVEL_VERSION;
+    header.objectCount = static_cast<uint32_t>(meshes.size());
+    header.settingCount = static_cast<uint32_t>(settings.size());
+    AppendRecord(out, header);
+
+    // The same values the generated code reads, so both modes build the
+    // same scene
+    for (LevelObject* obj : meshes) {
+        BakedObject object = {};
+        object.nameOffset = AppendString(strings, obj->GetName());
+        object.nameLength = static_cast<uint32_t>(obj->GetName().size());
+        object.position[0] = obj->GetFloatProperty("posX");
+        object.position[1] = obj->GetFloatProperty("posY");
+        object.position[2] = obj->GetFloatProperty("posZ");
+        object.rotation[0] = obj->GetFloatProperty("rotX");
+        object.rotation[1] = obj->GetFloatProperty("rotY");
+        object.rotation[2] = obj->GetFloatProperty("rotZ");
+        AppendRecord(out, object);
+    }
+
+    for (const auto& [key, value] : settings) {
+        BakedSetting setting = {};
+        setting.keyOffset = AppendString(strings, key);
+        setting.keyLength = static_cast<uint32_t>(key.size());
+        setting.valueOffset = AppendString(strings, value);
+        setting.valueLength = static_cast<uint32_t>(value.size());
+        AppendRecord(out, setting);
+    }
+
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+    memcpy(&out[0], &header, sizeof(header));
+    out += strings;
+}
+
+void WriteBakedLevelLoader(std::ostream& out) {
+    out << BAKED_LEVEL_LOADER;
+}
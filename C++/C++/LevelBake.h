@@ -0,0 +1,59 @@
+#pragma once
+
+#include "LevelEditor.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Baked level asset
+//
+// In GameCodeMode::Baked the compiler writes the level into BAKED_LEVEL_FILE
+// beside the game and generates a GameLevel that loads it at startup, so the
+// game's code does not depend on the level and editing content rebuilds
+// nothing. Layout, all integers little-endian:
+//
+//   BakedLevelHeader
+//   BakedObject[objectCount]      meshes, in level order
+//   BakedSetting[settingCount]    level settings, sorted by key
+//   char[stringBytes]             names, keys and values; offsets index here
+//
+// The loader written by WriteBakedLevelLoader declares the same structs and
+// checks their sizes against the numbers asserted below.
+
+const char* const BAKED_LEVEL_FILE = "GameLevel.dat";
+const uint32_t BAKED_LEVEL_MAGIC = 0x4B425550; // "PUBK"
+const uint32_t BAKED_LEVEL_VERSION = 1;
+
+struct BakedLevelHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t objectCount;
+    uint32_t settingCount;
+    uint32_t stringBytes;
+    uint32_t reserved;
+};
+
+struct BakedObject {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    float position[3];
+    float rotation[3];
+};
+
+struct BakedSetting {
+    uint32_t keyOffset;
+    uint32_t keyLength;
+    uint32_t valueOffset;
+    uint32_t valueLength;
+};
+
+static_assert(sizeof(BakedLevelHeader) == 24, "BakedLevelHeader layout changed");
+static_assert(sizeof(BakedObject) == 32, "BakedObject layout changed");
+static_assert(sizeof(BakedSetting) == 16, "BakedSetting layout changed");
+
+// Replaces out with the level's asset
+void BakeLevel(const LevelData& level, std::string& out);
+
+// GameLevel.cpp for a baked game: reads the asset next to the executable and
+// creates its objects. The text never depends on the level.
+void WriteBakedLevelLoader(std::ostream& out);
@@ -0,0 +1,330 @@
+#include "LevelBinary.h"
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    const size_t SECTION_ALIGNMENT = 8;
+    const uint32_t SECTION_COUNT = 4;
+
+    uint64_t AlignSection(uint64_t offset) {
+        return (offset + SECTION_ALIGNMENT - 1) & ~static_cast<uint64_t>(SECTION_ALIGNMENT - 1);
+    }
+
+    // Builds the string table, sharing storage between identical strings
+    class StringTableBuilder {
+    public:
+        BinaryStringRef Add(std::string_view text) {
+            std::string value(text);
+            uint32_t length = static_cast<uint32_t>(value.size());
+            auto it = offsets_.find(value);
+            if (it != offsets_.end()) {
+                return { it->second, length };
+            }
+
+            uint32_t offset = static_cast<uint32_t>(data_.size());
+            data_.insert(data_.end(), value.begin(), value.end());
+            offsets_.emplace(std::move(value), offset);
+            return { offset, length };
+        }
+
+        const std::vector<char>& GetData() const { return data_; }
+
+    private:
+        std::vector<char> data_;
+        std::unordered_map<std::string, uint32_t> offsets_;
+    };
+
+    void WritePadding(std::ofstream& file, uint64_t from, uint64_t to) {
+        static const char zeros[SECTION_ALIGNMENT] = {};
+        file.write(zeros, static_cast<std::streamsize>(to - from));
+    }
+
+}
+
+// Implementation of MappedLevelFile
+MappedLevelFile::MappedLevelFile()
+    : file_(INVALID_HANDLE_VALUE), mapping_(nullptr), data_(nullptr), size_(0),
+      objects_(nullptr), properties_(nullptr), settings_(nullptr), strings_(nullptr),
+      objectCount_(0), propertyCount_(0), settingCount_(0), stringsSize_(0) {
+}
+
+MappedLevelFile::~MappedLevelFile() {
+    Close();
+}
+
+bool MappedLevelFile::Open(const fs::path& path) {
+    Close();
+
+    file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file_, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(BinaryLevelHeader))) {
+        Close();
+        return false;
+    }
+    size_ = static_cast<uint64_t>(fileSize.QuadPart);
+
+    mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_) {
+        Close();
+        return false;
+    }
+
+    data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_ || !Validate()) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedLevelFile::Close() {
+    if (data_) {
+        UnmapViewOfFile(data_);
+        data_ = nullptr;
+    }
+    if (mapping_) {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+    if (file_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+    }
+
+    size_ = 0;
+    objects_ = nullptr;
+    properties_ = nullptr;
+    settings_ = nullptr;
+    strings_ = nullptr;
+    objectCount_ = propertyCount_ = settingCount_ = 0;
+    stringsSize_ = 0;
+}
+
+bool MappedLevelFile::Validate() {
+    const BinaryLevelHeader* header = reinterpret_cast<const BinaryLevelHeader*>(data_);
+    if (header->magic != LEVEL_BINARY_MAGIC || header->version != LEVEL_BINARY_VERSION || header->fileSize != size_) {
+        return false;
+    }
+
+    uint64_t directoryEnd = sizeof(BinaryLevelHeader) + static_cast<uint64_t>(header->sectionCount) * sizeof(BinarySectionEntry);
+    if (directoryEnd > size_) {
+        return false;
+    }
+
+    // Resolve sections from the offset directory, checking every section stays inside the file
+    const BinarySectionEntry* directory = reinterpret_cast<const BinarySectionEntry*>(data_ + sizeof(BinaryLevelHeader));
+    for (uint32_t i = 0; i < header->sectionCount; ++i) {
+        const BinarySectionEntry& section = directory[i];
+        if (section.offset < directoryEnd || section.offset > size_ || section.size > size_ - section.offset ||
+            section.offset % SECTION_ALIGNMENT != 0) {
+            return false;
+        }
+
+        const char* base = data_ + section.offset;
+        switch (section.id) {
+        case LevelSection::Objects:
+            if (section.size != static_cast<uint64_t>(section.count) * sizeof(BinaryObjectRecord)) return false;
+            objects_ = reinterpret_cast<const BinaryObjectRecord*>(base);
+            objectCount_ = section.count;
+            break;
+        case LevelSection::Properties:
+            if (section.size != static_cast<uint64_t>(section.count) * sizeof(BinaryPropertyRecord)) return false;
+            properties_ = reinterpret_cast<const BinaryPropertyRecord*>(base);
+            propertyCount_ = section.count;
+            break;
+        case LevelSection::Settings:
+            if (section.size != static_cast<uint64_t>(section.count) * sizeof(BinarySettingRecord)) return false;
+            settings_ = reinterpret_cast<const BinarySettingRecord*>(base);
+            settingCount_ = section.count;
+            break;
+        case LevelSection::Strings:
+            strings_ = base;
+            stringsSize_ = section.size;
+            break;
+        default:
+            // Unknown sections are skipped so newer writers stay readable
+            break;
+        }
+    }
+
+    if (!objects_ || !properties_ || !settings_ || !strings_) {
+        return false;
+    }
+
+    // Check every record once here so accessors can stay unchecked
+    auto validString = [this](const BinaryStringRef& ref) {
+        return static_cast<uint64_t>(ref.offset) + ref.length <= stringsSize_;
+    };
+
+    for (uint32_t i = 0; i < objectCount_; ++i) {
+        const BinaryObjectRecord& record = objects_[i];
+        if (!validString(record.name) || record.type >= OBJECT_TYPE_COUNT ||
+            static_cast<uint64_t>(record.firstProperty) + record.propertyCount > propertyCount_) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < propertyCount_; ++i) {
+        if (!validString(properties_[i].key) || !validString(properties_[i].value)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < settingCount_; ++i) {
+        if (!validString(settings_[i].key) || !validString(settings_[i].value)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool IsBinaryLevelFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    return file.gcount() == sizeof(magic) && magic == LEVEL_BINARY_MAGIC;
+}
+
+// Binary I/O for LevelData
+bool LevelData::SaveToBinaryFile(const fs::path& path) const {
+    StringTableBuilder strings;
+    std::vector<BinaryObjectRecord> objectRecords;
+    std::vector<BinaryPropertyRecord> propertyRecords;
+    std::vector<BinarySettingRecord> settingRecords;
+
+    objectRecords.reserve(objects_.size());
+    PropertyOrder order;
+    for (const auto& obj : objects_) {
+        BinaryObjectRecord record = {};
+        record.name = strings.Add(obj->GetName());
+        record.type = static_cast<uint32_t>(obj->GetType());
+        for (int i = 0; i < 3; ++i) {
+            record.position[i] = obj->GetPosition()[i];
+            record.rotation[i] = obj->GetRotation()[i];
+            record.scale[i] = obj->GetScale()[i];
+        }
+
+        record.firstProperty = static_cast<uint32_t>(propertyRecords.size());
+        obj->GetPropertyOrder(order);
+        for (uint32_t p : order) {
+            propertyRecords.push_back({ strings.Add(obj->GetPropertyKey(p)), strings.Add(obj->GetPropertyText(p)) });
+        }
+        record.propertyCount = static_cast<uint32_t>(propertyRecords.size()) - record.firstProperty;
+
+        objectRecords.push_back(record);
+    }
+
+    for (const auto& [key, value] : settings_) {
+        settingRecords.push_back({ strings.Add(key), strings.Add(value) });
+    }
+
+    // Lay out the sections behind the header and offset directory
+    BinarySectionEntry directory[SECTION_COUNT] = {};
+    directory[0] = { LevelSection::Objects, static_cast<uint32_t>(objectRecords.size()), 0, objectRecords.size() * sizeof(BinaryObjectRecord) };
+    directory[1] = { LevelSection::Properties, static_cast<uint32_t>(propertyRecords.size()), 0, propertyRecords.size() * sizeof(BinaryPropertyRecord) };
+    directory[2] = { LevelSection::Settings, static_cast<uint32_t>(settingRecords.size()), 0, settingRecords.size() * sizeof(BinarySettingRecord) };
+    directory[3] = { LevelSection::Strings, 0, 0, strings.GetData().size() };
+
+    uint64_t offset = sizeof(BinaryLevelHeader) + sizeof(directory);
+    for (auto& section : directory) {
+        offset = AlignSection(offset);
+        section.offset = offset;
+        offset += section.size;
+    }
+
+    BinaryLevelHeader header = {};
+    header.magic = LEVEL_BINARY_MAGIC;
+    header.version = LEVEL_BINARY_VERSION;
+    header.sectionCount = SECTION_COUNT;
+    header.fileSize = offset;
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(directory), sizeof(directory));
+
+    const char* sectionData[SECTION_COUNT] = {
+        reinterpret_cast<const char*>(objectRecords.data()),
+        reinterpret_cast<const char*>(propertyRecords.data()),
+        reinterpret_cast<const char*>(settingRecords.data()),
+        strings.GetData().data()
+    };
+
+    uint64_t written = sizeof(BinaryLevelHeader) + sizeof(directory);
+    for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+        WritePadding(file, written, directory[i].offset);
+        file.write(sectionData[i], static_cast<std::streamsize>(directory[i].size));
+        written = directory[i].offset + directory[i].size;
+    }
+
+    file.close();
+    return !file.fail();
+}
+
+bool LevelData::LoadFromBinaryFile(const fs::path& path) {
+    MappedLevelFile mapped;
+    if (!mapped.Open(path)) {
+        return false;
+    }
+
+    // Clear existing data
+    Clear();
+
+    Reserve(mapped.GetObjectCount());
+    for (uint32_t i = 0; i < mapped.GetObjectCount(); ++i) {
+        const BinaryObjectRecord& record = mapped.GetObjectRecord(i);
+
+        Transform transform;
+        transform.position = { record.position[0], record.position[1], record.position[2] };
+        transform.rotation = { record.rotation[0], record.rotation[1], record.rotation[2] };
+        transform.scale = { record.scale[0], record.scale[1], record.scale[2] };
+
+        // Create in place so properties intern straight into the level's pool
+        LevelObject* added = CreateLoadedObject(mapped.GetString(record.name), static_cast<ObjectType>(record.type), transform);
+        if (!added) {
+            continue;
+        }
+
+        const BinaryPropertyRecord* properties = mapped.GetProperties(record);
+        for (uint32_t p = 0; p < record.propertyCount; ++p) {
+            added->SetProperty(mapped.GetString(properties[p].key), mapped.GetString(properties[p].value));
+        }
+    }
+
+    for (uint32_t i = 0; i < mapped.GetSettingCount(); ++i) {
+        const BinarySettingRecord& setting = mapped.GetSettingRecord(i);
+        settings_[std::string(mapped.GetString(setting.key))] = std::string(mapped.GetString(setting.value));
+    }
+
+    return true;
+}
+
+bool ConvertTextLevelToBinary(const fs::path& textPath, const fs::path& binaryPath) {
+    LevelData level;
+    if (!level.LoadFromFile(textPath)) {
+        return false;
+    }
+    return level.SaveToBinaryFile(binaryPath);
+}
+
+bool ConvertBinaryLevelToText(const fs::path& binaryPath, const fs::path& textPath) {
+    LevelData level;
+    if (!level.LoadFromBinaryFile(binaryPath)) {
+        return false;
+    }
+    return level.SaveToFile(textPath);
+}
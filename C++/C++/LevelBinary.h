@@ -0,0 +1,119 @@
+#pragma once
+
+#include "LevelEditor.h"
+#include <cstdint>
+#include <string_view>
+
+// Binary level format
+//
+// A binary level is laid out so it can be memory-mapped and read in place:
+//
+//   BinaryLevelHeader
+//   BinarySectionEntry[sectionCount]   (offset directory)
+//   BinaryObjectRecord[objectCount]    (fixed-size object records)
+//   BinaryPropertyRecord[...]          (object properties, grouped per object)
+//   BinarySettingRecord[...]           (level settings)
+//   char[]                             (string table for names, keys and values)
+//
+// All offsets are absolute file offsets, all integers are little-endian and
+// every section starts on an 8 byte boundary.
+
+const uint32_t LEVEL_BINARY_MAGIC = 0x424C5550; // "PULB"
+const uint32_t LEVEL_BINARY_VERSION = 1;
+
+enum class LevelSection : uint32_t {
+    Objects = 1,
+    Properties = 2,
+    Settings = 3,
+    Strings = 4
+};
+
+struct BinaryLevelHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t reserved;
+    uint64_t fileSize;
+};
+
+struct BinarySectionEntry {
+    LevelSection id;
+    uint32_t count;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Reference into the string table (offset is relative to the table start)
+struct BinaryStringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct BinaryObjectRecord {
+    BinaryStringRef name;
+    uint32_t type;
+    float position[3];
+    float rotation[3];
+    float scale[3];
+    uint32_t firstProperty;
+    uint32_t propertyCount;
+};
+
+struct BinaryPropertyRecord {
+    BinaryStringRef key;
+    BinaryStringRef value;
+};
+
+typedef BinaryPropertyRecord BinarySettingRecord;
+
+static_assert(sizeof(BinaryLevelHeader) == 24, "BinaryLevelHeader layout changed");
+static_assert(sizeof(BinarySectionEntry) == 24, "BinarySectionEntry layout changed");
+static_assert(sizeof(BinaryObjectRecord) == 56, "BinaryObjectRecord layout changed");
+static_assert(sizeof(BinaryPropertyRecord) == 16, "BinaryPropertyRecord layout changed");
+
+// Read-only memory-mapped view of a binary level file
+class MappedLevelFile {
+public:
+    MappedLevelFile();
+    ~MappedLevelFile();
+
+    MappedLevelFile(const MappedLevelFile&) = delete;
+    MappedLevelFile& operator=(const MappedLevelFile&) = delete;
+
+    bool Open(const fs::path& path);
+    void Close();
+    bool IsOpen() const { return data_ != nullptr; }
+
+    uint32_t GetObjectCount() const { return objectCount_; }
+    const BinaryObjectRecord& GetObjectRecord(uint32_t index) const { return objects_[index]; }
+    const BinaryPropertyRecord* GetProperties(const BinaryObjectRecord& record) const { return properties_ + record.firstProperty; }
+
+    uint32_t GetSettingCount() const { return settingCount_; }
+    const BinarySettingRecord& GetSettingRecord(uint32_t index) const { return settings_[index]; }
+
+    std::string_view GetString(const BinaryStringRef& ref) const { return std::string_view(strings_ + ref.offset, ref.length); }
+
+private:
+    bool Validate();
+
+    HANDLE file_;
+    HANDLE mapping_;
+    const char* data_;
+    uint64_t size_;
+
+    const BinaryObjectRecord* objects_;
+    const BinaryPropertyRecord* properties_;
+    const BinarySettingRecord* settings_;
+    const char* strings_;
+    uint32_t objectCount_;
+    uint32_t propertyCount_;
+    uint32_t settingCount_;
+    uint64_t stringsSize_;
+};
+
+// Returns true if the file starts with the binary level magic
+bool IsBinaryLevelFile(const fs::path& path);
+
+// Converters between the LEVEL_FILE_VERSION=1.0 text format and the binary format
+bool ConvertTextLevelToBinary(const fs::path& textPath, const fs::path& binaryPath);
+bool ConvertBinaryLevelToText(const fs::path& binaryPath, const fs::path& textPath);
@@ -0,0 +1,463 @@
+#include "LevelCompression.h"
+#include "LevelTextParser.h"
+#include "ThreadPool.h"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+    const size_t MIN_MATCH = 4;
+    // The format ends every block with literals; matches stop this far from the end
+    const size_t LAST_LITERALS = 5;
+    const size_t MATCH_SEARCH_LIMIT = 12;
+    const size_t MAX_OFFSET = 65535;
+    const int HASH_BITS = 14;
+
+    inline uint32_t Read32(const char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t HashSequence(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // Writes a length that did not fit in its nibble as a run of 255s and a remainder
+    inline bool WriteLength(char*& op, const char* end, size_t length) {
+        while (length >= 255) {
+            if (op == end) {
+                return false;
+            }
+            *op++ = static_cast<char>(255);
+            length -= 255;
+        }
+        if (op == end) {
+            return false;
+        }
+        *op++ = static_cast<char>(length);
+        return true;
+    }
+
+    inline bool ReadLength(const unsigned char*& ip, const unsigned char* end, size_t& length) {
+        unsigned char byte;
+        do {
+            if (ip == end) {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // Emits literals [anchor, literalEnd) followed by a match, or only the
+    // literals when matchLength is 0
+    bool WriteSequence(char*& op, const char* end, const char* anchor, const char* literalEnd, size_t offset, size_t matchLength) {
+        size_t literalCount = static_cast<size_t>(literalEnd - anchor);
+        if (op == end) {
+            return false;
+        }
+        char* token = op++;
+        unsigned char tokenValue = static_cast<unsigned char>((literalCount < 15 ? literalCount : 15) << 4);
+        if (literalCount >= 15 && !WriteLength(op, end, literalCount - 15)) {
+            return false;
+        }
+        if (static_cast<size_t>(end - op) < literalCount) {
+            return false;
+        }
+        std::memcpy(op, anchor, literalCount);
+        op += literalCount;
+
+        if (matchLength != 0) {
+            if (end - op < 2) {
+                return false;
+            }
+            *op++ = static_cast<char>(offset & 0xFF);
+            *op++ = static_cast<char>(offset >> 8);
+            size_t lengthCode = matchLength - MIN_MATCH;
+            tokenValue |= static_cast<unsigned char>(lengthCode < 15 ? lengthCode : 15);
+            if (lengthCode >= 15 && !WriteLength(op, end, lengthCode - 15)) {
+                return false;
+            }
+        }
+        *token = static_cast<char>(tokenValue);
+        return true;
+    }
+
+    bool WriteAll(std::ofstream& file, const void* data, size_t size) {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return !file.fail();
+    }
+
+}
+
+size_t GetCompressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t CompressBlock(const char* source, size_t size, char* destination, size_t capacity) {
+    const char* ip = source;
+    const char* anchor = source;
+    const char* sourceEnd = source + size;
+    char* op = destination;
+    const char* destinationEnd = destination + capacity;
+
+    if (size > MATCH_SEARCH_LIMIT) {
+        // Positions relative to source; a stale or zero entry is caught by the compare below
+        std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+        const char* matchLimit = sourceEnd - MATCH_SEARCH_LIMIT;
+        const char* lengthLimit = sourceEnd - LAST_LITERALS;
+
+        while (ip < matchLimit) {
+            uint32_t sequence = Read32(ip);
+            uint32_t& slot = table[HashSequence(sequence)];
+            const char* match = source + slot;
+            slot = static_cast<uint32_t>(ip - source);
+
+            if (match >= ip || static_cast<size_t>(ip - match) > MAX_OFFSET || Read32(match) != sequence) {
+                // Step faster through data that keeps failing to match
+                ip += 1 + (static_cast<size_t>(ip - anchor) >> 6);
+                continue;
+            }
+
+            while (ip > anchor && match > source && ip[-1] == match[-1]) {
+                --ip;
+                --match;
+            }
+            size_t length = MIN_MATCH;
+            while (ip + length < lengthLimit && ip[length] == match[length]) {
+                ++length;
+            }
+
+            if (!WriteSequence(op, destinationEnd, anchor, ip, static_cast<size_t>(ip - match), length)) {
+                return 0;
+            }
+            ip += length;
+            anchor = ip;
+            if (ip < matchLimit) {
+                table[HashSequence(Read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - source);
+            }
+        }
+    }
+
+    if (!WriteSequence(op, destinationEnd, anchor, sourceEnd, 0, 0)) {
+        return 0;
+    }
+    return static_cast<size_t>(op - destination);
+}
+
+bool DecompressBlock(const char* source, size_t size, char* destination, size_t rawSize) {
+    const unsigned char* ip = reinterpret_cast<const unsigned char*>(source);
+    const unsigned char* end = ip + size;
+    char* op = destination;
+    char* outEnd = destination + rawSize;
+
+    while (ip < end) {
+        unsigned char token = *ip++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !ReadLength(ip, end, literalCount)) {
+            return false;
+        }
+        if (literalCount > static_cast<size_t>(end - ip) || literalCount > static_cast<size_t>(outEnd - op)) {
+            return false;
+        }
+        std::memcpy(op, ip, literalCount);
+        ip += literalCount;
+        op += literalCount;
+
+        if (ip == end) {
+            break;
+        }
+
+        if (end - ip < 2) {
+            return false;
+        }
+        size_t offset = static_cast<size_t>(ip[0]) | static_cast<size_t>(ip[1]) << 8;
+        ip += 2;
+        size_t length = token & 15;
+        if (length == 15 && !ReadLength(ip, end, length)) {
+            return false;
+        }
+        length += MIN_MATCH;
+        if (offset == 0 || offset > static_cast<size_t>(op - destination) || length > static_cast<size_t>(outEnd - op)) {
+            return false;
+        }
+
+        // Overlapping matches repeat the last offset bytes, so copy forwards
+        const char* match = op - offset;
+        if (offset >= length) {
+            std::memcpy(op, match, length);
+            op += length;
+        }
+        else {
+            for (size_t i = 0; i < length; ++i) {
+                *op++ = *match++;
+            }
+        }
+    }
+    return op == outEnd;
+}
+
+bool IsCompressedLevelFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    return file.gcount() == sizeof(magic) && magic == LEVEL_COMPRESSED_MAGIC;
+}
+
+// Implementation of CompressedLevelWriter
+CompressedLevelWriter::CompressedLevelWriter(ThreadPool& pool, uint32_t blockSize, size_t maxPending)
+    : pool_(pool), blockSize_(blockSize), maxPending_(maxPending < 1 ? 1 : maxPending), rawBytes_(0), storedBytes_(0), failed_(false) {
+    if (blockSize_ == 0 || blockSize_ > MAX_COMPRESSED_BLOCK_SIZE) {
+        blockSize_ = DEFAULT_COMPRESSED_BLOCK_SIZE;
+    }
+}
+
+CompressedLevelWriter::~CompressedLevelWriter() {
+    if (file_.is_open()) {
+        Close();
+    }
+}
+
+bool CompressedLevelWriter::Open(const fs::path& path) {
+    file_.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        return false;
+    }
+
+    CompressedLevelHeader header = { LEVEL_COMPRESSED_MAGIC, LEVEL_COMPRESSED_VERSION, blockSize_, 0 };
+    failed_ = !WriteAll(file_, &header, sizeof(header));
+    storedBytes_ = sizeof(header);
+    buffer_.reserve(blockSize_);
+    return !failed_;
+}
+
+bool CompressedLevelWriter::Close() {
+    if (!buffer_.empty()) {
+        SubmitBlock();
+    }
+    WriteFinished(0);
+
+    CompressedBlockHeader end = { 0, 0 };
+    if (!failed_) {
+        failed_ = !WriteAll(file_, &end, sizeof(end));
+        storedBytes_ += sizeof(end);
+    }
+    file_.close();
+    return !failed_ && !file_.fail();
+}
+
+CompressedLevelWriter::int_type CompressedLevelWriter::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    char c = traits_type::to_char_type(ch);
+    return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+}
+
+std::streamsize CompressedLevelWriter::xsputn(const char* data, std::streamsize count) {
+    std::streamsize written = 0;
+    while (written < count) {
+        size_t room = blockSize_ - buffer_.size();
+        size_t take = static_cast<size_t>(count - written) < room ? static_cast<size_t>(count - written) : room;
+        buffer_.append(data + written, take);
+        written += static_cast<std::streamsize>(take);
+        if (buffer_.size() == blockSize_) {
+            SubmitBlock();
+            if (!WriteFinished(maxPending_ - 1)) {
+                return written;
+            }
+        }
+    }
+    return written;
+}
+
+void CompressedLevelWriter::SubmitBlock() {
+    auto block = std::make_shared<Block>();
+    block->raw.swap(buffer_);
+    buffer_.reserve(blockSize_);
+    rawBytes_ += block->raw.size();
+
+    std::future<void> task = pool_.Submit([block]() {
+        block->stored.resize(GetCompressBound(block->raw.size()));
+        size_t size = CompressBlock(block->raw.data(), block->raw.size(), &block->stored[0], block->stored.size());
+        block->header.rawSize = static_cast<uint32_t>(block->raw.size());
+        if (size == 0 || size >= block->raw.size()) {
+            block->stored.swap(block->raw);
+            block->header.storedSize = static_cast<uint32_t>(block->stored.size()) | STORED_BLOCK_FLAG;
+        }
+        else {
+            block->stored.resize(size);
+            block->header.storedSize = static_cast<uint32_t>(size);
+        }
+    });
+    pending_.emplace_back(std::move(block), std::move(task));
+}
+
+bool CompressedLevelWriter::WriteFinished(size_t keepPending) {
+    // Blocks are written in submission order; waiting on the oldest bounds memory
+    while (pending_.size() > keepPending) {
+        pending_.front().second.get();
+        const Block& block = *pending_.front().first;
+        if (!failed_) {
+            failed_ = !WriteAll(file_, &block.header, sizeof(block.header)) || !WriteAll(file_, block.stored.data(), block.stored.size());
+            storedBytes_ += sizeof(block.header) + block.stored.size();
+        }
+        pending_.pop_front();
+    }
+    return !failed_;
+}
+
+// Implementation of CompressedLevelReader
+CompressedLevelReader::CompressedLevelReader(ThreadPool& pool, size_t readAhead)
+    : pool_(pool), readAhead_(readAhead < 1 ? 1 : readAhead), blockSize_(0), atEnd_(false), failed_(false) {
+}
+
+CompressedLevelReader::~CompressedLevelReader() {
+    // Tasks hold their block through a shared_ptr, but must finish before the pool can be torn down
+    for (auto& entry : pending_) {
+        entry.second.wait();
+    }
+}
+
+bool CompressedLevelReader::Open(const fs::path& path) {
+    file_.open(path, std::ios::in | std::ios::binary);
+    if (!file_.is_open()) {
+        return false;
+    }
+
+    CompressedLevelHeader header = {};
+    file_.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (file_.gcount() != sizeof(header) || header.magic != LEVEL_COMPRESSED_MAGIC || header.version != LEVEL_COMPRESSED_VERSION ||
+        header.blockSize == 0 || header.blockSize > MAX_COMPRESSED_BLOCK_SIZE) {
+        failed_ = true;
+        return false;
+    }
+    blockSize_ = header.blockSize;
+    ReadAhead();
+    return !failed_;
+}
+
+void CompressedLevelReader::ReadAhead() {
+    while (!atEnd_ && !failed_ && pending_.size() < readAhead_) {
+        auto block = std::make_shared<Block>();
+        file_.read(reinterpret_cast<char*>(&block->header), sizeof(block->header));
+        if (file_.gcount() != sizeof(block->header)) {
+            failed_ = true;
+            return;
+        }
+        if (block->header.rawSize == 0) {
+            atEnd_ = true;
+            return;
+        }
+
+        uint32_t storedSize = block->header.storedSize & ~STORED_BLOCK_FLAG;
+        bool stored = (block->header.storedSize & STORED_BLOCK_FLAG) != 0;
+        if (block->header.rawSize > blockSize_ || storedSize > GetCompressBound(blockSize_) || (stored && storedSize != block->header.rawSize)) {
+            failed_ = true;
+            return;
+        }
+        block->stored.resize(storedSize);
+        file_.read(&block->stored[0], storedSize);
+        if (static_cast<uint32_t>(file_.gcount()) != storedSize) {
+            failed_ = true;
+            return;
+        }
+
+        std::future<void> task;
+        if (stored) {
+            block->raw.swap(block->stored);
+            block->ok = true;
+        }
+        else {
+            task = pool_.Submit([block]() {
+                block->raw.resize(block->header.rawSize);
+                block->ok = DecompressBlock(block->stored.data(), block->stored.size(), &block->raw[0], block->raw.size());
+                block->stored.clear();
+            });
+        }
+        pending_.emplace_back(std::move(block), std::move(task));
+    }
+}
+
+bool CompressedLevelReader::Next(std::string& block) {
+    if (pending_.empty()) {
+        return false;
+    }
+
+    auto entry = std::move(pending_.front());
+    pending_.pop_front();
+    if (entry.second.valid()) {
+        entry.second.get();
+    }
+    if (!entry.first->ok) {
+        failed_ = true;
+        return false;
+    }
+    block.swap(entry.first->raw);
+
+    ReadAhead();
+    return true;
+}
+
+// Compressed I/O for LevelData
+bool LevelData::SaveToCompressedFile(const fs::path& path) const {
+    CompressedLevelWriter writer(ThreadPool::GetShared());
+    if (!writer.Open(path)) {
+        return false;
+    }
+
+    // Same text as a snapshot; compressed levels are not journaled
+    std::ostream stream(&writer);
+    WriteText(stream, 0);
+    stream.flush();
+    return !stream.fail() && writer.Close();
+}
+
+bool LevelData::LoadFromCompressedFile(const fs::path& path) {
+    CompressedLevelReader reader(ThreadPool::GetShared());
+    if (!reader.Open(path)) {
+        return false;
+    }
+
+    // Clear existing data
+    Clear();
+
+    // Text up to the last OBJECT line seen so far is parsed and added; the
+    // object that line starts waits for the next block
+    std::string text;
+    std::string block;
+    while (reader.Next(block)) {
+        text += block;
+        size_t split = text.rfind("\nOBJECT");
+        while (split != std::string::npos) {
+            size_t after = split + 7;
+            if (after < text.size() && (text[after] == '\n' || text[after] == '\r')) {
+                break;
+            }
+            split = split == 0 ? std::string::npos : text.rfind("\nOBJECT", split - 1);
+        }
+        if (split == std::string::npos) {
+            continue;
+        }
+
+        LevelTextChunk chunk;
+        ParseLevelText(std::string_view(text).substr(0, split + 1), chunk);
+        AddTextChunk(chunk);
+        text.erase(0, split + 1);
+    }
+    if (reader.Failed()) {
+        return false;
+    }
+
+    LevelTextChunk chunk;
+    ParseLevelText(text, chunk);
+    AddTextChunk(chunk);
+    return true;
+}
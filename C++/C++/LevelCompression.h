@@ -0,0 +1,129 @@
+#pragma once
+
+#include "LevelEditor.h"
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <streambuf>
+#include <string>
+
+// Block-compressed level container
+//
+// A compressed level is the text format cut into blocks that are compressed
+// on their own:
+//
+//   CompressedLevelHeader
+//   per block: CompressedBlockHeader, then storedSize bytes
+//   CompressedBlockHeader with rawSize 0   (end of file)
+//
+// Blocks share no state, so they are compressed and decompressed on a worker
+// pool while the file is written or read in order, and neither side holds
+// more than a few blocks in memory. All integers are little-endian.
+//
+// The codec is a byte-oriented LZ77 in the style of LZ4: each sequence is a
+// token (literal count in the high nibble, match length - 4 in the low one,
+// 15 meaning more length bytes follow), the literals, then a 16-bit match
+// offset. The last sequence of a block has literals only.
+
+const uint32_t LEVEL_COMPRESSED_MAGIC = 0x5A4C5550; // "PULZ"
+const uint32_t LEVEL_COMPRESSED_VERSION = 1;
+const uint32_t DEFAULT_COMPRESSED_BLOCK_SIZE = 256 * 1024;
+const uint32_t MAX_COMPRESSED_BLOCK_SIZE = 64 * 1024 * 1024;
+// Set in storedSize when the block did not compress and is stored as is
+const uint32_t STORED_BLOCK_FLAG = 0x80000000;
+
+struct CompressedLevelHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t blockSize;  // largest rawSize of any block
+    uint32_t reserved;
+};
+
+struct CompressedBlockHeader {
+    uint32_t rawSize;
+    uint32_t storedSize;
+};
+
+static_assert(sizeof(CompressedLevelHeader) == 16, "CompressedLevelHeader layout changed");
+static_assert(sizeof(CompressedBlockHeader) == 8, "CompressedBlockHeader layout changed");
+
+// Largest output CompressBlock can produce for size bytes of input
+size_t GetCompressBound(size_t size);
+// Returns the compressed size, or 0 when the output would not fit in capacity
+size_t CompressBlock(const char* source, size_t size, char* destination, size_t capacity);
+// Fails on malformed input instead of reading or writing out of bounds
+bool DecompressBlock(const char* source, size_t size, char* destination, size_t rawSize);
+
+bool IsCompressedLevelFile(const fs::path& path);
+
+// Output stream buffer that writes the container. Full blocks are compressed
+// on the pool, at most maxPending at a time, and written in order.
+class CompressedLevelWriter : public std::streambuf {
+public:
+    CompressedLevelWriter(ThreadPool& pool, uint32_t blockSize = DEFAULT_COMPRESSED_BLOCK_SIZE, size_t maxPending = 8);
+    ~CompressedLevelWriter();
+
+    bool Open(const fs::path& path);
+    // Flushes the last block and writes the end marker
+    bool Close();
+
+    uint64_t GetRawBytes() const { return rawBytes_; }
+    uint64_t GetStoredBytes() const { return storedBytes_; }
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize count) override;
+
+private:
+    struct Block {
+        std::string raw;
+        std::string stored;
+        CompressedBlockHeader header = {};
+    };
+
+    void SubmitBlock();
+    bool WriteFinished(size_t keepPending);
+
+    ThreadPool& pool_;
+    uint32_t blockSize_;
+    size_t maxPending_;
+    std::ofstream file_;
+    std::string buffer_;
+    std::deque<std::pair<std::shared_ptr<Block>, std::future<void>>> pending_;
+    uint64_t rawBytes_;
+    uint64_t storedBytes_;
+    bool failed_;
+};
+
+// Reads the container block by block. Up to readAhead blocks are read and
+// decompressed on the pool ahead of the one being consumed.
+class CompressedLevelReader {
+public:
+    explicit CompressedLevelReader(ThreadPool& pool, size_t readAhead = 8);
+    ~CompressedLevelReader();
+
+    bool Open(const fs::path& path);
+    // Replaces block with the next block's text; false at the end or on error
+    bool Next(std::string& block);
+    bool Failed() const { return failed_; }
+
+private:
+    struct Block {
+        std::string stored;
+        std::string raw;
+        CompressedBlockHeader header = {};
+        bool ok = false;
+    };
+
+    void ReadAhead();
+
+    ThreadPool& pool_;
+    size_t readAhead_;
+    std::ifstream file_;
+    uint32_t blockSize_;
+    std::deque<std::pair<std::shared_ptr<Block>, std::future<void>>> pending_;
+    bool atEnd_;
+    bool failed_;
+};
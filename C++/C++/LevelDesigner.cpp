@@ -1,11 +1,29 @@
 #include "LevelEditor.h"
+#include "LevelBinary.h"
+#include "LevelXml.h"
+#include "LevelCompression.h"
+#include "LevelNumbers.h"
+#include "FileSync.h"
+#include "ThreadPool.h"
+#include "GameBuild.h"
+#include "LevelBake.h"
+#include "GameCodeShards.h"
+#include "AssetCook.h"
+#include "LevelJournal.h"
+#include "LevelTextParser.h"
 #include <CommCtrl.h>
+#include <commdlg.h>
 #include <windowsx.h>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <map>
+#include <set>
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <cstring>
 #include <filesystem>
 
 // Initialize common controls
@@ -18,61 +36,239 @@ const int WINDOW_HEIGHT = 720;
 
 // Implementation of LevelObject
 LevelObject::LevelObject(const std::string& name, ObjectType type)
-    : name_(name), type_(type) {
-    position_[0] = position_[1] = position_[2] = 0.0f;
-    rotation_[0] = rotation_[1] = rotation_[2] = 0.0f;
-    scale_[0] = scale_[1] = scale_[2] = 1.0f;
+    : type_(type), level_(nullptr), transforms_(nullptr), transformRow_(0), typeSlot_(0), strings_(nullptr),
+    spatialLeaf_(AabbTree::NULL_NODE), journalFlags_(0), hashFlags_(0), snapshotDirty_(false), contentHash_(0), contentCell_(),
+    detached_(std::make_unique<Detached>()) {
+    detached_->name = name;
+    name_ = detached_->name;
+    strings_ = &detached_->strings;
+}
+
+LevelObject::LevelObject(std::string_view storedName, ObjectType type, LevelData* level)
+    : name_(storedName), type_(type), level_(level), transforms_(&level->transforms_), transformRow_(0), typeSlot_(0),
+    strings_(&level->strings_), spatialLeaf_(AabbTree::NULL_NODE), journalFlags_(0), hashFlags_(0), snapshotDirty_(false),
+    contentHash_(0), contentCell_() {
 }
 
 LevelObject::~LevelObject() {
 }
 
+void LevelObject::CopyProperties(const LevelObject& detached) {
+    // Re-intern keys and string values in the level pool; ids change, so re-sort
+    properties_.reserve(detached.properties_.size(), &level_->objectPool_);
+    for (PropertyEntry entry : detached.properties_) {
+        entry.key = strings_->Intern(detached.strings_->Get(entry.key));
+        if (entry.value.type == PropertyType::String) {
+            entry.value.s = strings_->Intern(detached.strings_->Get(entry.value.s));
+        }
+        properties_.push_back(entry);
+    }
+    std::sort(properties_.begin(), properties_.end(), [](const PropertyEntry& a, const PropertyEntry& b) {
+        return a.key < b.key;
+    });
+}
+
 void LevelObject::SetPosition(float x, float y, float z) {
-    position_[0] = x;
-    position_[1] = y;
-    position_[2] = z;
+    if (transforms_) {
+        transforms_->SetPosition(transformRow_, x, y, z);
+        OnTransformChanged();
+    }
+    else {
+        detached_->transform.position = { x, y, z };
+    }
 }
 
 void LevelObject::SetRotation(float x, float y, float z) {
-    rotation_[0] = x;
-    rotation_[1] = y;
-    rotation_[2] = z;
+    if (transforms_) {
+        transforms_->SetRotation(transformRow_, x, y, z);
+        OnTransformChanged();
+    }
+    else {
+        detached_->transform.rotation = { x, y, z };
+    }
 }
 
 void LevelObject::SetScale(float x, float y, float z) {
-    scale_[0] = x;
-    scale_[1] = y;
-    scale_[2] = z;
+    if (transforms_) {
+        transforms_->SetScale(transformRow_, x, y, z);
+        OnTransformChanged();
+    }
+    else {
+        detached_->transform.scale = { x, y, z };
+    }
 }
 
-void LevelObject::SetProperty(const std::string& key, const std::string& value) {
-    properties_[key] = value;
+void LevelObject::OnTransformChanged() {
+    if (level_) {
+        level_->RecordEdit(LevelData::EditKind::Transform, this, 0);
+        level_->UpdateSpatialIndex(this);
+    }
 }
 
-std::string LevelObject::GetProperty(const std::string& key) {
-    auto it = properties_.find(key);
-    if (it != properties_.end()) {
-        return it->second;
+namespace {
+
+    const PropertyEntry* FindEntry(const PropertyList& properties, uint32_t key) {
+        auto it = std::lower_bound(properties.begin(), properties.end(), key, [](const PropertyEntry& entry, uint32_t id) {
+            return entry.key < id;
+        });
+        return it != properties.end() && it->key == key ? it : nullptr;
+    }
+
+}
+
+void LevelObject::StoreProperty(std::string_view key, const PropertyValue& value) {
+    PropertyEntry entry = { strings_->Intern(key), value };
+    auto it = std::lower_bound(properties_.begin(), properties_.end(), entry.key, [](const PropertyEntry& existing, uint32_t id) {
+        return existing.key < id;
+    });
+    if (it != properties_.end() && it->key == entry.key) {
+        it->value = value;
+    }
+    else {
+        uint32_t index = static_cast<uint32_t>(it - properties_.begin());
+        // The first spill of a level object goes to the level's pool, not the heap
+        if (level_ && properties_.size() == properties_.capacity()) {
+            properties_.reserve(properties_.capacity() * 2, &level_->objectPool_);
+        }
+        properties_.insert(index, entry);
+    }
+    if (level_) {
+        level_->RecordEdit(LevelData::EditKind::Property, this, entry.key);
+    }
+}
+
+void LevelObject::SetProperty(std::string_view key, std::string_view value) {
+    StoreProperty(key, ParsePropertyValue(value, *strings_));
+}
+
+void LevelObject::SetProperty(std::string_view key, float value) {
+    StoreProperty(key, PropertyValue::MakeFloat(value));
+}
+
+void LevelObject::SetProperty(std::string_view key, int value) {
+    StoreProperty(key, PropertyValue::MakeInt(value));
+}
+
+void LevelObject::SetProperty(std::string_view key, const Float3& value) {
+    StoreProperty(key, PropertyValue::MakeVec3(value));
+}
+
+bool LevelObject::RemoveProperty(std::string_view key) {
+    const PropertyEntry* entry = FindEntry(properties_, strings_->Find(key));
+    if (!entry) {
+        return false;
+    }
+    uint32_t keyId = entry->key;
+    properties_.erase(static_cast<uint32_t>(entry - properties_.begin()));
+    if (level_) {
+        level_->RecordEdit(LevelData::EditKind::Property, this, keyId);
+    }
+    return true;
+}
+
+const PropertyValue* LevelObject::FindProperty(std::string_view key) const {
+    return FindPropertyById(strings_->Find(key));
+}
+
+const PropertyValue* LevelObject::FindPropertyById(uint32_t keyId) const {
+    const PropertyEntry* entry = FindEntry(properties_, keyId);
+    return entry ? &entry->value : nullptr;
+}
+
+std::string LevelObject::GetProperty(std::string_view key) const {
+    const PropertyValue* value = FindProperty(key);
+    if (value) {
+        return FormatPropertyValue(*value, *strings_);
     }
     return "";
 }
 
-void LevelObject::Serialize(std::ofstream& file) {
-    file << "OBJECT\n";
-    file << "NAME=" << name_ << "\n";
-    file << "TYPE=" << static_cast<int>(type_) << "\n";
-    file << "POSITION=" << position_[0] << "," << position_[1] << "," << position_[2] << "\n";
-    file << "ROTATION=" << rotation_[0] << "," << rotation_[1] << "," << rotation_[2] << "\n";
-    file << "SCALE=" << scale_[0] << "," << scale_[1] << "," << scale_[2] << "\n";
+float LevelObject::GetFloatProperty(std::string_view key, float fallback) const {
+    const PropertyValue* value = FindProperty(key);
+    if (value && value->type == PropertyType::Float) {
+        return value->f;
+    }
+    if (value && value->type == PropertyType::Int) {
+        return static_cast<float>(value->i);
+    }
+    return fallback;
+}
+
+int LevelObject::GetIntProperty(std::string_view key, int fallback) const {
+    const PropertyValue* value = FindProperty(key);
+    return value && value->type == PropertyType::Int ? value->i : fallback;
+}
+
+Float3 LevelObject::GetVec3Property(std::string_view key, const Float3& fallback) const {
+    const PropertyValue* value = FindProperty(key);
+    return value && value->type == PropertyType::Vec3 ? value->v : fallback;
+}
+
+void LevelObject::GetTextView(ObjectTextView& view) const {
+    view.name = name_;
+    view.type = type_;
+    view.transform.position = GetPosition();
+    view.transform.rotation = GetRotation();
+    view.transform.scale = GetScale();
+
+    PropertyOrder order;
+    GetPropertyOrder(order);
+    view.properties.clear();
+    for (uint32_t index : order) {
+        const PropertyEntry& entry = properties_[index];
+        std::string_view text = entry.value.type == PropertyType::String ? strings_->Get(entry.value.s) : std::string_view();
+        view.properties.push_back({ strings_->Get(entry.key), &entry.value, text });
+    }
+}
+
+void LevelObject::Serialize(std::ostream& file) const {
+    ObjectTextView view;
+    GetTextView(view);
+    WriteObjectText(file, view);
+}
 
-    file << "PROPERTIES_COUNT=" << properties_.size() << "\n";
-    for (const auto& [key, value] : properties_) {
-        file << "PROPERTY=" << key << "," << value << "\n";
+void WriteObjectText(std::ostream& file, const ObjectTextView& object) {
+    file << "OBJECT\n";
+    file << "NAME=" << object.name << "\n";
+    file << "TYPE=" << static_cast<int>(object.type) << "\n";
+    file << "POSITION=";
+    WriteFloat3(file, object.transform.position);
+    file << "\nROTATION=";
+    WriteFloat3(file, object.transform.rotation);
+    file << "\nSCALE=";
+    WriteFloat3(file, object.transform.scale);
+    file << "\n";
+
+    // String values come as text, so formatting the others never reads a pool
+    static const StringPool noStrings;
+    file << "PROPERTIES_COUNT=" << object.properties.size() << "\n";
+    for (const ObjectTextView::Property& property : object.properties) {
+        file << "PROPERTY=" << property.key << ",";
+        if (property.value->type == PropertyType::String) {
+            file << property.text;
+        }
+        else {
+            file << FormatPropertyValue(*property.value, noStrings);
+        }
+        file << "\n";
     }
     file << "END_OBJECT\n";
 }
 
-std::unique_ptr<LevelObject> LevelObject::Deserialize(std::ifstream& file) {
+void WriteLevelTextHeader(std::ostream& file, uint64_t journalId, const std::map<std::string, std::string>& settings,
+    size_t objectCount) {
+    file << "LEVEL_FILE_VERSION=1.0\n";
+    file << "JOURNAL_ID=" << journalId << "\n";
+
+    file << "SETTINGS_COUNT=" << settings.size() << "\n";
+    for (const auto& [key, value] : settings) {
+        file << "SETTING=" << key << "," << value << "\n";
+    }
+
+    file << "OBJECTS_COUNT=" << objectCount << "\n";
+}
+
+std::unique_ptr<LevelObject> LevelObject::Deserialize(std::istream& file) {
     std::string line;
     std::string name;
     ObjectType type = ObjectType::Mesh;
@@ -83,11 +279,10 @@ std::unique_ptr<LevelObject> LevelObject::Deserialize(std::ifstream& file) {
 
     // Read object data until END_OBJECT
     while (std::getline(file, line) && line != "END_OBJECT") {
-        std::istringstream iss(line);
-        std::string key;
-
-        if (std::getline(iss, key, '=')) {
-            std::string value = line.substr(key.length() + 1);
+        size_t equals = line.find('=');
+        if (equals != std::string::npos) {
+            std::string_view key = std::string_view(line).substr(0, equals);
+            std::string value = line.substr(equals + 1);
 
             if (key == "NAME") {
                 name = value;
@@ -96,13 +291,13 @@ std::unique_ptr<LevelObject> LevelObject::Deserialize(std::ifstream& file) {
                 type = static_cast<ObjectType>(std::stoi(value));
             }
             else if (key == "POSITION") {
-                sscanf_s(value.c_str(), "%f,%f,%f", &position[0], &position[1], &position[2]);
+                ParseFloatList(value, position, 3);
             }
             else if (key == "ROTATION") {
-                sscanf_s(value.c_str(), "%f,%f,%f", &rotation[0], &rotation[1], &rotation[2]);
+                ParseFloatList(value, rotation, 3);
             }
             else if (key == "SCALE") {
-                sscanf_s(value.c_str(), "%f,%f,%f", &scale[0], &scale[1], &scale[2]);
+                ParseFloatList(value, scale, 3);
             }
             else if (key == "PROPERTY") {
                 size_t commaPos = value.find(",");
@@ -129,46 +324,478 @@ std::unique_ptr<LevelObject> LevelObject::Deserialize(std::ifstream& file) {
 }
 
 // Implementation of LevelData
-LevelData::LevelData() {
+LevelData::LevelData()
+    : objectPool_(&arena_), nameIndex_(&indexPool_), journalId_(0), trackChanges_(false), copyOwnsBase_(false), settingsChanged_(false),
+    editGeneration_(0), cellsHash_(0), cellsHashValid_(false), hashBuilt_(false), spatialBuilt_(false) {
 }
 
 LevelData::~LevelData() {
 }
 
-void LevelData::AddObject(std::unique_ptr<LevelObject> object) {
-    objects_.push_back(std::move(object));
+ObjectHandle LevelData::AddObject(std::unique_ptr<LevelObject> object) {
+    if (!object || nameIndex_.count(object->GetName()) != 0) {
+        return ObjectHandle();
+    }
+
+    LevelObject* stored = NewObject(object->GetName(), object->GetType());
+    stored->CopyProperties(*object);
+    return InsertAt(TakeFreeSlot(), stored, object->detached_->transform);
+}
+
+ObjectHandle LevelData::CreateObject(std::string_view name, ObjectType type, const Transform& transform) {
+    if (nameIndex_.count(name) != 0) {
+        return ObjectHandle();
+    }
+    return InsertAt(TakeFreeSlot(), NewObject(name, type), transform);
 }
 
-void LevelData::RemoveObject(const std::string& name) {
-    objects_.erase(
-        std::remove_if(objects_.begin(), objects_.end(),
-            [&name](const std::unique_ptr<LevelObject>& obj) {
-                return obj->GetName() == name;
-            }),
-        objects_.end());
+LevelObject* LevelData::CreateLoadedObject(std::string_view name, ObjectType type, const Transform& transform) {
+    LevelObject* object = GetObject(CreateObject(name, type, transform));
+    if (!object) {
+        droppedDuplicates_.emplace_back(name);
+    }
+    return object;
 }
 
-LevelObject* LevelData::GetObject(const std::string& name) {
-    for (const auto& obj : objects_) {
-        if (obj->GetName() == name) {
-            return obj.get();
+LevelObject* LevelData::NewObject(std::string_view name, ObjectType type) {
+    char* storedName = nullptr;
+    if (!name.empty()) {
+        storedName = static_cast<char*>(objectPool_.allocate(name.size(), 1));
+        std::memcpy(storedName, name.data(), name.size());
+    }
+    void* memory = objectPool_.allocate(sizeof(LevelObject), alignof(LevelObject));
+    return new (memory) LevelObject(std::string_view(storedName, name.size()), type, this);
+}
+
+void LevelData::DeleteObject(LevelObject* object) {
+    std::string_view name = object->name_;
+    object->~LevelObject();
+    if (!name.empty()) {
+        objectPool_.deallocate(const_cast<char*>(name.data()), name.size(), 1);
+    }
+    objectPool_.deallocate(object, sizeof(LevelObject), alignof(LevelObject));
+}
+
+uint32_t LevelData::TakeFreeSlot() {
+    // Reuse a free slot if there is one, otherwise grow
+    if (!freeSlots_.empty()) {
+        uint32_t slotIndex = freeSlots_.back();
+        freeSlots_.pop_back();
+        return slotIndex;
+    }
+    slots_.push_back({ 0, 0 });
+    return static_cast<uint32_t>(slots_.size() - 1);
+}
+
+void LevelData::ClaimSlot(uint32_t slotIndex) {
+    while (slots_.size() <= slotIndex) {
+        slots_.push_back({ static_cast<uint32_t>(freeSlots_.size()), 0 });
+        freeSlots_.push_back(static_cast<uint32_t>(slots_.size() - 1));
+    }
+
+    // Take the slot out of the free list by moving the last entry into its place
+    uint32_t position = slots_[slotIndex].denseIndex;
+    uint32_t last = freeSlots_.back();
+    freeSlots_[position] = last;
+    slots_[last].denseIndex = position;
+    freeSlots_.pop_back();
+}
+
+ObjectHandle LevelData::InsertAt(uint32_t slotIndex, LevelObject* object, const Transform& transform) {
+    ObjectSlot& slot = slots_[slotIndex];
+    slot.denseIndex = static_cast<uint32_t>(objects_.size());
+
+    // The transform goes into the level's arrays; its row matches the dense index
+    object->transformRow_ = transforms_.Add(transform);
+
+    nameIndex_.emplace(object->GetName(), slotIndex);
+    size_t type = static_cast<size_t>(object->GetType());
+    if (type < OBJECT_TYPE_COUNT) {
+        object->typeSlot_ = static_cast<uint32_t>(typeBuckets_[type].size());
+        typeBuckets_[type].push_back(object);
+    }
+    if (spatialBuilt_) {
+        object->spatialLeaf_ = spatial_.Insert(GetObjectBounds(object->transformRow_), slotIndex);
+    }
+    objects_.push_back(object);
+    denseSlots_.push_back(slotIndex);
+    RecordEdit(EditKind::Add, object, 0);
+
+    ObjectHandle handle;
+    handle.index = slotIndex;
+    handle.generation = slot.generation;
+    return handle;
+}
+
+void LevelData::RemoveAt(uint32_t slotIndex) {
+    ObjectSlot& slot = slots_[slotIndex];
+    uint32_t denseIndex = slot.denseIndex;
+    uint32_t lastIndex = static_cast<uint32_t>(objects_.size() - 1);
+
+    LevelObject* object = objects_[denseIndex];
+    RecordEdit(EditKind::Remove, object, 0);
+    nameIndex_.erase(object->GetName());
+    if (spatialBuilt_) {
+        spatial_.Remove(object->spatialLeaf_);
+    }
+
+    // Same swap-and-pop inside the object's type bucket
+    size_t type = static_cast<size_t>(object->GetType());
+    if (type < OBJECT_TYPE_COUNT) {
+        std::vector<LevelObject*>& bucket = typeBuckets_[type];
+        uint32_t typeSlot = object->typeSlot_;
+        bucket[typeSlot] = bucket.back();
+        bucket[typeSlot]->typeSlot_ = typeSlot;
+        bucket.pop_back();
+    }
+
+    // Swap with the last object and pop so removal is O(1)
+    transforms_.SwapRemove(denseIndex);
+    DeleteObject(object);
+    if (denseIndex != lastIndex) {
+        objects_[denseIndex] = objects_[lastIndex];
+        objects_[denseIndex]->transformRow_ = denseIndex;
+        denseSlots_[denseIndex] = denseSlots_[lastIndex];
+        slots_[denseSlots_[denseIndex]].denseIndex = denseIndex;
+    }
+    objects_.pop_back();
+    denseSlots_.pop_back();
+
+    // Bumping the generation invalidates every outstanding handle to this slot
+    ++slot.generation;
+    slot.denseIndex = static_cast<uint32_t>(freeSlots_.size());
+    freeSlots_.push_back(slotIndex);
+}
+
+bool LevelData::RemoveObject(std::string_view name) {
+    auto it = nameIndex_.find(name);
+    if (it == nameIndex_.end()) {
+        return false;
+    }
+    RemoveAt(it->second);
+    return true;
+}
+
+bool LevelData::RemoveObject(ObjectHandle handle) {
+    if (!GetObject(handle)) {
+        return false;
+    }
+    RemoveAt(handle.index);
+    return true;
+}
+
+void LevelData::Reserve(size_t objectCount) {
+    objects_.reserve(objectCount);
+    transforms_.Reserve(objectCount);
+    denseSlots_.reserve(objectCount);
+    slots_.reserve(objectCount);
+    nameIndex_.reserve(objectCount);
+}
+
+LevelObject* LevelData::GetObject(std::string_view name) {
+    auto it = nameIndex_.find(name);
+    if (it == nameIndex_.end()) {
+        return nullptr;
+    }
+    return objects_[slots_[it->second].denseIndex];
+}
+
+const LevelObject* LevelData::GetObject(std::string_view name) const {
+    return const_cast<LevelData*>(this)->GetObject(name);
+}
+
+LevelObject* LevelData::GetObject(ObjectHandle handle) {
+    if (handle.index >= slots_.size()) {
+        return nullptr;
+    }
+
+    const ObjectSlot& slot = slots_[handle.index];
+    if (slot.generation != handle.generation) {
+        return nullptr;
+    }
+    return objects_[slot.denseIndex];
+}
+
+const LevelObject* LevelData::GetObject(ObjectHandle handle) const {
+    return const_cast<LevelData*>(this)->GetObject(handle);
+}
+
+ObjectHandle LevelData::FindHandle(std::string_view name) const {
+    ObjectHandle handle;
+    auto it = nameIndex_.find(name);
+    if (it != nameIndex_.end()) {
+        handle.index = it->second;
+        handle.generation = slots_[it->second].generation;
+    }
+    return handle;
+}
+
+ObjectSpan LevelData::GetObjectsByType(ObjectType type) const {
+    size_t index = static_cast<size_t>(type);
+    if (index >= OBJECT_TYPE_COUNT) {
+        return ObjectSpan();
+    }
+    const std::vector<LevelObject*>& bucket = typeBuckets_[index];
+    return ObjectSpan(bucket.data(), bucket.data() + bucket.size());
+}
+
+void LevelData::TranslateObjects(const std::vector<ObjectHandle>& selection, float dx, float dy, float dz) {
+    std::vector<uint32_t> rows;
+    rows.reserve(selection.size());
+    for (const ObjectHandle& handle : selection) {
+        if (LevelObject* object = GetObject(handle)) {
+            rows.push_back(slots_[handle.index].denseIndex);
+            RecordEdit(EditKind::Transform, object, 0);
         }
     }
-    return nullptr;
+    transforms_.Translate(rows.data(), rows.size(), dx, dy, dz);
+
+    if (spatialBuilt_) {
+        for (uint32_t row : rows) {
+            UpdateSpatialIndex(objects_[row]);
+        }
+    }
+}
+
+void LevelData::ComputeWorldMatrices(std::vector<Float4x4>& matrices) const {
+    matrices.resize(objects_.size());
+    transforms_.ComputeWorldMatrices(matrices.data());
 }
 
-std::vector<LevelObject*> LevelData::GetObjectsByType(ObjectType type) const {
-    std::vector<LevelObject*> result;
+Aabb LevelData::GetObjectBounds(uint32_t row) const {
+    Aabb bounds;
+    transforms_.ComputeObjectBounds(row, bounds.min, bounds.max);
+    return bounds;
+}
+
+void LevelData::BuildSpatialIndex() const {
+    const size_t count = objects_.size();
+    std::vector<Float3> minBounds(count);
+    std::vector<Float3> maxBounds(count);
+    transforms_.ComputeObjectBounds(minBounds.data(), maxBounds.data());
+
+    std::vector<Aabb> bounds(count);
+    for (size_t i = 0; i < count; ++i) {
+        bounds[i] = { minBounds[i], maxBounds[i] };
+    }
+    std::vector<uint32_t> leaves(count);
+    spatial_.Build(bounds.data(), denseSlots_.data(), count, leaves.data());
+    for (size_t i = 0; i < count; ++i) {
+        objects_[i]->spatialLeaf_ = leaves[i];
+    }
+    spatialBuilt_ = true;
+}
+
+void LevelData::UpdateSpatialIndex(const LevelObject* object) {
+    if (spatialBuilt_) {
+        spatial_.Update(object->spatialLeaf_, GetObjectBounds(object->transformRow_));
+    }
+}
+
+const AabbTree& LevelData::GetSpatialIndex() const {
+    if (!spatialBuilt_) {
+        BuildSpatialIndex();
+    }
+    return spatial_;
+}
+
+void LevelData::QueryBox(const Aabb& box, std::vector<LevelObject*>& out) const {
+    out.clear();
+    GetSpatialIndex().Query([&box](const Aabb& bounds) { return Overlaps(bounds, box); },
+        [this, &out](uint32_t slot) { out.push_back(objects_[slots_[slot].denseIndex]); });
+}
+
+void LevelData::QuerySphere(const Float3& center, float radius, std::vector<LevelObject*>& out) const {
+    out.clear();
+    GetSpatialIndex().Query([&center, radius](const Aabb& bounds) { return OverlapsSphere(bounds, center, radius); },
+        [this, &out](uint32_t slot) { out.push_back(objects_[slots_[slot].denseIndex]); });
+}
+
+void LevelData::QueryFrustum(const Frustum& frustum, std::vector<LevelObject*>& out) const {
+    out.clear();
+    GetSpatialIndex().Query([&frustum](const Aabb& bounds) { return OverlapsFrustum(bounds, frustum); },
+        [this, &out](uint32_t slot) { out.push_back(objects_[slots_[slot].denseIndex]); });
+}
+
+void LevelData::QueryRay(const Float3& origin, const Float3& direction, float maxDistance, std::vector<LevelObject*>& out) const {
+    out.clear();
+    const Float3 inverse = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+    GetSpatialIndex().Query([&origin, &inverse, maxDistance](const Aabb& bounds) { return IntersectRay(bounds, origin, inverse, maxDistance) >= 0.0f; },
+        [this, &out](uint32_t slot) { out.push_back(objects_[slots_[slot].denseIndex]); });
+}
+
+LevelObject* LevelData::Raycast(const Float3& origin, const Float3& direction, float maxDistance, float* hitDistance) const {
+    const AabbTree& tree = GetSpatialIndex();
+    float distance = 0.0f;
+    uint32_t leaf = tree.RaycastNearest(origin, direction, maxDistance, distance);
+    if (leaf == AabbTree::NULL_NODE) {
+        return nullptr;
+    }
+    if (hitDistance) {
+        *hitDistance = distance;
+    }
+    return objects_[slots_[tree.GetUserData(leaf)].denseIndex];
+}
+
+PropertyMemoryReport LevelData::GetPropertyMemoryReport() const {
+    PropertyMemoryReport report;
+    report.objectCount = objects_.size();
+    report.internedStrings = strings_.GetCount();
+    report.poolBytes = strings_.GetMemoryUsage();
+
     for (const auto& obj : objects_) {
-        if (obj->GetType() == type) {
-            result.push_back(obj.get());
+        const PropertyList& properties = obj->GetProperties();
+        report.propertyCount += properties.size();
+        for (const PropertyEntry& entry : properties) {
+            ++report.typeCounts[static_cast<int>(entry.value.type)];
         }
+        report.listBytes += sizeof(PropertyList) + properties.GetHeapBytes();
+        report.mapBytes += EstimatePropertyMapBytes(properties, strings_);
     }
-    return result;
+    return report;
 }
 
 void LevelData::SetSetting(const std::string& key, const std::string& value) {
     settings_[key] = value;
+    RecordSettingEdit(key);
+}
+
+bool LevelData::RemoveSetting(const std::string& key) {
+    if (settings_.erase(key) == 0) {
+        return false;
+    }
+    RecordSettingEdit(key);
+    return true;
+}
+
+void LevelData::RecordSettingEdit(const std::string& key) {
+    ++editGeneration_;
+    settingsChanged_ = true;
+    if (journalId_ != 0) {
+        edits_.push_back({ EditKind::Setting, 0, 0, static_cast<uint32_t>(editText_.size()) });
+        editText_.push_back(key);
+    }
+}
+
+void LevelData::RecordEdit(EditKind kind, LevelObject* object, uint32_t key) {
+    ++editGeneration_;
+    if (hashBuilt_) {
+        if (kind == EditKind::Remove) {
+            RemoveContentHash(object);
+        }
+        else if (!(object->hashFlags_ & LevelObject::HASH_DIRTY)) {
+            object->hashFlags_ |= LevelObject::HASH_DIRTY;
+            hashDirtySlots_.push_back(denseSlots_[object->transformRow_]);
+        }
+    }
+
+    if (trackChanges_ && !object->snapshotDirty_) {
+        object->snapshotDirty_ = true;
+        changedSlots_.push_back(denseSlots_[object->transformRow_]);
+    }
+
+    if (journalId_ == 0) {
+        return;
+    }
+
+    // An object added since the last save is written whole, so its later edits
+    // need no entries; a removal cancels the add. One transform entry suffices.
+    if (object->journalFlags_ & LevelObject::JOURNAL_ADDED) {
+        return;
+    }
+    if (kind == EditKind::Transform) {
+        if (object->journalFlags_ & LevelObject::JOURNAL_TRANSFORM) {
+            return;
+        }
+        object->journalFlags_ |= LevelObject::JOURNAL_TRANSFORM;
+    }
+    else if (kind == EditKind::Add) {
+        object->journalFlags_ |= LevelObject::JOURNAL_ADDED;
+    }
+    else if (kind == EditKind::Remove) {
+        key = static_cast<uint32_t>(editText_.size());
+        editText_.emplace_back(object->GetName());
+    }
+
+    uint32_t slotIndex = denseSlots_[object->transformRow_];
+    edits_.push_back({ kind, slotIndex, slots_[slotIndex].generation, key });
+}
+
+const LevelObject* LevelData::GetEditedObject(const Edit& edit) const {
+    if (edit.kind == EditKind::Remove || edit.kind == EditKind::Setting) {
+        return nullptr;
+    }
+    return GetObject(ObjectHandle{ edit.slot, edit.generation });
+}
+
+LevelObject* LevelData::GetSlotObject(uint32_t slotIndex) const {
+    // Free slots keep their free-list position in denseIndex, which never maps back to them
+    uint32_t denseIndex = slotIndex < slots_.size() ? slots_[slotIndex].denseIndex : 0;
+    if (denseIndex >= denseSlots_.size() || denseSlots_[denseIndex] != slotIndex) {
+        return nullptr;
+    }
+    return objects_[denseIndex];
+}
+
+void LevelData::ResetEdits() {
+    for (const Edit& edit : edits_) {
+        if (const LevelObject* object = GetEditedObject(edit)) {
+            const_cast<LevelObject*>(object)->journalFlags_ = 0;
+        }
+    }
+    edits_.clear();
+    editText_.clear();
+}
+
+void LevelData::Clear() {
+    // A save still writing may be followed by a load of the same file
+    WaitForBackgroundSave();
+
+    // Keep the slots so handles from before the clear can never resolve again
+    for (uint32_t slotIndex : denseSlots_) {
+        ++slots_[slotIndex].generation;
+        slots_[slotIndex].denseIndex = static_cast<uint32_t>(freeSlots_.size());
+        freeSlots_.push_back(slotIndex);
+    }
+
+    nameIndex_.clear();
+    for (auto& bucket : typeBuckets_) {
+        bucket.clear();
+    }
+    objects_.clear();
+    transforms_.Clear();
+    strings_.Clear();
+    denseSlots_.clear();
+    settings_.clear();
+    droppedDuplicates_.clear();
+
+    // Until the next save or load there is no snapshot to journal against
+    journalId_ = 0;
+    edits_.clear();
+    editText_.clear();
+
+    // The next snapshot is built from scratch, so the old level's goes now
+    trackChanges_ = false;
+    copyOwnsBase_ = false;
+    lastSnapshot_ = LevelSnapshot();
+    settingsChanged_ = false;
+    changedSlots_.clear();
+    ++editGeneration_;
+
+    // Content hashes are rebuilt by the next query too
+    contentCells_.clear();
+    hashDirtySlots_.clear();
+    cellsHashValid_ = false;
+    hashBuilt_ = false;
+
+    // Rebuilt in one pass by the next query rather than leaf by leaf during a load
+    spatial_.Clear();
+    spatialBuilt_ = false;
+
+    // Objects, their names and spilled properties all live in the arena, so
+    // they go with it rather than one destructor at a time
+    objectPool_.release();
+    arena_.Release();
 }
 
 std::string LevelData::GetSetting(const std::string& key) const {
@@ -180,68 +807,141 @@ std::string LevelData::GetSetting(const std::string& key) const {
 }
 
 bool LevelData::SaveToFile(const fs::path& path) {
+    WaitForBackgroundSave();
+
+    uint64_t journalId = NewJournalId();
+    if (!WriteSnapshot(path, journalId)) {
+        return false;
+    }
+
+    // The snapshot holds every edit, so journals against older snapshots no longer apply
+    std::error_code error;
+    fs::remove(GetJournalPath(path), error);
+    fs::remove(GetCompactingJournalPath(path), error);
+
+    journalId_ = journalId;
+    ResetEdits();
+    return true;
+}
+
+bool LevelData::WriteSnapshot(const fs::path& path, uint64_t journalId) const {
     std::ofstream file(path, std::ios::out);
     if (!file.is_open()) {
         return false;
     }
 
-    // Write header
-    file << "LEVEL_FILE_VERSION=1.0\n";
+    WriteText(file, journalId);
 
-    // Write settings
-    file << "SETTINGS_COUNT=" << settings_.size() << "\n";
-    for (const auto& [key, value] : settings_) {
-        file << "SETTING=" << key << "," << value << "\n";
+    file.close();
+    return !file.fail();
+}
+
+void LevelData::WriteText(std::ostream& file, uint64_t journalId) const {
+    WriteLevelTextHeader(file, journalId, settings_, objects_.size());
+
+    ObjectTextView view;
+    for (uint32_t slotIndex = 0; slotIndex < slots_.size(); ++slotIndex) {
+        if (const LevelObject* object = GetSlotObject(slotIndex)) {
+            object->GetTextView(view);
+            WriteObjectText(file, view);
+        }
     }
+}
 
-    // Write objects
-    file << "OBJECTS_COUNT=" << objects_.size() << "\n";
-    for (const auto& obj : objects_) {
-        obj->Serialize(file);
+bool LevelData::LoadFromFile(const fs::path& path) {
+    // Loaders read the file before they Clear; background saves write text
+    // files, so let one finish before its file is read
+    WaitForBackgroundSave();
+
+    if (IsCompressedLevelFile(path)) {
+        return LoadFromCompressedFile(path);
+    }
+    if (IsBinaryLevelFile(path)) {
+        return LoadFromBinaryFile(path);
+    }
+    if (IsXmlLevelFile(path)) {
+        return LoadFromXmlFile(path);
     }
 
-    file.close();
-    return true;
+    return LoadText(path) && LoadJournal(path);
 }
 
-bool LevelData::LoadFromFile(const fs::path& path) {
-    std::ifstream file(path, std::ios::in);
+bool LevelData::LoadText(const fs::path& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
     if (!file.is_open()) {
         return false;
     }
 
+    // Parse from one buffer so names and properties are copied straight into the level
+    std::string text(static_cast<size_t>(fs::file_size(path)), '\0');
+    file.read(text.data(), static_cast<std::streamsize>(text.size()));
+    text.resize(static_cast<size_t>(file.gcount()));
+    file.close();
+
+    LevelTextChunk chunk;
+    ParseLevelText(text, chunk);
+
     // Clear existing data
-    objects_.clear();
-    settings_.clear();
+    Clear();
+    Reserve(chunk.objects.size());
+    AddTextChunk(chunk);
+    return true;
+}
 
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line == "OBJECT") {
-            auto object = LevelObject::Deserialize(file);
-            if (object) {
-                objects_.push_back(std::move(object));
-            }
-        }
-        else if (line.find("SETTING=") == 0) {
-            std::string value = line.substr(8);
-            size_t commaPos = value.find(",");
-            if (commaPos != std::string::npos) {
-                std::string key = value.substr(0, commaPos);
-                std::string settingValue = value.substr(commaPos + 1);
-                settings_[key] = settingValue;
-            }
-        }
-    }
+// Files GenerateGameCode writes into the game directory; engine files of the
+// same names are not synced over them
+const char* const GENERATED_GAME_FILES[] = { "GameLevel.cpp", "GameLevel.h", "Main.cpp", BAKED_LEVEL_FILE };
 
-    file.close();
+// Part of the cache key of generated files; bump it whenever
+// GenerateGameFiles changes what it writes for the same level
+const uint64_t GAME_CODE_VERSION = 2;
+
+// Implementation of CompileLog
+void CompileLog::Append(std::string text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.push_back(std::move(text));
+}
+
+void CompileLog::BeginRun() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t end = firstEntry_ + entries_.size();
+    size_t keepFrom = std::min(std::max(runStart_, consumed_), end);
+    entries_.erase(entries_.begin(), entries_.begin() + (keepFrom - firstEntry_));
+    firstEntry_ = keepFrom;
+    runStart_ = end;
+}
+
+bool CompileLog::ReadSince(size_t& cursor, std::string& text) const {
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return false;
+    }
+    cursor = std::max(cursor, firstEntry_);
+    for (; cursor < firstEntry_ + entries_.size(); ++cursor) {
+        text += entries_[cursor - firstEntry_];
+    }
+    consumed_ = std::max(consumed_, cursor);
     return true;
 }
 
+std::string CompileLog::GetText() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string text;
+    for (size_t i = runStart_ - firstEntry_; i < entries_.size(); ++i) {
+        text += entries_[i];
+    }
+    return text;
+}
+
 // Implementation of CompilerSystem
-CompilerSystem::CompilerSystem() : isCompiling_(false) {
+CompilerSystem::CompilerSystem()
+    : toolchain_(GetDefaultToolchain()), codeMode_(GameCodeMode::Generated), cacheLimit_(DEFAULT_COMPILE_CACHE_BYTES), state_(CompileState::Idle),
+      stage_(CompileStage::None), stageCompleted_(0), stageTotal_(0), compilePool_(1) {
 }
 
 CompilerSystem::~CompilerSystem() {
+    CancelCompile();
+    WaitForCompile();
 }
 
 bool CompilerSystem::Initialize(const fs::path& enginePath, const fs::path& templatePath, const fs::path& outputPath) {
@@ -256,316 +956,887 @@ bool CompilerSystem::Initialize(const fs::path& enginePath, const fs::path& temp
         }
     }
 
+    // Compiles still work without the cache, only slower
+    if (cacheLimit_ > 0 && !cache_.Open(outputPath_ / COMPILE_CACHE_DIR, cacheLimit_)) {
+        compilationLog_.Append("Compile cache unavailable; compiling without it.\n");
+    }
+
     return true;
 }
 
+void CompilerSystem::SetCacheLimit(uint64_t bytes) {
+    cacheLimit_ = bytes;
+    cache_.SetMaxBytes(bytes);
+}
+
 bool CompilerSystem::CompileLevel(const LevelData& level, const std::string& gameName) {
-    // Don't compile if already compiling
-    if (isCompiling_) {
+    if (!BeginCompile()) {
         return false;
     }
 
-    isCompiling_ = true;
-    compilationLog_.clear();
+    bool succeeded = RunCompile(level, gameName);
+    EndCompile(succeeded);
+    return succeeded;
+}
 
-    // Log start
-    compilationLog_ += "Starting compilation for: " + gameName + "\n";
+bool CompilerSystem::StartCompile(LevelData& level, const std::string& gameName) {
+    if (!BeginCompile()) {
+        return false;
+    }
 
-    // Create game directory
-    fs::path gameDir = outputPath_ / gameName;
-    if (fs::exists(gameDir)) {
-        // Remove existing directory
+    // The previous task has set its final state but may not have returned
+    if (compileTask_.valid()) {
+        compileTask_.wait();
+    }
+
+    // The snapshot is immutable and costs only what changed since the last
+    // one taken or copied, so the editor is free to keep editing while the
+    // worker compiles
+    LevelSnapshot snapshot = level.CopySnapshot();
+    compileTask_ = compilePool_.Submit([this, snapshot, gameName]() {
+        bool succeeded = false;
         try {
-            fs::remove_all(gameDir);
+            compileLevel_.RestoreSnapshot(snapshot);
+            succeeded = RunCompile(compileLevel_, gameName);
         }
         catch (const std::exception& e) {
-            compilationLog_ += "Error clearing previous build: ";
-            compilationLog_ += e.what();
-            compilationLog_ += "\n";
-            isCompiling_ = false;
+            compilationLog_.Append("Error compiling level: " + std::string(e.what()) + "\n");
+        }
+        EndCompile(succeeded);
+    });
+    return true;
+}
+
+void CompilerSystem::CancelCompile() {
+    CompileState running = CompileState::Running;
+    state_.compare_exchange_strong(running, CompileState::Cancelling);
+}
+
+bool CompilerSystem::WaitForCompile() {
+    if (compileTask_.valid()) {
+        compileTask_.wait();
+    }
+    return state_.load() == CompileState::Succeeded;
+}
+
+CompileProgress CompilerSystem::GetProgress() const {
+    // Read field by field; a stage change in between shows for one poll
+    CompileProgress progress;
+    progress.stage = stage_.load();
+    progress.completed = stageCompleted_.load();
+    progress.total = stageTotal_.load();
+    return progress;
+}
+
+bool CompilerSystem::IsCompiling() const {
+    CompileState state = state_.load();
+    return state == CompileState::Running || state == CompileState::Cancelling;
+}
+
+bool CompilerSystem::BeginCompile() {
+    // Only one compile at a time: claim Running from any state but the two
+    // of a compile in progress
+    CompileState state = state_.load();
+    do {
+        if (state == CompileState::Running || state == CompileState::Cancelling) {
             return false;
         }
+    } while (!state_.compare_exchange_weak(state, CompileState::Running));
+
+    compilationLog_.BeginRun();
+    cacheAtStart_ = cache_.GetStats();
+    SetStage(CompileStage::None, 0);
+    return true;
+}
+
+void CompilerSystem::EndCompile(bool succeeded) {
+    // Evicts what this compile pushed over the limit and saves the index
+    LogCacheUse();
+    SetStage(CompileStage::None, 0);
+    if (succeeded) {
+        state_.store(CompileState::Succeeded);
     }
+    else {
+        state_.store(IsCancelRequested() ? CompileState::Cancelled : CompileState::Failed);
+    }
+}
+
+void CompilerSystem::SetStage(CompileStage stage, size_t total) {
+    stageCompleted_.store(0);
+    stageTotal_.store(total);
+    stage_.store(stage);
+}
 
-    // Create directory
+bool CompilerSystem::RunCompile(const LevelData& level, const std::string& gameName) {
+    compilationLog_.Append("Starting compilation for: " + gameName + "\n");
+
+    // The previous build's output is kept; only what changed is rewritten
+    fs::path gameDir = outputPath_ / gameName;
     try {
         fs::create_directories(gameDir);
     }
     catch (const std::exception& e) {
-        compilationLog_ += "Error creating game directory: ";
-        compilationLog_ += e.what();
-        compilationLog_ += "\n";
-        isCompiling_ = false;
+        compilationLog_.Append("Error creating game directory: " + std::string(e.what()) + "\n");
         return false;
     }
 
-    // Copy engine files
-    compilationLog_ += "Copying engine files...\n";
+    // Cancellation is checked between stages; a stage that started finishes
+    auto cancelled = [this]() {
+        if (IsCancelRequested()) {
+            compilationLog_.Append("Compilation cancelled.\n");
+            return true;
+        }
+        return false;
+    };
+
+    // Sync engine files
+    if (cancelled()) {
+        return false;
+    }
+    SetStage(CompileStage::Copy, 1);
+    compilationLog_.Append("Syncing engine files...\n");
     if (!CopyEngineFiles(gameDir)) {
-        isCompiling_ = false;
+        return false;
+    }
+    stageCompleted_.store(1);
+
+    // Cook the assets the level references
+    if (cancelled()) {
+        return false;
+    }
+    SetStage(CompileStage::Cook, 0);
+    if (!CookLevelAssets(level, gameDir)) {
         return false;
     }
 
     // Generate game code from level data
-    compilationLog_ += "Generating game code...\n";
+    if (cancelled()) {
+        return false;
+    }
+    SetStage(CompileStage::Generate, 1);
+    compilationLog_.Append("Generating game code...\n");
     if (!GenerateGameCode(level, gameDir)) {
-        isCompiling_ = false;
         return false;
     }
+    stageCompleted_.store(1);
 
     // Build the game
-    compilationLog_ += "Building game...\n";
+    if (cancelled()) {
+        return false;
+    }
+    SetStage(CompileStage::Build, 0);
+    compilationLog_.Append("Building game...\n");
     if (!BuildGame(gameDir)) {
-        isCompiling_ = false;
         return false;
     }
 
-    compilationLog_ += "Compilation completed successfully!\n";
-    isCompiling_ = false;
+    compilationLog_.Append("Compilation completed successfully!\n");
     return true;
 }
 
+void CompilerSystem::LogCacheUse() {
+    CompileCache* cache = GetCache();
+    if (!cache) {
+        return;
+    }
+    cache->Flush();
+
+    CompileCacheStats stats = cache->GetStats();
+    std::ostringstream line;
+    line << "Compile cache: " << stats.hits - cacheAtStart_.hits << " hits, " << stats.misses - cacheAtStart_.misses << " misses ("
+        << std::fixed << std::setprecision(0) << stats.GetHitRate() * 100.0 << "% overall), " << stats.entries << " entries, "
+        << stats.bytes / (1024 * 1024) << " MB.\n";
+    compilationLog_.Append(line.str());
+}
+
 bool CompilerSystem::CopyEngineFiles(const fs::path& destination) {
     try {
-        // Copy engine files to the game directory
-        for (const auto& entry : fs::recursive_directory_iterator(enginePath_)) {
-            // Skip certain files/directories if needed
-            if (entry.is_directory()) {
-                fs::create_directories(destination / fs::relative(entry.path(), enginePath_));
-            }
-            else {
-                fs::copy_file(
-                    entry.path(),
-                    destination / fs::relative(entry.path(), enginePath_),
-                    fs::copy_options::overwrite_existing
-                );
-            }
-        }
+        std::vector<std::string> generated(std::begin(GENERATED_GAME_FILES), std::end(GENERATED_GAME_FILES));
+        FileSyncStats stats = SyncDirectory(enginePath_, destination, generated);
 
-        compilationLog_ += "Engine files copied successfully.\n";
+        compilationLog_.Append("Engine files synced: " + std::to_string(stats.linked) + " linked, " + std::to_string(stats.copied) + " copied, "
+            + std::to_string(stats.unchanged) + " unchanged, " + std::to_string(stats.removed) + " removed.\n");
         return true;
     }
     catch (const std::exception& e) {
-        compilationLog_ += "Error copying engine files: ";
-        compilationLog_ += e.what();
-        compilationLog_ += "\n";
+        compilationLog_.Append("Error copying engine files: " + std::string(e.what()) + "\n");
         return false;
     }
 }
 
 bool CompilerSystem::GenerateGameCode(const LevelData& level, const fs::path& destination) {
     try {
-        // Generate game code from level data
-        std::ofstream mainFile(destination / "GameLevel.cpp");
-        if (!mainFile.is_open()) {
-            compilationLog_ += "Failed to create GameLevel.cpp\n";
-            return false;
+        // The files depend only on the level's content and the mode, so a
+        // level compiled before is served from the cache. Content hashes
+        // ignore object order; the same objects in another order give
+        // equivalent code.
+        CompileCache* cache = GetCache();
+        uint64_t key = CombineHash(CombineHash(HashString("GAME_CODE"), GAME_CODE_VERSION), level.GetContentHash());
+        key = CombineHash(key, static_cast<uint64_t>(codeMode_));
+
+        std::vector<std::pair<std::string, std::string>> files;
+        std::string names;
+        bool cached = cache && cache->FetchText(key, names);
+        if (cached) {
+            std::istringstream list(names);
+            std::string name;
+            while (cached && std::getline(list, name)) {
+                files.emplace_back(name, std::string());
+                cached = cache->FetchText(CombineHash(key, HashString(name)), files.back().second);
+            }
         }
 
-        // Write game level code
-        mainFile << "#include \"Engine.h\"\n";
-        mainFile << "#include \"GameLevel.h\"\n\n";
-
-        // Create level initialization code
-        mainFile << "void GameLevel::Initialize(Engine* engine) {\n";
-        mainFile << "    // Generated from level editor\n";
+        if (cached) {
+            compilationLog_.Append("Game code served from the cache.\n");
+        }
+        else {
+            files.clear();
+            names.clear();
+            GenerateGameFiles(level, files);
+            if (cache) {
+                for (const auto& [name, text] : files) {
+                    cache->StoreText(CombineHash(key, HashString(name)), text);
+                    names += name + "\n";
+                }
+                // The list goes in last, so it never names a file that is missing
+                cache->StoreText(key, names);
+            }
+        }
 
-        // Add all objects from the level
-        // For each object, generate initialization code
-        std::vector<LevelObject*> allObjects;
-        for (auto& obj : level.GetObjectsByType(ObjectType::Mesh)) {
-            allObjects.push_back(obj);
+        // Files are only replaced when their text changes, so an unchanged
+        // level rebuilds nothing
+        size_t written = 0;
+        for (const auto& [name, text] : files) {
+            fs::path path = destination / name;
+            fs::create_directories(path.parent_path());
+            bool changed = false;
+            if (!WriteFileIfChanged(path, text, changed)) {
+                compilationLog_.Append("Failed to create " + name + "\n");
+                return false;
+            }
+            written += changed ? 1 : 0;
+        }
+        compilationLog_.Append(std::to_string(written) + " of " + std::to_string(files.size()) + " game files changed.\n");
 
-            mainFile << "    // Create " << obj->GetName() << "\n";
-            mainFile << "    CreateObject(\"" << obj->GetName() << "\", ";
-            mainFile << "XMFLOAT3(" << obj->GetProperty("posX") << ", "
-                << obj->GetProperty("posY") << ", "
-                << obj->GetProperty("posZ") << "), ";
-            mainFile << "XMFLOAT3(" << obj->GetProperty("rotX") << ", "
-                << obj->GetProperty("rotY") << ", "
-                << obj->GetProperty("rotZ") << "));\n";
+        // The build compiles every source it finds, so shards left by a
+        // larger level or by generated mode have to go
+        std::set<std::string> current;
+        for (const auto& file : files) {
+            current.insert(file.first);
+        }
+        fs::path shardDir = destination / GAME_CODE_SHARD_DIR;
+        if (fs::exists(shardDir)) {
+            std::vector<fs::path> stale;
+            for (const auto& entry : fs::directory_iterator(shardDir)) {
+                if (current.count(entry.path().lexically_relative(destination).generic_string()) == 0) {
+                    stale.push_back(entry.path());
+                }
+            }
+            for (const fs::path& path : stale) {
+                fs::remove_all(path);
+            }
         }
 
-        mainFile << "}\n\n";
+        compilationLog_.Append("Game code generated successfully.\n");
+        return true;
+    }
+    catch (const std::exception& e) {
+        compilationLog_.Append("Error generating game code: " + std::string(e.what()) + "\n");
+        return false;
+    }
+}
 
-        // Create update method
-        mainFile << "void GameLevel::Update(float deltaTime) {\n";
-        mainFile << "    // Custom update logic\n";
-        mainFile << "}\n\n";
+void CompilerSystem::GenerateGameFiles(const LevelData& level, std::vector<std::pair<std::string, std::string>>& files) {
+    // Generate game code from level data
+    bool baked = codeMode_ == GameCodeMode::Baked;
+    size_t shardCount = 0;
+
+    if (baked) {
+        // The level goes into an asset and the code stays the same, so
+        // content edits leave nothing to recompile
+        std::string asset;
+        BakeLevel(level, asset);
+        compilationLog_.Append("Baked " + std::to_string(level.CountObjectsByType(ObjectType::Mesh)) + " objects into "
+            + BAKED_LEVEL_FILE + " (" + std::to_string(asset.size()) + " bytes).\n");
+        files.emplace_back(BAKED_LEVEL_FILE, std::move(asset));
+        std::ostringstream mainFile;
+        WriteBakedLevelLoader(mainFile);
+        files.emplace_back("GameLevel.cpp", mainFile.str());
+    }
+    else {
+        // Objects are spread over shards that compile in parallel
+        shardCount = GenerateShardedLevelCode(level, files);
+        compilationLog_.Append("Generated " + std::to_string(level.CountObjectsByType(ObjectType::Mesh)) + " objects in "
+            + std::to_string(shardCount) + (shardCount == 1 ? " shard.\n" : " shards.\n"));
+    }
 
-        // Create render method
-        mainFile << "void GameLevel::Render() {\n";
-        mainFile << "    // Custom render logic\n";
-        mainFile << "}\n";
+    // Create header file
+    std::ostringstream headerFile;
 
-        mainFile.close();
+    headerFile << "#pragma once\n";
+    headerFile << "#include \"Engine.h\"\n";
+    if (baked) {
+        headerFile << "#include <map>\n";
+        headerFile << "#include <string>\n";
+    }
+    headerFile << "\n";
+    headerFile << "class GameLevel {\n";
+    headerFile << "public:\n";
+    headerFile << "    void Initialize(Engine* engine);\n";
+    headerFile << "    void Update(float deltaTime);\n";
+    headerFile << "    void Render();\n";
+    if (baked) {
+        headerFile << "    std::string GetSetting(const std::string& key) const;\n";
+    }
+    headerFile << "\n";
+    headerFile << "private:\n";
+    headerFile << "    Engine* engine_;\n";
+    for (size_t shard = 0; shard < shardCount; ++shard) {
+        headerFile << "    void CreateObjects" << shard << "();\n";
+    }
+    if (baked) {
+        headerFile << "    std::map<std::string, std::string> settings_;\n";
+    }
+    headerFile << "    \n";
+    headerFile << "    // Helper methods\n";
+    headerFile << "    void CreateObject(const std::string& name, XMFLOAT3 position, XMFLOAT3 rotation) {\n";
+    headerFile << "        // Implementation for creating game objects\n";
+    headerFile << "    }\n";
+    headerFile << "};\n";
+
+    files.emplace_back("GameLevel.h", headerFile.str());
+
+    // Create modified main.cpp that uses our level
+    std::ostringstream modifiedMainCpp;
+
+    modifiedMainCpp << "#include <windows.h>\n";
+    modifiedMainCpp << "#include \"Engine.h\"\n";
+    modifiedMainCpp << "#include \"GameLevel.h\"\n\n";
+    // A baked game takes its title from the asset once the level loads
+    modifiedMainCpp << "LPCWSTR szTitle = L\"" << (baked ? "Game" : level.GetSetting("GameTitle")) << "\";\n";
+    modifiedMainCpp << "LPCWSTR szWindowClass = L\"DIRECTXGAMEWINDOW\";\n";
+    modifiedMainCpp << "HINSTANCE hInst;\n";
+    modifiedMainCpp << "Engine* g_engine = nullptr;\n";
+    modifiedMainCpp << "GameLevel* g_level = nullptr;\n\n";
+    modifiedMainCpp << "LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);\n\n";
+
+    modifiedMainCpp << "ATOM MyRegisterClass(HINSTANCE hInstance)\n";
+    modifiedMainCpp << "{\n";
+    modifiedMainCpp << "    WNDCLASS wc = {};\n";
+    modifiedMainCpp << "    wc.lpfnWndProc = WndProc;\n";
+    modifiedMainCpp << "    wc.hInstance = hInstance;\n";
+    modifiedMainCpp << "    wc.lpszClassName = szWindowClass;\n";
+    modifiedMainCpp << "    wc.hbrBackground = (HBRUSH)(COLOR_WINDOW + 1);\n";
+    modifiedMainCpp << "    return RegisterClass(&wc);\n";
+    modifiedMainCpp << "}\n\n";
+
+    modifiedMainCpp << "BOOL InitInstance(HINSTANCE hInstance, int nCmdShow)\n";
+    modifiedMainCpp << "{\n";
+    modifiedMainCpp << "    hInst = hInstance;\n";
+    modifiedMainCpp << "    HWND hWnd = CreateWindow(szWindowClass, szTitle, WS_OVERLAPPEDWINDOW,\n";
+    modifiedMainCpp << "        CW_USEDEFAULT, 0, 800, 600, nullptr, nullptr, hInstance, nullptr);\n";
+    modifiedMainCpp << "    if (!hWnd)\n";
+    modifiedMainCpp << "        return FALSE;\n";
+    modifiedMainCpp << "    ShowWindow(hWnd, nCmdShow);\n";
+    modifiedMainCpp << "    UpdateWindow(hWnd);\n\n";
+    modifiedMainCpp << "    // Create and initialize the engine\n";
+    modifiedMainCpp << "    g_engine = new Engine(hWnd);\n";
+    modifiedMainCpp << "    if (!g_engine->Initialize()) {\n";
+    modifiedMainCpp << "        MessageBox(hWnd, L\"Engine initialization failed!\", L\"Error\", MB_OK);\n";
+    modifiedMainCpp << "        delete g_engine;\n";
+    modifiedMainCpp << "        g_engine = nullptr;\n";
+    modifiedMainCpp << "        return FALSE;\n";
+    modifiedMainCpp << "    }\n\n";
+    modifiedMainCpp << "    // Create and initialize game level\n";
+    modifiedMainCpp << "    g_level = new GameLevel();\n";
+    modifiedMainCpp << "    g_level->Initialize(g_engine);\n";
+    if (baked) {
+        modifiedMainCpp << "    if (!g_level->GetSetting(\"GameTitle\").empty())\n";
+        modifiedMainCpp << "        SetWindowTextA(hWnd, g_level->GetSetting(\"GameTitle\").c_str());\n";
+    }
+    modifiedMainCpp << "\n";
+    modifiedMainCpp << "    SetTimer(hWnd, 1, 16, NULL); // ~60fps\n";
+    modifiedMainCpp << "    return TRUE;\n";
+    modifiedMainCpp << "}\n\n";
+
+    modifiedMainCpp << "int APIENTRY wWinMain(_In_ HINSTANCE hInstance,\n";
+    modifiedMainCpp << "    _In_opt_ HINSTANCE hPrevInstance,\n";
+    modifiedMainCpp << "    _In_ LPWSTR    lpCmdLine,\n";
+    modifiedMainCpp << "    _In_ int       nCmdShow)\n";
+    modifiedMainCpp << "{\n";
+    modifiedMainCpp << "    MyRegisterClass(hInstance);\n";
+    modifiedMainCpp << "    if (!InitInstance(hInstance, nCmdShow))\n";
+    modifiedMainCpp << "        return FALSE;\n\n";
+    modifiedMainCpp << "    MSG msg;\n";
+    modifiedMainCpp << "    while (GetMessage(&msg, nullptr, 0, 0))\n";
+    modifiedMainCpp << "    {\n";
+    modifiedMainCpp << "        TranslateMessage(&msg);\n";
+    modifiedMainCpp << "        DispatchMessage(&msg);\n";
+    modifiedMainCpp << "    }\n";
+    modifiedMainCpp << "    return (int)msg.wParam;\n";
+    modifiedMainCpp << "}\n\n";
+
+    modifiedMainCpp << "LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)\n";
+    modifiedMainCpp << "{\n";
+    modifiedMainCpp << "    switch (message)\n";
+    modifiedMainCpp << "    {\n";
+    modifiedMainCpp << "    case WM_TIMER:\n";
+    modifiedMainCpp << "        if (g_engine) {\n";
+    modifiedMainCpp << "            g_engine->Update();\n";
+    modifiedMainCpp << "            if (g_level) g_level->Update(1.0f/60.0f);\n";
+    modifiedMainCpp << "        }\n";
+    modifiedMainCpp << "        break;\n";
+    modifiedMainCpp << "    case WM_PAINT:\n";
+    modifiedMainCpp << "    {\n";
+    modifiedMainCpp << "        if (g_engine) {\n";
+    modifiedMainCpp << "            g_engine->Render();\n";
+    modifiedMainCpp << "            if (g_level) g_level->Render();\n";
+    modifiedMainCpp << "        }\n";
+    modifiedMainCpp << "        ValidateRect(hWnd, NULL); // Mark as painted\n";
+    modifiedMainCpp << "    }\n";
+    modifiedMainCpp << "    break;\n";
+    modifiedMainCpp << "    case WM_DESTROY:\n";
+    modifiedMainCpp << "        if (g_level) {\n";
+    modifiedMainCpp << "            delete g_level;\n";
+    modifiedMainCpp << "            g_level = nullptr;\n";
+    modifiedMainCpp << "        }\n";
+    modifiedMainCpp << "        if (g_engine) {\n";
+    modifiedMainCpp << "            delete g_engine;\n";
+    modifiedMainCpp << "            g_engine = nullptr;\n";
+    modifiedMainCpp << "        }\n";
+    modifiedMainCpp << "        PostQuitMessage(0);\n";
+    modifiedMainCpp << "        break;\n";
+    modifiedMainCpp << "    default:\n";
+    modifiedMainCpp << "        return DefWindowProc(hWnd, message, wParam, lParam);\n";
+    modifiedMainCpp << "    }\n";
+    modifiedMainCpp << "    return 0;\n";
+    modifiedMainCpp << "}\n";
+
+    files.emplace_back("Main.cpp", modifiedMainCpp.str());
+}
 
-        // Create header file
-        std::ofstream headerFile(destination / "GameLevel.h");
-        if (!headerFile.is_open()) {
-            compilationLog_ += "Failed to create GameLevel.h\n";
-            return false;
-        }
+bool CompilerSystem::CookLevelAssets(const LevelData& level, const fs::path& destination) {
+    if (assetPath_.empty()) {
+        compilationLog_.Append("Warning: no asset directory set; skipping asset cook.\n");
+        return true;
+    }
 
-        headerFile << "#pragma once\n";
-        headerFile << "#include \"Engine.h\"\n\n";
-        headerFile << "class GameLevel {\n";
-        headerFile << "public:\n";
-        headerFile << "    void Initialize(Engine* engine);\n";
-        headerFile << "    void Update(float deltaTime);\n";
-        headerFile << "    void Render();\n";
-        headerFile << "\n";
-        headerFile << "private:\n";
-        headerFile << "    Engine* engine_;\n";
-        headerFile << "    \n";
-        headerFile << "    // Helper methods\n";
-        headerFile << "    void CreateObject(const std::string& name, XMFLOAT3 position, XMFLOAT3 rotation) {\n";
-        headerFile << "        // Implementation for creating game objects\n";
-        headerFile << "    }\n";
-        headerFile << "};\n";
-
-        headerFile.close();
-
-        // Create modified main.cpp that uses our level
-        std::ofstream modifiedMainCpp(destination / "Main.cpp");
-        if (!modifiedMainCpp.is_open()) {
-            compilationLog_ += "Failed to create modified Main.cpp\n";
+    try {
+        // Cook steps run in parallel once the assets they reference are done
+        compilationLog_.Append("Cooking assets...\n");
+        BuildHooks hooks;
+        hooks.progress = [this](size_t finished, size_t total) {
+            stageTotal_.store(total);
+            stageCompleted_.store(finished);
+        };
+        hooks.cancel = [this]() { return IsCancelRequested(); };
+        hooks.cache = GetCache();
+
+        AssetCookStats stats;
+        bool cooked = CookAssets(level, assetPath_, destination / COOKED_ASSET_DIR, 0,
+            [this](const std::string& text) { compilationLog_.Append(text + "\n"); }, stats, hooks);
+        if (stats.cancelled) {
             return false;
         }
 
-        modifiedMainCpp << "#include <windows.h>\n";
-        modifiedMainCpp << "#include \"Engine.h\"\n";
-        modifiedMainCpp << "#include \"GameLevel.h\"\n\n";
-        modifiedMainCpp << "LPCWSTR szTitle = L\"" << level.GetSetting("GameTitle") << "\";\n";
-        modifiedMainCpp << "LPCWSTR szWindowClass = L\"DIRECTXGAMEWINDOW\";\n";
-        modifiedMainCpp << "HINSTANCE hInst;\n";
-        modifiedMainCpp << "Engine* g_engine = nullptr;\n";
-        modifiedMainCpp << "GameLevel* g_level = nullptr;\n\n";
-        modifiedMainCpp << "LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);\n\n";
-
-        modifiedMainCpp << "ATOM MyRegisterClass(HINSTANCE hInstance)\n";
-        modifiedMainCpp << "{\n";
-        modifiedMainCpp << "    WNDCLASS wc = {};\n";
-        modifiedMainCpp << "    wc.lpfnWndProc = WndProc;\n";
-        modifiedMainCpp << "    wc.hInstance = hInstance;\n";
-        modifiedMainCpp << "    wc.lpszClassName = szWindowClass;\n";
-        modifiedMainCpp << "    wc.hbrBackground = (HBRUSH)(COLOR_WINDOW + 1);\n";
-        modifiedMainCpp << "    return RegisterClass(&wc);\n";
-        modifiedMainCpp << "}\n\n";
-
-        modifiedMainCpp << "BOOL InitInstance(HINSTANCE hInstance, int nCmdShow)\n";
-        modifiedMainCpp << "{\n";
-        modifiedMainCpp << "    hInst = hInstance;\n";
-        modifiedMainCpp << "    HWND hWnd = CreateWindow(szWindowClass, szTitle, WS_OVERLAPPEDWINDOW,\n";
-        modifiedMainCpp << "        CW_USEDEFAULT, 0, 800, 600, nullptr, nullptr, hInstance, nullptr);\n";
-        modifiedMainCpp << "    if (!hWnd)\n";
-        modifiedMainCpp << "        return FALSE;\n";
-        modifiedMainCpp << "    ShowWindow(hWnd, nCmdShow);\n";
-        modifiedMainCpp << "    UpdateWindow(hWnd);\n\n";
-        modifiedMainCpp << "    // Create and initialize the engine\n";
-        modifiedMainCpp << "    g_engine = new Engine(hWnd);\n";
-        modifiedMainCpp << "    if (!g_engine->Initialize()) {\n";
-        modifiedMainCpp << "        MessageBox(hWnd, L\"Engine initialization failed!\", L\"Error\", MB_OK);\n";
-        modifiedMainCpp << "        delete g_engine;\n";
-        modifiedMainCpp << "        g_engine = nullptr;\n";
-        modifiedMainCpp << "        return FALSE;\n";
-        modifiedMainCpp << "    }\n\n";
-        modifiedMainCpp << "    // Create and initialize game level\n";
-        modifiedMainCpp << "    g_level = new GameLevel();\n";
-        modifiedMainCpp << "    g_level->Initialize(g_engine);\n\n";
-        modifiedMainCpp << "    SetTimer(hWnd, 1, 16, NULL); // ~60fps\n";
-        modifiedMainCpp << "    return TRUE;\n";
-        modifiedMainCpp << "}\n\n";
-
-        modifiedMainCpp << "int APIENTRY wWinMain(_In_ HINSTANCE hInstance,\n";
-        modifiedMainCpp << "    _In_opt_ HINSTANCE hPrevInstance,\n";
-        modifiedMainCpp << "    _In_ LPWSTR    lpCmdLine,\n";
-        modifiedMainCpp << "    _In_ int       nCmdShow)\n";
-        modifiedMainCpp << "{\n";
-        modifiedMainCpp << "    MyRegisterClass(hInstance);\n";
-        modifiedMainCpp << "    if (!InitInstance(hInstance, nCmdShow))\n";
-        modifiedMainCpp << "        return FALSE;\n\n";
-        modifiedMainCpp << "    MSG msg;\n";
-        modifiedMainCpp << "    while (GetMessage(&msg, nullptr, 0, 0))\n";
-        modifiedMainCpp << "    {\n";
-        modifiedMainCpp << "        TranslateMessage(&msg);\n";
-        modifiedMainCpp << "        DispatchMessage(&msg);\n";
-        modifiedMainCpp << "    }\n";
-        modifiedMainCpp << "    return (int)msg.wParam;\n";
-        modifiedMainCpp << "}\n\n";
-
-        modifiedMainCpp << "LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)\n";
-        modifiedMainCpp << "{\n";
-        modifiedMainCpp << "    switch (message)\n";
-        modifiedMainCpp << "    {\n";
-        modifiedMainCpp << "    case WM_TIMER:\n";
-        modifiedMainCpp << "        if (g_engine) {\n";
-        modifiedMainCpp << "            g_engine->Update();\n";
-        modifiedMainCpp << "            if (g_level) g_level->Update(1.0f/60.0f);\n";
-        modifiedMainCpp << "        }\n";
-        modifiedMainCpp << "        break;\n";
-        modifiedMainCpp << "    case WM_PAINT:\n";
-        modifiedMainCpp << "    {\n";
-        modifiedMainCpp << "        if (g_engine) {\n";
-        modifiedMainCpp << "            g_engine->Render();\n";
-        modifiedMainCpp << "            if (g_level) g_level->Render();\n";
-        modifiedMainCpp << "        }\n";
-        modifiedMainCpp << "        ValidateRect(hWnd, NULL); // Mark as painted\n";
-        modifiedMainCpp << "    }\n";
-        modifiedMainCpp << "    break;\n";
-        modifiedMainCpp << "    case WM_DESTROY:\n";
-        modifiedMainCpp << "        if (g_level) {\n";
-        modifiedMainCpp << "            delete g_level;\n";
-        modifiedMainCpp << "            g_level = nullptr;\n";
-        modifiedMainCpp << "        }\n";
-        modifiedMainCpp << "        if (g_engine) {\n";
-        modifiedMainCpp << "            delete g_engine;\n";
-        modifiedMainCpp << "            g_engine = nullptr;\n";
-        modifiedMainCpp << "        }\n";
-        modifiedMainCpp << "        PostQuitMessage(0);\n";
-        modifiedMainCpp << "        break;\n";
-        modifiedMainCpp << "    default:\n";
-        modifiedMainCpp << "        return DefWindowProc(hWnd, message, wParam, lParam);\n";
-        modifiedMainCpp << "    }\n";
-        modifiedMainCpp << "    return 0;\n";
-        modifiedMainCpp << "}\n";
-
-        modifiedMainCpp.close();
-
-        compilationLog_ += "Game code generated successfully.\n";
-        return true;
+        compilationLog_.Append(std::string(cooked ? "Assets cooked: " : "Asset cooking failed: ") + std::to_string(stats.assets) + " assets, "
+            + std::to_string(stats.cooked) + " cooked, " + std::to_string(stats.cached) + " cached, " + std::to_string(stats.upToDate) + " up to date, "
+            + std::to_string(stats.duplicates) + " duplicates, " + std::to_string(stats.removed) + " removed, " + std::to_string(stats.failed) + " failed.\n");
+        return cooked;
     }
     catch (const std::exception& e) {
-        compilationLog_ += "Error generating game code: ";
-        compilationLog_ += e.what();
-        compilationLog_ += "\n";
+        compilationLog_.Append("Error cooking assets: " + std::string(e.what()) + "\n");
         return false;
     }
 }
 
-// Implementation of BuildGame - missing function
 bool CompilerSystem::BuildGame(const fs::path& destination) {
     try {
-        // Here you would add code to actually build the game
-        // This could involve calling a compiler, linking libraries, etc.
-        // For now, just log that we're simulating a build
-        compilationLog_ += "Simulating build process...\n";
-
-        // Simulate build process
-        // In a real implementation, you might execute a command like:
-        // system("cl.exe /EHsc /O2 /Fe:game.exe *.cpp");
+        // Units compile in parallel; each one's result is logged as it
+        // finishes, and a cancel stops units that have not started
+        BuildHooks hooks;
+        hooks.progress = [this](size_t finished, size_t total) {
+            stageTotal_.store(total);
+            stageCompleted_.store(finished);
+        };
+        hooks.cancel = [this]() { return IsCancelRequested(); };
+        hooks.cache = GetCache();
+
+        GameBuildStats stats;
+        bool built = BuildDirectory(destination, destination.filename().string(), toolchain_,
+            [this](const std::string& text) {
+                compilationLog_.Append(text.empty() || text.back() != '\n' ? text + "\n" : text);
+            },
+            stats, hooks);
+        if (stats.cancelled) {
+            return false;
+        }
 
-        compilationLog_ += "Build completed successfully.\n";
-        return true;
+        compilationLog_.Append(std::string(built ? "Build completed: " : "Build failed: ") + std::to_string(stats.compiled) + " compiled, "
+            + std::to_string(stats.cached) + " cached, " + std::to_string(stats.upToDate) + " up to date, " + std::to_string(stats.failed) + " failed.\n");
+        return built;
     }
     catch (const std::exception& e) {
-        compilationLog_ += "Error building game: ";
-        compilationLog_ += e.what();
-        compilationLog_ += "\n";
+        compilationLog_.Append("Error building game: " + std::string(e.what()) + "\n");
         return false;
     }
 }
 
 // Implementation of EditorUI
 EditorUI::EditorUI(HWND hWnd) : hWnd_(hWnd) {
-}
\ No newline at end of file
+}
+
+// Implementation of LevelEditor
+namespace {
+
+    const wchar_t EDITOR_WINDOW_CLASS[] = L"LevelDesignerWindow";
+
+    // Shows the open or save dialog; false if the user cancelled
+    bool ChooseLevelFile(HWND owner, bool save, fs::path& path) {
+        wchar_t fileName[MAX_PATH] = L"";
+        OPENFILENAMEW dialog = {};
+        dialog.lStructSize = sizeof(dialog);
+        dialog.hwndOwner = owner;
+        dialog.lpstrFile = fileName;
+        dialog.nMaxFile = MAX_PATH;
+        dialog.lpstrDefExt = L"txt";
+        if (save) {
+            dialog.lpstrFilter = L"Level Text Files (*.txt)\0*.txt\0All Files (*.*)\0*.*\0";
+            dialog.Flags = OFN_PATHMUSTEXIST | OFN_OVERWRITEPROMPT;
+            if (!GetSaveFileNameW(&dialog)) {
+                return false;
+            }
+        }
+        else {
+            dialog.lpstrFilter = L"Level Files (*.txt;*.plb;*.plz;*.xml)\0*.txt;*.plb;*.plz;*.xml\0All Files (*.*)\0*.*\0";
+            dialog.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
+            if (!GetOpenFileNameW(&dialog)) {
+                return false;
+            }
+        }
+        path = fileName;
+        return true;
+    }
+
+}
+
+LevelEditor::LevelEditor(HINSTANCE hInstance)
+    : hInstance_(hInstance), hWnd_(nullptr), compilerSystem_(std::make_unique<CompilerSystem>()), isRunning_(false) {
+}
+
+LevelEditor::~LevelEditor() {
+    Shutdown();
+}
+
+bool LevelEditor::Initialize() {
+    INITCOMMONCONTROLSEX controls = { sizeof(controls), ICC_BAR_CLASSES };
+    InitCommonControlsEx(&controls);
+
+    if (!RegisterWindowClass() || !CreateEditorWindow()) {
+        return false;
+    }
+    SetupMenus();
+    CreateWindowExW(0, STATUSCLASSNAMEW, nullptr, WS_CHILD | WS_VISIBLE | SBARS_SIZEGRIP, 0, 0, 0, 0, hWnd_,
+        reinterpret_cast<HMENU>(static_cast<INT_PTR>(ID_STATUSBAR)), hInstance_, nullptr);
+    editorUI_ = std::make_unique<EditorUI>(hWnd_);
+
+    // Engine files ship next to the executable; builds go beside them
+    wchar_t modulePath[MAX_PATH];
+    DWORD length = GetModuleFileNameW(nullptr, modulePath, MAX_PATH);
+    fs::path directory = fs::path(std::wstring(modulePath, length)).parent_path();
+    bool compilerReady = compilerSystem_->Initialize(directory / "Engine", directory / "Templates", directory / "Builds");
+
+    ShowWindow(hWnd_, SW_SHOW);
+    UpdateWindow(hWnd_);
+    isRunning_ = true;
+    SetStatusText(compilerReady ? "Ready" : "Ready; the build directory could not be created");
+    return true;
+}
+
+bool LevelEditor::Run() {
+    while (isRunning_ && ProcessMessage()) {
+    }
+    Shutdown();
+    return true;
+}
+
+void LevelEditor::Shutdown() {
+    if (hWnd_) {
+        DestroyWindow(hWnd_);
+    }
+    isRunning_ = false;
+}
+
+bool LevelEditor::RegisterWindowClass() {
+    WNDCLASSEXW windowClass = {};
+    windowClass.cbSize = sizeof(windowClass);
+    windowClass.lpfnWndProc = StaticWndProc;
+    windowClass.hInstance = hInstance_;
+    windowClass.hCursor = LoadCursor(nullptr, IDC_ARROW);
+    windowClass.hbrBackground = reinterpret_cast<HBRUSH>(COLOR_WINDOW + 1);
+    windowClass.lpszClassName = EDITOR_WINDOW_CLASS;
+    // The class outlives the editor, so a second editor finds it registered
+    return RegisterClassExW(&windowClass) != 0 || GetLastError() == ERROR_CLASS_ALREADY_EXISTS;
+}
+
+HWND LevelEditor::CreateEditorWindow() {
+    // StaticWndProc sets hWnd_ from WM_NCCREATE
+    return CreateWindowExW(0, EDITOR_WINDOW_CLASS, L"Level Designer", WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT,
+        WINDOW_WIDTH, WINDOW_HEIGHT, nullptr, nullptr, hInstance_, this);
+}
+
+void LevelEditor::SetupMenus() {
+    HMENU fileMenu = CreatePopupMenu();
+    AppendMenuW(fileMenu, MF_STRING, IDM_NEW, L"&New");
+    AppendMenuW(fileMenu, MF_STRING, IDM_OPEN, L"&Open...");
+    AppendMenuW(fileMenu, MF_STRING, IDM_SAVE, L"&Save");
+    AppendMenuW(fileMenu, MF_STRING, IDM_SAVE_AS, L"Save &As...");
+    AppendMenuW(fileMenu, MF_SEPARATOR, 0, nullptr);
+    AppendMenuW(fileMenu, MF_STRING, IDM_EXIT, L"E&xit");
+
+    // Cancel Compile is enabled while a compile runs
+    HMENU buildMenu = CreatePopupMenu();
+    AppendMenuW(buildMenu, MF_STRING, IDM_COMPILE, L"&Compile Level");
+    AppendMenuW(buildMenu, MF_STRING | MF_GRAYED, IDM_CANCEL_COMPILE, L"C&ancel Compile");
+
+    HMENU helpMenu = CreatePopupMenu();
+    AppendMenuW(helpMenu, MF_STRING, IDM_ABOUT, L"&About");
+
+    HMENU menuBar = CreateMenu();
+    AppendMenuW(menuBar, MF_POPUP, reinterpret_cast<UINT_PTR>(fileMenu), L"&File");
+    AppendMenuW(menuBar, MF_POPUP, reinterpret_cast<UINT_PTR>(buildMenu), L"&Build");
+    AppendMenuW(menuBar, MF_POPUP, reinterpret_cast<UINT_PTR>(helpMenu), L"&Help");
+    SetMenu(hWnd_, menuBar);
+}
+
+bool LevelEditor::ProcessMessage() {
+    MSG msg;
+    BOOL result = GetMessage(&msg, nullptr, 0, 0);
+    if (result <= 0) {
+        // The application is quitting; leave WM_QUIT for the loop that owns it
+        if (result == 0) {
+            PostQuitMessage(static_cast<int>(msg.wParam));
+        }
+        return false;
+    }
+    TranslateMessage(&msg);
+    DispatchMessage(&msg);
+    return true;
+}
+
+LRESULT CALLBACK LevelEditor::StaticWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    if (message == WM_NCCREATE) {
+        auto editor = static_cast<LevelEditor*>(reinterpret_cast<CREATESTRUCTW*>(lParam)->lpCreateParams);
+        editor->hWnd_ = hWnd;
+        SetWindowLongPtrW(hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(editor));
+    }
+    auto editor = reinterpret_cast<LevelEditor*>(GetWindowLongPtrW(hWnd, GWLP_USERDATA));
+    if (!editor) {
+        return DefWindowProcW(hWnd, message, wParam, lParam);
+    }
+    return editor->ProcessWindowMessage(hWnd, message, wParam, lParam);
+}
+
+LRESULT LevelEditor::ProcessWindowMessage(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    switch (message) {
+    case WM_COMMAND:
+        switch (LOWORD(wParam)) {
+        case IDM_NEW:
+            OnNewLevel();
+            return 0;
+        case IDM_OPEN:
+            OnLoadLevel();
+            return 0;
+        case IDM_SAVE:
+            OnSaveLevel();
+            return 0;
+        case IDM_SAVE_AS:
+            OnSaveLevelAs();
+            return 0;
+        case IDM_COMPILE:
+            OnCompileLevel();
+            return 0;
+        case IDM_CANCEL_COMPILE:
+            OnCancelCompile();
+            return 0;
+        case IDM_EXIT:
+            DestroyWindow(hWnd);
+            return 0;
+        case IDM_ABOUT:
+            MessageBoxW(hWnd, L"Level Designer", L"About", MB_OK);
+            return 0;
+        }
+        break;
+
+    case WM_TIMER:
+        if (wParam == COMPILE_TIMER_ID) {
+            OnCompileTimer();
+            return 0;
+        }
+        break;
+
+    case WM_SAVE_PROGRESS:
+        OnSaveProgress(static_cast<size_t>(wParam), static_cast<size_t>(lParam));
+        return 0;
+
+    case WM_SAVE_FINISHED:
+        OnSaveFinished(wParam != 0);
+        return 0;
+
+    case WM_SIZE:
+        // The status bar sizes itself to the bottom of its parent
+        SendDlgItemMessageW(hWnd, ID_STATUSBAR, WM_SIZE, 0, 0);
+        return 0;
+
+    case WM_DESTROY:
+        // Ends Run's loop; the application's own loop carries on
+        SetWindowLongPtrW(hWnd, GWLP_USERDATA, 0);
+        hWnd_ = nullptr;
+        isRunning_ = false;
+        return 0;
+    }
+    return DefWindowProcW(hWnd, message, wParam, lParam);
+}
+
+void LevelEditor::OnNewLevel() {
+    levelData_.Clear();
+    levelPath_.clear();
+    SetStatusText("New level");
+}
+
+void LevelEditor::OnLoadLevel() {
+    fs::path path;
+    if (!ChooseLevelFile(hWnd_, false, path)) {
+        return;
+    }
+    if (!levelData_.LoadFromFile(path)) {
+        SetStatusText("Failed to load " + path.filename().string());
+        return;
+    }
+
+    // Saves write text, so a level opened from another format saves beside it
+    levelPath_ = path;
+    if (levelPath_.extension() != ".txt") {
+        levelPath_.replace_extension(".txt");
+    }
+    SetStatusText("Loaded " + path.filename().string() + " (" + std::to_string(levelData_.GetObjectCount()) + " objects)");
+
+    // Saving writes only the objects that were kept, so say which were dropped
+    const std::vector<std::string>& dropped = levelData_.GetDroppedDuplicateNames();
+    if (!dropped.empty()) {
+        const size_t MAX_LISTED = 10;
+        std::string message = std::to_string(dropped.size()) + " objects were skipped because an earlier object has the same name:\n";
+        for (size_t i = 0; i < dropped.size() && i < MAX_LISTED; ++i) {
+            message += "\n" + dropped[i];
+        }
+        if (dropped.size() > MAX_LISTED) {
+            message += "\n...";
+        }
+        MessageBoxA(hWnd_, message.c_str(), "Open", MB_OK | MB_ICONWARNING);
+    }
+}
+
+void LevelEditor::OnSaveLevelAs() {
+    fs::path path;
+    if (ChooseLevelFile(hWnd_, true, path)) {
+        levelPath_ = path;
+        OnSaveLevel();
+    }
+}
+
+void LevelEditor::OnSaveLevel() {
+    if (levelPath_.empty()) {
+        OnSaveLevelAs();
+        return;
+    }
+
+    // Runs on the saving thread, so it only queues messages for this window
+    HWND hWnd = hWnd_;
+    levelData_.SaveToFileAsync(levelPath_, [hWnd](const SaveProgress& progress) {
+        if (progress.finished) {
+            PostMessage(hWnd, WM_SAVE_FINISHED, progress.succeeded ? 1 : 0, 0);
+        }
+        else {
+            PostMessage(hWnd, WM_SAVE_PROGRESS, static_cast<WPARAM>(progress.objectsWritten), static_cast<LPARAM>(progress.objectCount));
+        }
+    });
+    SetStatusText("Saving " + levelPath_.filename().string() + "...");
+}
+
+void LevelEditor::OnSaveProgress(size_t objectsWritten, size_t objectCount) {
+    size_t percent = objectCount > 0 ? objectsWritten * 100 / objectCount : 100;
+    SetStatusText("Saving " + levelPath_.filename().string() + "... " + std::to_string(percent) + "%");
+}
+
+void LevelEditor::OnSaveFinished(bool succeeded) {
+    SetStatusText((succeeded ? "Saved " : "Failed to save ") + levelPath_.filename().string());
+}
+
+void LevelEditor::OnCompileLevel() {
+    std::string gameName = levelData_.GetSetting("GameTitle");
+    if (gameName.empty()) {
+        gameName = "Game";
+    }
+
+    // Only this thread starts compiles, so the asset path cannot change
+    // under a running one once this check passes
+    if (compilerSystem_->IsCompiling()) {
+        SetStatusText("A compile is already running");
+        return;
+    }
+    // Asset references are relative to the level file, so an unsaved level
+    // compiles without its assets
+    if (levelPath_.empty()) {
+        MessageBoxW(hWnd_, L"The level has not been saved, so its asset references cannot be resolved. "
+            L"Skipping asset cook; save the level and compile again to include its assets.", L"Compile", MB_OK | MB_ICONWARNING);
+    }
+    compilerSystem_->SetAssetPath(levelPath_.empty() ? fs::path() : levelPath_.parent_path());
+    if (!compilerSystem_->StartCompile(levelData_, gameName)) {
+        SetStatusText("A compile is already running");
+        return;
+    }
+    SetTimer(hWnd_, COMPILE_TIMER_ID, COMPILE_POLL_MS, nullptr);
+    EnableMenuItem(GetMenu(hWnd_), IDM_CANCEL_COMPILE, MF_BYCOMMAND | MF_ENABLED);
+    SetStatusText("Compiling " + gameName + "...");
+}
+
+void LevelEditor::OnCancelCompile() {
+    if (compilerSystem_->IsCompiling()) {
+        compilerSystem_->CancelCompile();
+        SetStatusText("Cancelling compile...");
+    }
+}
+
+void LevelEditor::OnCompileTimer() {
+    // Each poll copies only the log entries added since the last one
+    std::string text;
+    if (compilerSystem_->GetLog().ReadSince(compileLogCursor_, text) && !text.empty()) {
+        OutputDebugStringA(text.c_str());
+    }
+
+    CompileState state = compilerSystem_->GetState();
+    if (state == CompileState::Running || state == CompileState::Cancelling) {
+        static const char* const STAGE_NAMES[] = { "starting", "syncing engine files", "cooking assets", "generating code", "building" };
+        CompileProgress progress = compilerSystem_->GetProgress();
+        std::string status = std::string(state == CompileState::Cancelling ? "Cancelling compile: " : "Compiling: ")
+            + STAGE_NAMES[static_cast<size_t>(progress.stage)];
+        if (progress.total > 0) {
+            status += " " + std::to_string(progress.completed) + "/" + std::to_string(progress.total);
+        }
+        SetStatusText(status);
+        return;
+    }
+
+    KillTimer(hWnd_, COMPILE_TIMER_ID);
+    EnableMenuItem(GetMenu(hWnd_), IDM_CANCEL_COMPILE, MF_BYCOMMAND | MF_GRAYED);
+    if (state == CompileState::Succeeded) {
+        SetStatusText("Compilation completed");
+    }
+    else {
+        SetStatusText(state == CompileState::Cancelled ? "Compilation cancelled" : "Compilation failed");
+    }
+}
+
+void LevelEditor::SetStatusText(const std::string& text) {
+    SendDlgItemMessageA(hWnd_, ID_STATUSBAR, SB_SETTEXTA, 0, reinterpret_cast<LPARAM>(text.c_str()));
+}
@@ -0,0 +1,436 @@
+#include "LevelDiff.h"
+#include "LevelNumbers.h"
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+    Transform GetTransform(const LevelObject& object) {
+        Transform transform;
+        transform.position = object.GetPosition();
+        transform.rotation = object.GetRotation();
+        transform.scale = object.GetScale();
+        return transform;
+    }
+
+    bool SameFloat3(const Float3& a, const Float3& b) {
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+
+    const Float3& TransformPart(const Transform& transform, uint8_t bit) {
+        if (bit == ObjectDelta::POSITION) {
+            return transform.position;
+        }
+        return bit == ObjectDelta::ROTATION ? transform.rotation : transform.scale;
+    }
+
+    Float3& TransformPart(Transform& transform, uint8_t bit) {
+        return const_cast<Float3&>(TransformPart(static_cast<const Transform&>(transform), bit));
+    }
+
+    const char* TransformPartName(uint8_t bit) {
+        if (bit == ObjectDelta::POSITION) {
+            return "POSITION";
+        }
+        return bit == ObjectDelta::ROTATION ? "ROTATION" : "SCALE";
+    }
+
+    const uint8_t TRANSFORM_PARTS[] = { ObjectDelta::POSITION, ObjectDelta::ROTATION, ObjectDelta::SCALE };
+
+    std::string FormatFloat3(const Float3& value) {
+        std::string text;
+        AppendFloat3(text, value);
+        return text;
+    }
+
+    std::string FormatOptional(bool present, const std::string& value) {
+        return present ? value : "(none)";
+    }
+
+    // Field by field comparison of two objects with the same name
+    ObjectDelta CompareObjects(const LevelObject& from, const LevelObject& to) {
+        ObjectDelta delta;
+        delta.kind = DeltaKind::Modified;
+        delta.name = std::string(from.GetName());
+        delta.typeBefore = from.GetType();
+        delta.typeAfter = to.GetType();
+        delta.before = GetTransform(from);
+        delta.after = GetTransform(to);
+        for (uint8_t bit : TRANSFORM_PARTS) {
+            if (!SameFloat3(TransformPart(delta.before, bit), TransformPart(delta.after, bit))) {
+                delta.changedTransform |= bit;
+            }
+        }
+
+        for (size_t i = 0; i < from.GetPropertyCount(); ++i) {
+            std::string_view key = from.GetPropertyKey(i);
+            std::string before = from.GetPropertyText(i);
+            const PropertyValue* other = to.FindProperty(key);
+            std::string after = other ? FormatPropertyValue(*other, to.GetStrings()) : std::string();
+            if (!other || after != before) {
+                PropertyDelta property;
+                property.key = std::string(key);
+                property.hadBefore = true;
+                property.hasAfter = other != nullptr;
+                property.before = std::move(before);
+                property.after = std::move(after);
+                delta.properties.push_back(std::move(property));
+            }
+        }
+        for (size_t i = 0; i < to.GetPropertyCount(); ++i) {
+            std::string_view key = to.GetPropertyKey(i);
+            if (!from.FindProperty(key)) {
+                PropertyDelta property;
+                property.key = std::string(key);
+                property.hasAfter = true;
+                property.after = to.GetPropertyText(i);
+                delta.properties.push_back(std::move(property));
+            }
+        }
+        return delta;
+    }
+
+    bool HasChanges(const ObjectDelta& delta) {
+        return delta.typeBefore != delta.typeAfter || delta.changedTransform != 0 || !delta.properties.empty();
+    }
+
+    void SetProperties(LevelObject* object, const std::vector<PropertyDelta>& properties) {
+        for (const PropertyDelta& property : properties) {
+            if (property.hasAfter) {
+                object->SetProperty(property.key, property.after);
+            }
+            else {
+                object->RemoveProperty(property.key);
+            }
+        }
+    }
+
+    bool ApplyObjectDelta(LevelData& level, const ObjectDelta& delta) {
+        if (delta.kind == DeltaKind::Added) {
+            LevelObject* object = level.GetObject(level.CreateObject(delta.name, delta.typeAfter, delta.after));
+            if (!object) {
+                return false;
+            }
+            SetProperties(object, delta.properties);
+            return true;
+        }
+        if (delta.kind == DeltaKind::Removed) {
+            return level.RemoveObject(delta.name);
+        }
+
+        LevelObject* object = level.GetObject(delta.name);
+        if (!object) {
+            return false;
+        }
+
+        // An object's type is fixed, so a type change re-creates it with its fields
+        if (delta.typeAfter != delta.typeBefore && object->GetType() != delta.typeAfter) {
+            Transform transform = GetTransform(*object);
+            std::vector<std::pair<std::string, std::string>> properties;
+            for (size_t i = 0; i < object->GetPropertyCount(); ++i) {
+                properties.emplace_back(std::string(object->GetPropertyKey(i)), object->GetPropertyText(i));
+            }
+            level.RemoveObject(delta.name);
+            object = level.GetObject(level.CreateObject(delta.name, delta.typeAfter, transform));
+            for (const auto& [key, value] : properties) {
+                object->SetProperty(key, value);
+            }
+        }
+
+        for (uint8_t bit : TRANSFORM_PARTS) {
+            if (delta.changedTransform & bit) {
+                const Float3& value = TransformPart(delta.after, bit);
+                if (bit == ObjectDelta::POSITION) {
+                    object->SetPosition(value.x, value.y, value.z);
+                }
+                else if (bit == ObjectDelta::ROTATION) {
+                    object->SetRotation(value.x, value.y, value.z);
+                }
+                else {
+                    object->SetScale(value.x, value.y, value.z);
+                }
+            }
+        }
+        SetProperties(object, delta.properties);
+        return true;
+    }
+
+    void ApplySettingDelta(LevelData& level, const SettingDelta& delta) {
+        if (delta.hasAfter) {
+            level.SetSetting(delta.key, delta.after);
+        }
+        else {
+            level.RemoveSetting(delta.key);
+        }
+    }
+
+    void AddConflict(std::vector<MergeConflict>& conflicts, const std::string& name, std::string field,
+        std::string base, std::string ours, std::string theirs) {
+        conflicts.push_back({ name, std::move(field), std::move(base), std::move(ours), std::move(theirs) });
+    }
+
+    const char* DescribeObject(DeltaKind kind) {
+        switch (kind) {
+        case DeltaKind::Added:
+            return "added";
+        case DeltaKind::Removed:
+            return "removed";
+        default:
+            return "modified";
+        }
+    }
+
+    // The part of theirs that ours did not touch, or changed the same way;
+    // fields ours changed differently become conflicts
+    ObjectDelta MergeObjectDeltas(const ObjectDelta& ours, const ObjectDelta& theirs, std::vector<MergeConflict>& conflicts) {
+        ObjectDelta merged = theirs;
+        merged.changedTransform = 0;
+        merged.properties.clear();
+
+        if (theirs.typeAfter != theirs.typeBefore && ours.typeAfter != ours.typeBefore && ours.typeAfter != theirs.typeAfter) {
+            AddConflict(conflicts, theirs.name, "TYPE", std::to_string(static_cast<int>(theirs.typeBefore)),
+                std::to_string(static_cast<int>(ours.typeAfter)), std::to_string(static_cast<int>(theirs.typeAfter)));
+            merged.typeAfter = merged.typeBefore;
+        }
+
+        for (uint8_t bit : TRANSFORM_PARTS) {
+            if (!(theirs.changedTransform & bit)) {
+                continue;
+            }
+            const Float3& theirValue = TransformPart(theirs.after, bit);
+            if (!(ours.changedTransform & bit)) {
+                merged.changedTransform |= bit;
+            }
+            else if (!SameFloat3(TransformPart(ours.after, bit), theirValue)) {
+                AddConflict(conflicts, theirs.name, TransformPartName(bit), FormatFloat3(TransformPart(theirs.before, bit)),
+                    FormatFloat3(TransformPart(ours.after, bit)), FormatFloat3(theirValue));
+            }
+        }
+
+        std::unordered_map<std::string_view, const PropertyDelta*> ourProperties;
+        for (const PropertyDelta& property : ours.properties) {
+            ourProperties.emplace(property.key, &property);
+        }
+        for (const PropertyDelta& property : theirs.properties) {
+            auto it = ourProperties.find(property.key);
+            if (it == ourProperties.end()) {
+                merged.properties.push_back(property);
+            }
+            else if (it->second->hasAfter != property.hasAfter || it->second->after != property.after) {
+                AddConflict(conflicts, theirs.name, "PROPERTY " + property.key, FormatOptional(property.hadBefore, property.before),
+                    FormatOptional(it->second->hasAfter, it->second->after), FormatOptional(property.hasAfter, property.after));
+            }
+        }
+        return merged;
+    }
+
+}
+
+std::string LevelDelta::Format() const {
+    std::ostringstream text;
+    for (const ObjectDelta& object : objects) {
+        if (object.kind == DeltaKind::Removed) {
+            text << "- OBJECT " << object.name << "\n";
+            continue;
+        }
+
+        if (object.kind == DeltaKind::Added) {
+            text << "+ OBJECT " << object.name << "\n";
+            text << "    TYPE " << static_cast<int>(object.typeAfter) << "\n";
+            for (uint8_t bit : TRANSFORM_PARTS) {
+                text << "    " << TransformPartName(bit) << " " << FormatFloat3(TransformPart(object.after, bit)) << "\n";
+            }
+        }
+        else {
+            text << "~ OBJECT " << object.name << "\n";
+            if (object.typeBefore != object.typeAfter) {
+                text << "    TYPE " << static_cast<int>(object.typeBefore) << " -> " << static_cast<int>(object.typeAfter) << "\n";
+            }
+            for (uint8_t bit : TRANSFORM_PARTS) {
+                if (object.changedTransform & bit) {
+                    text << "    " << TransformPartName(bit) << " " << FormatFloat3(TransformPart(object.before, bit)) << " -> "
+                         << FormatFloat3(TransformPart(object.after, bit)) << "\n";
+                }
+            }
+        }
+
+        for (const PropertyDelta& property : object.properties) {
+            text << "    PROPERTY " << property.key << ": " << FormatOptional(property.hadBefore, property.before) << " -> "
+                 << FormatOptional(property.hasAfter, property.after) << "\n";
+        }
+    }
+
+    for (const SettingDelta& setting : settings) {
+        text << (setting.hadBefore ? (setting.hasAfter ? "~" : "-") : "+") << " SETTING " << setting.key << ": "
+             << FormatOptional(setting.hadBefore, setting.before) << " -> " << FormatOptional(setting.hasAfter, setting.after) << "\n";
+    }
+    return text.str();
+}
+
+LevelDelta DiffLevels(const LevelData& from, const LevelData& to) {
+    LevelDelta delta;
+
+    for (const LevelObject* object : from.GetObjects()) {
+        const LevelObject* other = to.GetObject(object->GetName());
+        if (!other) {
+            ObjectDelta removed;
+            removed.kind = DeltaKind::Removed;
+            removed.name = std::string(object->GetName());
+            removed.typeBefore = object->GetType();
+            removed.typeAfter = object->GetType();
+            removed.before = GetTransform(*object);
+            removed.after = removed.before;
+            delta.objects.push_back(std::move(removed));
+            continue;
+        }
+
+        // Equal hashes mean equal content, so most objects stop here
+        if (from.GetObjectHash(object) == to.GetObjectHash(other)) {
+            continue;
+        }
+        ObjectDelta modified = CompareObjects(*object, *other);
+        if (HasChanges(modified)) {
+            delta.objects.push_back(std::move(modified));
+        }
+    }
+
+    for (const LevelObject* object : to.GetObjects()) {
+        if (from.Contains(object->GetName())) {
+            continue;
+        }
+        ObjectDelta added;
+        added.kind = DeltaKind::Added;
+        added.name = std::string(object->GetName());
+        added.typeBefore = object->GetType();
+        added.typeAfter = object->GetType();
+        added.after = GetTransform(*object);
+        added.before = added.after;
+        for (size_t i = 0; i < object->GetPropertyCount(); ++i) {
+            PropertyDelta property;
+            property.key = std::string(object->GetPropertyKey(i));
+            property.hasAfter = true;
+            property.after = object->GetPropertyText(i);
+            added.properties.push_back(std::move(property));
+        }
+        delta.objects.push_back(std::move(added));
+    }
+
+    // Both settings maps are sorted, so one merge walk finds every difference
+    const auto& fromSettings = from.GetSettings();
+    const auto& toSettings = to.GetSettings();
+    auto a = fromSettings.begin();
+    auto b = toSettings.begin();
+    while (a != fromSettings.end() || b != toSettings.end()) {
+        SettingDelta setting;
+        if (b == toSettings.end() || (a != fromSettings.end() && a->first < b->first)) {
+            setting.key = a->first;
+            setting.hadBefore = true;
+            setting.before = a->second;
+            ++a;
+        }
+        else if (a == fromSettings.end() || b->first < a->first) {
+            setting.key = b->first;
+            setting.hasAfter = true;
+            setting.after = b->second;
+            ++b;
+        }
+        else {
+            bool same = a->second == b->second;
+            if (!same) {
+                setting.key = a->first;
+                setting.hadBefore = true;
+                setting.hasAfter = true;
+                setting.before = a->second;
+                setting.after = b->second;
+            }
+            ++a;
+            ++b;
+            if (same) {
+                continue;
+            }
+        }
+        delta.settings.push_back(std::move(setting));
+    }
+
+    return delta;
+}
+
+size_t ApplyLevelDelta(LevelData& level, const LevelDelta& delta) {
+    size_t skipped = 0;
+    for (const ObjectDelta& object : delta.objects) {
+        if (!ApplyObjectDelta(level, object)) {
+            ++skipped;
+        }
+    }
+    for (const SettingDelta& setting : delta.settings) {
+        ApplySettingDelta(level, setting);
+    }
+    return skipped;
+}
+
+void MergeLevels(const LevelData& base, const LevelData& ours, const LevelData& theirs, LevelData& result,
+    std::vector<MergeConflict>& conflicts) {
+    LevelDelta ourDelta = DiffLevels(base, ours);
+    LevelDelta theirDelta = DiffLevels(base, theirs);
+    CopyLevel(ours, result);
+
+    std::unordered_map<std::string_view, const ObjectDelta*> ourObjects;
+    ourObjects.reserve(ourDelta.objects.size());
+    for (const ObjectDelta& object : ourDelta.objects) {
+        ourObjects.emplace(object.name, &object);
+    }
+
+    for (const ObjectDelta& their : theirDelta.objects) {
+        auto it = ourObjects.find(their.name);
+        if (it == ourObjects.end()) {
+            ApplyObjectDelta(result, their);
+            continue;
+        }
+
+        const ObjectDelta& our = *it->second;
+        if (their.kind == DeltaKind::Modified && our.kind == DeltaKind::Modified) {
+            ObjectDelta merged = MergeObjectDeltas(our, their, conflicts);
+            if (HasChanges(merged)) {
+                ApplyObjectDelta(result, merged);
+            }
+            continue;
+        }
+
+        // Both removed, or both added the same object
+        if (their.kind == our.kind &&
+            (their.kind == DeltaKind::Removed || ours.GetObjectHash(ours.GetObject(our.name)) == theirs.GetObjectHash(theirs.GetObject(their.name)))) {
+            continue;
+        }
+        AddConflict(conflicts, their.name, "OBJECT", their.kind == DeltaKind::Added ? "(none)" : "present", DescribeObject(our.kind),
+            DescribeObject(their.kind));
+    }
+
+    std::unordered_map<std::string_view, const SettingDelta*> ourSettings;
+    for (const SettingDelta& setting : ourDelta.settings) {
+        ourSettings.emplace(setting.key, &setting);
+    }
+    for (const SettingDelta& their : theirDelta.settings) {
+        auto it = ourSettings.find(their.key);
+        if (it == ourSettings.end()) {
+            ApplySettingDelta(result, their);
+        }
+        else if (it->second->hasAfter != their.hasAfter || it->second->after != their.after) {
+            AddConflict(conflicts, their.key, "SETTING", FormatOptional(their.hadBefore, their.before),
+                FormatOptional(it->second->hasAfter, it->second->after), FormatOptional(their.hasAfter, their.after));
+        }
+    }
+}
+
+void CopyLevel(const LevelData& source, LevelData& target) {
+    target.Clear();
+    target.Reserve(source.GetObjectCount());
+    for (const LevelObject* object : source.GetObjects()) {
+        LevelObject* copy = target.GetObject(target.CreateObject(object->GetName(), object->GetType(), GetTransform(*object)));
+        for (size_t i = 0; i < object->GetPropertyCount(); ++i) {
+            copy->SetProperty(object->GetPropertyKey(i), object->GetPropertyText(i));
+        }
+    }
+    for (const auto& [key, value] : source.GetSettings()) {
+        target.SetSetting(key, value);
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "LevelEditor.h"
+#include <string>
+#include <vector>
+
+// Object-level diff and three-way merge of levels
+//
+// Objects are matched by name. Objects whose content hashes (LevelHash.h)
+// agree are skipped without looking at their fields, so a diff costs one
+// hash lookup per object plus the work for the objects that changed.
+// Property values are compared and carried as their text form, which
+// SetProperty parses back to the same typed value.
+
+struct PropertyDelta {
+    std::string key;
+    bool hadBefore = false;
+    bool hasAfter = false;
+    std::string before;
+    std::string after;
+};
+
+enum class DeltaKind : uint8_t {
+    Added,
+    Removed,
+    Modified
+};
+
+struct ObjectDelta {
+    // changedTransform bits
+    static const uint8_t POSITION = 1;
+    static const uint8_t ROTATION = 2;
+    static const uint8_t SCALE = 4;
+
+    DeltaKind kind = DeltaKind::Modified;
+    std::string name;
+    ObjectType typeBefore = ObjectType::Mesh;
+    ObjectType typeAfter = ObjectType::Mesh;
+    uint8_t changedTransform = 0;  // always 0 for Added and Removed
+    Transform before;
+    Transform after;
+    // Added objects list every property, Removed objects none
+    std::vector<PropertyDelta> properties;
+};
+
+struct SettingDelta {
+    std::string key;
+    bool hadBefore = false;
+    bool hasAfter = false;
+    std::string before;
+    std::string after;
+};
+
+struct LevelDelta {
+    // Removed and modified objects in the order of the first level, then
+    // added objects in the order of the second; settings in key order
+    std::vector<ObjectDelta> objects;
+    std::vector<SettingDelta> settings;
+
+    bool IsEmpty() const { return objects.empty() && settings.empty(); }
+    // One line per object or setting, then one indented line per changed field
+    std::string Format() const;
+};
+
+// Changes that turn from into to
+LevelDelta DiffLevels(const LevelData& from, const LevelData& to);
+
+// Applies a delta produced against a level with the same content. Deltas
+// that no longer fit (adding a name that exists, removing or modifying one
+// that does not) are skipped and counted; returns the number skipped.
+size_t ApplyLevelDelta(LevelData& level, const LevelDelta& delta);
+
+// A field both sides changed to different values; the merge keeps ours
+struct MergeConflict {
+    std::string name;   // object name, or setting key when field is "SETTING"
+    std::string field;  // "OBJECT", "TYPE", "POSITION", "ROTATION", "SCALE", "PROPERTY <key>" or "SETTING"
+    std::string base;
+    std::string ours;
+    std::string theirs;
+};
+
+// Writes ours plus the changes theirs made since base into result. Changes to
+// different fields of the same object merge; see MergeConflict for the rest.
+void MergeLevels(const LevelData& base, const LevelData& ours, const LevelData& theirs, LevelData& result,
+    std::vector<MergeConflict>& conflicts);
+
+// Replaces target's objects and settings with copies of source's
+void CopyLevel(const LevelData& source, LevelData& target);
@@ -5,7 +5,24 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <unordered_map>
+#include <string_view>
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <future>
+#include <memory_resource>
+#include <mutex>
+#include "TransformStore.h"
+#include "CompileCache.h"
+#include "GameBuild.h"
+#include "LevelArena.h"
+#include "LevelHash.h"
+#include "LevelProperties.h"
+#include "LevelSnapshot.h"
+#include "SpatialIndex.h"
+#include "ThreadPool.h"
 
 namespace fs = std::filesystem;
 
@@ -14,6 +31,8 @@ class LevelObject;
 class LevelData;
 class EditorUI;
 class CompilerSystem;
+class ThreadPool;
+struct LevelTextChunk;
 
 // Object types
 enum class ObjectType {
@@ -24,58 +43,493 @@ enum class ObjectType {
     Spawn
 };
 
-// Level object class
+const size_t OBJECT_TYPE_COUNT = 5;
+
+// Read-only view over a contiguous run of object pointers
+class ObjectSpan {
+public:
+    ObjectSpan() : begin_(nullptr), end_(nullptr) {}
+    ObjectSpan(LevelObject* const* begin, LevelObject* const* end) : begin_(begin), end_(end) {}
+
+    LevelObject* const* begin() const { return begin_; }
+    LevelObject* const* end() const { return end_; }
+    size_t size() const { return static_cast<size_t>(end_ - begin_); }
+    bool empty() const { return begin_ == end_; }
+    LevelObject* operator[](size_t i) const { return begin_[i]; }
+
+private:
+    LevelObject* const* begin_;
+    LevelObject* const* end_;
+};
+
+// Stable reference to an object in a LevelData. Stays valid while other
+// objects are added or removed; a removed object's handle never resolves again.
+struct ObjectHandle {
+    static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+    uint32_t index = INVALID_INDEX;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return index != INVALID_INDEX; }
+    bool operator==(const ObjectHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const ObjectHandle& other) const { return !(*this == other); }
+};
+
+// An object as the text format writes it, taken from a live object or a
+// snapshot so both are written by WriteObjectText. Points into its source.
+struct ObjectTextView {
+    struct Property {
+        std::string_view key;
+        const PropertyValue* value;
+        std::string_view text;  // value of String properties
+    };
+
+    std::string_view name;
+    ObjectType type;
+    Transform transform;
+    SmallVector<Property, 8> properties;  // in key text order
+};
+
+// OBJECT ... END_OBJECT
+void WriteObjectText(std::ostream& file, const ObjectTextView& object);
+// Header and settings of a text level, up to OBJECTS_COUNT; the objects follow
+void WriteLevelTextHeader(std::ostream& file, uint64_t journalId, const std::map<std::string, std::string>& settings,
+    size_t objectCount);
+
+// Level object class.
+// Objects in a LevelData are allocated from the level's memory pool together
+// with their name and spilled properties. The transform lives in the level's
+// TransformStore and the object is a view onto its row; property keys and
+// string values are interned in the level's StringPool.
+// An object created on its own is detached: it holds all of that in detached_
+// until AddObject copies it into a level.
 class LevelObject {
 public:
     LevelObject(const std::string& name, ObjectType type);
     ~LevelObject();
 
+    LevelObject(const LevelObject&) = delete;
+    LevelObject& operator=(const LevelObject&) = delete;
+
     void SetPosition(float x, float y, float z);
     void SetRotation(float x, float y, float z);
     void SetScale(float x, float y, float z);
-    void SetProperty(const std::string& key, const std::string& value);
-    std::string GetProperty(const std::string& key);
 
-    std::string GetName() const { return name_; }
+    // Text values are stored as the narrowest type that formats back to the same text
+    void SetProperty(std::string_view key, std::string_view value);
+    void SetProperty(std::string_view key, float value);
+    void SetProperty(std::string_view key, int value);
+    void SetProperty(std::string_view key, const Float3& value);
+    bool RemoveProperty(std::string_view key);
+    std::string GetProperty(std::string_view key) const;
+
+    // Typed reads; Int converts to float, anything else returns the fallback
+    const PropertyValue* FindProperty(std::string_view key) const;
+    // keyId from GetStrings().Find(); INVALID_ID finds nothing
+    const PropertyValue* FindPropertyById(uint32_t keyId) const;
+    float GetFloatProperty(std::string_view key, float fallback = 0.0f) const;
+    int GetIntProperty(std::string_view key, int fallback = 0) const;
+    Float3 GetVec3Property(std::string_view key, const Float3& fallback = { 0.0f, 0.0f, 0.0f }) const;
+
+    std::string_view GetName() const { return name_; }
     ObjectType GetType() const { return type_; }
-    const float* GetPosition() const { return position_; }
-    const float* GetRotation() const { return rotation_; }
-    const float* GetScale() const { return scale_; }
-
-    void Serialize(std::ofstream& file);
-    static std::unique_ptr<LevelObject> Deserialize(std::ifstream& file);
+    Float3 GetPosition() const { return transforms_ ? transforms_->GetPosition(transformRow_) : detached_->transform.position; }
+    Float3 GetRotation() const { return transforms_ ? transforms_->GetRotation(transformRow_) : detached_->transform.rotation; }
+    Float3 GetScale() const { return transforms_ ? transforms_->GetScale(transformRow_) : detached_->transform.scale; }
+
+    // Properties in key id order; GetPropertyOrder gives key text order
+    const PropertyList& GetProperties() const { return properties_; }
+    void GetPropertyOrder(PropertyOrder& order) const { GetKeyTextOrder(properties_, *strings_, order); }
+    size_t GetPropertyCount() const { return properties_.size(); }
+    std::string_view GetPropertyKey(size_t index) const { return strings_->Get(properties_[static_cast<uint32_t>(index)].key); }
+    std::string GetPropertyText(size_t index) const { return FormatPropertyValue(properties_[static_cast<uint32_t>(index)].value, *strings_); }
+    const StringPool& GetStrings() const { return *strings_; }
+
+    void GetTextView(ObjectTextView& view) const;
+    void Serialize(std::ostream& file) const;
+    static std::unique_ptr<LevelObject> Deserialize(std::istream& file);
+
+    // Hash of name, type, transform and properties (LevelHash.h); equal
+    // objects hash the same in any level. LevelData::GetObjectHash caches it.
+    uint64_t ComputeContentHash() const;
 
 private:
-    std::string name_;
+    friend class LevelData;
+
+    struct Detached {
+        std::string name;
+        Transform transform;
+        StringPool strings;
+    };
+
+    // journalFlags_ bits: edits already covered by a pending journal entry
+    static const uint8_t JOURNAL_ADDED = 1;
+    static const uint8_t JOURNAL_TRANSFORM = 2;
+
+    // hashFlags_ bits: contentHash_ is stale / contentHash_ is counted in contentCell_
+    static const uint8_t HASH_DIRTY = 1;
+    static const uint8_t HASH_IN_CELL = 2;
+
+    // Level objects are only made by LevelData, in its pool
+    LevelObject(std::string_view storedName, ObjectType type, LevelData* level);
+    void CopyProperties(const LevelObject& detached);
+    void OnTransformChanged();
+    void StoreProperty(std::string_view key, const PropertyValue& value);
+
+    std::string_view name_;  // into the level's pool or detached_->name
     ObjectType type_;
-    float position_[3];
-    float rotation_[3];
-    float scale_[3];
-    std::map<std::string, std::string> properties_;
+    LevelData* level_;
+    TransformStore* transforms_;
+    uint32_t transformRow_;
+    uint32_t typeSlot_;  // position in the level's bucket for type_
+    StringPool* strings_;
+    uint32_t spatialLeaf_;  // leaf in LevelData::spatial_ once the index is built
+    uint8_t journalFlags_;
+    uint8_t hashFlags_;
+    bool snapshotDirty_;  // slot is already in LevelData::changedSlots_
+    uint64_t contentHash_;
+    ContentCellKey contentCell_;
+    std::unique_ptr<Detached> detached_;
+    PropertyList properties_;
 };
 
+// Reported while LevelData::SaveToFileAsync writes; the last report has
+// finished set, after the file is in place or the save has failed
+struct SaveProgress {
+    size_t objectsWritten = 0;
+    size_t objectCount = 0;
+    bool finished = false;
+    bool succeeded = false;
+};
+
+typedef std::function<void(const SaveProgress&)> SaveProgressCallback;
+
 // Level data class
 class LevelData {
 public:
     LevelData();
     ~LevelData();
 
-    void AddObject(std::unique_ptr<LevelObject> object);
-    void RemoveObject(const std::string& name);
-    LevelObject* GetObject(const std::string& name);
-    std::vector<LevelObject*> GetObjectsByType(ObjectType type) const;
+    // Objects point into transforms_ and strings_, so a level cannot be copied or moved
+    LevelData(const LevelData&) = delete;
+    LevelData& operator=(const LevelData&) = delete;
+
+    // Names are unique; adding a second object with an existing name fails and returns an invalid handle.
+    // CreateObject builds the object in the level's storage. AddObject copies a
+    // detached object there and destroys it; use the returned handle afterwards.
+    ObjectHandle CreateObject(std::string_view name, ObjectType type, const Transform& transform = Transform());
+    ObjectHandle AddObject(std::unique_ptr<LevelObject> object);
+    bool RemoveObject(std::string_view name);
+    bool RemoveObject(ObjectHandle handle);
+    void Reserve(size_t objectCount);
+
+    LevelObject* GetObject(std::string_view name);
+    const LevelObject* GetObject(std::string_view name) const;
+    LevelObject* GetObject(ObjectHandle handle);
+    const LevelObject* GetObject(ObjectHandle handle) const;
+    ObjectHandle FindHandle(std::string_view name) const;
+    bool Contains(std::string_view name) const { return nameIndex_.count(name) != 0; }
+    size_t GetObjectCount() const { return objects_.size(); }
+
+    // Per-type buckets kept up to date by AddObject/RemoveObject, so queries
+    // neither allocate nor scan. A span is invalidated by the next add or remove.
+    ObjectSpan GetObjectsByType(ObjectType type) const;
+    size_t CountObjectsByType(ObjectType type) const { return GetObjectsByType(type).size(); }
+
+    // Calls visit(LevelObject*) for every object of type that has key and
+    // whose value passes predicate(const PropertyValue&). Returns the match count.
+    template <typename Predicate, typename Visitor>
+    size_t ForEachObjectWith(ObjectType type, std::string_view key, Predicate predicate, Visitor visit) const;
+
+    // Batch transform operations over the structure-of-arrays store
+    void TranslateObjects(const std::vector<ObjectHandle>& selection, float dx, float dy, float dz);
+    void ComputeWorldMatrices(std::vector<Float4x4>& matrices) const;
+    bool ComputeBounds(Float3& minBounds, Float3& maxBounds) const { return transforms_.ComputeBounds(minBounds, maxBounds); }
+    const TransformStore& GetTransforms() const { return transforms_; }
+
+    // Spatial queries (SpatialIndex.h) against each object's bounds, the unit
+    // cube under its transform. The index is built by the first query and then
+    // kept up to date by adds, removes and transform edits. Results replace the
+    // contents of out. Not safe to call concurrently before the first build.
+    void QueryBox(const Aabb& box, std::vector<LevelObject*>& out) const;
+    void QuerySphere(const Float3& center, float radius, std::vector<LevelObject*>& out) const;
+    void QueryFrustum(const Frustum& frustum, std::vector<LevelObject*>& out) const;
+    // Every object the ray passes through within maxDistance, in no particular order
+    void QueryRay(const Float3& origin, const Float3& direction, float maxDistance, std::vector<LevelObject*>& out) const;
+    // Nearest object along the ray, or nullptr
+    LevelObject* Raycast(const Float3& origin, const Float3& direction, float maxDistance, float* hitDistance = nullptr) const;
+    const AabbTree& GetSpatialIndex() const;
+
+    // Content hashes (LevelHash.h). Object hashes are summed into cells by
+    // type and position, and the cells and settings are chained in key order
+    // into one root, so comparing two roots tells whether anything changed.
+    // Built by the first call; after that only objects edited since the
+    // previous call are rehashed. Not safe to call concurrently.
+    uint64_t GetContentHash() const;
+    // Cached ComputeContentHash of an object in this level
+    uint64_t GetObjectHash(const LevelObject* object) const;
+    const std::map<ContentCellKey, ContentCell>& GetContentCells() const;
+
+    // Keys and string property values of every object. Values an object no
+    // longer holds stay interned too, so the pool grows with the distinct
+    // strings used since the last load or Clear, which frees all of it.
+    const StringPool& GetStrings() const { return strings_; }
+    PropertyMemoryReport GetPropertyMemoryReport() const;
 
     void SetSetting(const std::string& key, const std::string& value);
+    bool RemoveSetting(const std::string& key);
     std::string GetSetting(const std::string& key) const;
 
+    const std::map<std::string, std::string>& GetSettings() const { return settings_; }
+    void Clear();
+
     bool SaveToFile(const fs::path& path);
     bool LoadFromFile(const fs::path& path);
 
-    const std::vector<std::unique_ptr<LevelObject>>& GetObjects() const { return objects_; }
+    // Splits a text level on object boundaries and parses the pieces on a worker pool
+    bool LoadFromFileParallel(const fs::path& path);
+    bool LoadFromFileParallel(const fs::path& path, ThreadPool& pool);
+
+    // Incremental saving (LevelJournal.h). SaveToFile writes a full snapshot;
+    // SaveIncremental appends only the edits made since the last save to the
+    // snapshot's journal, and LoadFromFile replays it.
+    bool SaveIncremental(const fs::path& path);
+    // Folds the journal into a new snapshot on pool. Editing and incremental
+    // saves can continue while it runs.
+    std::shared_future<bool> CompactJournal(const fs::path& path);
+    std::shared_future<bool> CompactJournal(const fs::path& path, ThreadPool& pool);
+    // SaveToFile on pool: takes a snapshot now, writes it to a temporary file
+    // and renames that over path. Editing can continue meanwhile; the next
+    // save waits for this one. progress runs on the saving thread.
+    std::shared_future<bool> SaveToFileAsync(const fs::path& path, SaveProgressCallback progress = nullptr);
+    std::shared_future<bool> SaveToFileAsync(const fs::path& path, ThreadPool& pool, SaveProgressCallback progress);
+    bool IsSaving() const;
+    size_t GetPendingEditCount() const { return edits_.size(); }
+
+    // Copy-on-write snapshots (LevelSnapshot.h). The first snapshot after a
+    // load or Clear costs O(objects); later ones copy only what changed since
+    // the previous snapshot. Restoring keeps the handles of objects that exist
+    // in both states; objects it has to re-create get new handles.
+    LevelSnapshot TakeSnapshot();
+    // The same state for copies taken outside the undo history, such as
+    // background saves and compiles. Never moves a base TakeSnapshot made;
+    // until there is one, each copy is the base of the next, so copies cost
+    // only what changed since the last one with or without undo.
+    LevelSnapshot CopySnapshot();
+    void RestoreSnapshot(const LevelSnapshot& snapshot);
+    bool HasChangesSinceSnapshot() const { return !trackChanges_ || settingsChanged_ || !changedSlots_.empty(); }
+    // Advances with every edit, load and Clear; UndoHistory compares it with
+    // the value at its current state to find uncommitted edits
+    uint64_t GetEditGeneration() const { return editGeneration_; }
+
+    // Binary (LevelBinary.h), XML (LevelXml.h) and block-compressed text
+    // (LevelCompression.h) formats, LoadFromFile detects all three
+    bool SaveToBinaryFile(const fs::path& path) const;
+    bool LoadFromBinaryFile(const fs::path& path);
+    bool SaveToXmlFile(const fs::path& path) const;
+    bool LoadFromXmlFile(const fs::path& path);
+    bool SaveToCompressedFile(const fs::path& path) const;
+    bool LoadFromCompressedFile(const fs::path& path);
+    // Names are unique, so a load keeps the first object of each name; these
+    // are the names of the later objects the last load dropped. Emptied by Clear.
+    const std::vector<std::string>& GetDroppedDuplicateNames() const { return droppedDuplicates_; }
+
+    const std::vector<LevelObject*>& GetObjects() const { return objects_; }
+
+    // Storage of the objects, their names and spilled property lists. Clear
+    // and the loaders give all of it back at once instead of object by object.
+    const LevelArena& GetArena() const { return arena_; }
 
 private:
-    std::vector<std::unique_ptr<LevelObject>> objects_;
+    friend class LevelObject;
+
+    struct ObjectSlot {
+        uint32_t denseIndex;
+        uint32_t generation;
+    };
+
+    // Change since the last save. Objects are referenced by slot and
+    // generation so edits to a removed object are dropped; text indexes editText_.
+    enum class EditKind : uint8_t {
+        Add,
+        Remove,
+        Transform,
+        Property,
+        Setting
+    };
+    struct Edit {
+        EditKind kind;
+        uint32_t slot;
+        uint32_t generation;
+        uint32_t key;  // StringPool id for Property, editText_ index for Remove/Setting
+    };
+
+    LevelObject* NewObject(std::string_view name, ObjectType type);
+    void DeleteObject(LevelObject* object);
+    uint32_t TakeFreeSlot();
+    ObjectHandle InsertAt(uint32_t slotIndex, LevelObject* object, const Transform& transform);
+    void ClaimSlot(uint32_t slotIndex);
+    void RemoveAt(uint32_t slotIndex);
+
+    void RecordEdit(EditKind kind, LevelObject* object, uint32_t key);
+    void ResetEdits();
+    const LevelObject* GetEditedObject(const Edit& edit) const;
+    // Object in slotIndex whatever its generation, nullptr for a free slot
+    LevelObject* GetSlotObject(uint32_t slotIndex) const;
+
+    bool LoadText(const fs::path& path);
+    // CreateObject for the loaders, which note a dropped duplicate's name
+    LevelObject* CreateLoadedObject(std::string_view name, ObjectType type, const Transform& transform);
+    void AddTextChunk(LevelTextChunk& chunk);
+    bool WriteSnapshot(const fs::path& path, uint64_t journalId) const;
+    void WaitForBackgroundSave();
+    // Objects in slot order, the order snapshots visit them in
+    void WriteText(std::ostream& file, uint64_t journalId) const;
+    bool LoadJournal(const fs::path& path);
+    bool ReplayJournal(const fs::path& journalPath, uint64_t baseId);
+
+    void RecordSettingEdit(const std::string& key);
+    LevelSnapshot BuildSnapshot() const;
+    void ClearSnapshotChanges();
+    void ApplySnapshotObject(LevelObject* object, const SnapshotObject& state);
+
+    void BuildContentHashes() const;
+    void RefreshContentHashes() const;
+    void AddContentHash(LevelObject* object) const;
+    void RemoveContentHash(LevelObject* object) const;
+
+    void BuildSpatialIndex() const;
+    void UpdateSpatialIndex(const LevelObject* object);
+    Aabb GetObjectBounds(uint32_t row) const;
+
+    // Objects come from objectPool_, which takes its memory from arena_.
+    // nameIndex_ nodes are recycled through indexPool_, which Clear keeps.
+    // All three are declared first so they outlive what is allocated from them.
+    LevelArena arena_;
+    std::pmr::unsynchronized_pool_resource objectPool_;
+    std::pmr::unsynchronized_pool_resource indexPool_;
+
+    // objects_ is dense; slots_ maps handles onto it and is recycled through freeSlots_.
+    // A free slot's denseIndex is its position in freeSlots_.
+    // Row i of transforms_ belongs to objects_[i].
+    std::vector<LevelObject*> objects_;
+    TransformStore transforms_;
+    StringPool strings_;
+    std::vector<uint32_t> denseSlots_;
+    std::vector<ObjectSlot> slots_;
+    std::vector<uint32_t> freeSlots_;
+    std::vector<LevelObject*> typeBuckets_[OBJECT_TYPE_COUNT];
+    std::pmr::unordered_map<std::string_view, uint32_t> nameIndex_;  // keys view each object's own name
     std::map<std::string, std::string> settings_;
+    std::vector<std::string> droppedDuplicates_;
+
+    // Id written into the last snapshot, or 0 when edits are not journaled
+    uint64_t journalId_;
+    std::vector<Edit> edits_;
+    std::vector<std::string> editText_;
+    std::shared_future<bool> compaction_;
+    std::shared_future<bool> backgroundSave_;
+
+    // Slots changed since lastSnapshot_; off until the first snapshot after a load or Clear
+    bool trackChanges_;
+    bool copyOwnsBase_;  // lastSnapshot_ came from CopySnapshot, not TakeSnapshot
+    bool settingsChanged_;
+    std::vector<uint32_t> changedSlots_;
+    LevelSnapshot lastSnapshot_;
+    uint64_t editGeneration_;
+
+    // Content tree; hashDirtySlots_ holds objects edited since the last
+    // refresh, while removals leave their cell at once
+    mutable std::map<ContentCellKey, ContentCell> contentCells_;
+    mutable std::vector<uint32_t> hashDirtySlots_;
+    mutable uint64_t cellsHash_;
+    mutable bool cellsHashValid_;
+    mutable bool hashBuilt_;
+
+    // Leaf user data is the object's slot, which survives swap-and-pop removal
+    mutable AabbTree spatial_;
+    mutable bool spatialBuilt_;
+};
+
+template <typename Predicate, typename Visitor>
+size_t LevelData::ForEachObjectWith(ObjectType type, std::string_view key, Predicate predicate, Visitor visit) const {
+    // Resolve the key once; a key that was never interned matches nothing
+    uint32_t keyId = strings_.Find(key);
+    if (keyId == StringPool::INVALID_ID) {
+        return 0;
+    }
+
+    size_t matches = 0;
+    for (LevelObject* obj : GetObjectsByType(type)) {
+        const PropertyValue* value = obj->FindPropertyById(keyId);
+        if (value && predicate(*value)) {
+            visit(obj);
+            ++matches;
+        }
+    }
+    return matches;
+}
+
+// Compile cache directory under the compiler's output path
+const char* const COMPILE_CACHE_DIR = ".cache";
+
+// How the compiled game gets its level
+enum class GameCodeMode {
+    Generated,  // one CreateObject call per object, sharded (GameCodeShards.h)
+    Baked       // a level asset loaded at startup; see LevelBake.h
+};
+
+// A compile starts Running; a cancel request moves it to Cancelling, and it
+// ends in Succeeded, Failed or Cancelled until the next one starts
+enum class CompileState {
+    Idle,
+    Running,
+    Cancelling,
+    Succeeded,
+    Failed,
+    Cancelled
+};
+
+enum class CompileStage {
+    None,
+    Copy,       // syncing engine files
+    Cook,       // cooking the assets the level references
+    Generate,   // writing game code or the baked level
+    Build       // compiling and linking
+};
+
+struct CompileProgress {
+    CompileStage stage = CompileStage::None;
+    size_t completed = 0;  // steps of this stage done; assets for Cook, units for Build
+    size_t total = 0;
+};
+
+// Compile log written by the compiling thread and read by the editor while
+// it runs. Entries are only ever appended, so a reader keeps a cursor and
+// copies just what is new.
+class CompileLog {
+public:
+    void Append(std::string text);
+    // Starts a new compile's part of the log. Drops the entries readers have
+    // read and every run before the last, so the log holds at most two runs.
+    void BeginRun();
+    // Appends the entries after cursor to text and moves cursor past them.
+    // Cursors count every entry ever appended, so they stay valid when
+    // entries are dropped; one behind them resumes at the oldest entry kept.
+    // Does not wait for a writer: returns false, having read nothing, when
+    // the log is busy, and the caller polls again later.
+    bool ReadSince(size_t& cursor, std::string& text) const;
+    // Everything since the last BeginRun
+    std::string GetText() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::string> entries_;
+    // Positions of entries_[0], of the current run's first entry and of the
+    // end of what readers have read, counting every entry ever appended
+    size_t firstEntry_ = 0;
+    size_t runStart_ = 0;
+    mutable size_t consumed_ = 0;
 };
 
 // Compiler system for creating game builds
@@ -85,20 +539,68 @@ public:
     ~CompilerSystem();
 
     bool Initialize(const fs::path& enginePath, const fs::path& templatePath, const fs::path& outputPath);
+    // Compiles on the calling thread
     bool CompileLevel(const LevelData& level, const std::string& gameName);
-    const std::string& GetCompilationLog() const { return compilationLog_; }
-    bool IsCompiling() const { return isCompiling_; }
+    // Compiles a snapshot of level on the compiler's own thread, so the level
+    // can be edited meanwhile. Returns false if a compile is already running.
+    bool StartCompile(LevelData& level, const std::string& gameName);
+    // Stops the running compile at its next check: between stages, or
+    // before the next unit starts compiling
+    void CancelCompile();
+    // Returns whether the last compile succeeded once it has ended
+    bool WaitForCompile();
+    CompileState GetState() const { return state_.load(); }
+    CompileProgress GetProgress() const;
+    const CompileLog& GetLog() const { return compilationLog_; }
+    std::string GetCompilationLog() const { return compilationLog_.GetText(); }
+    bool IsCompiling() const;
+    const BuildToolchain& GetToolchain() const { return toolchain_; }
+    void SetToolchain(const BuildToolchain& toolchain) { toolchain_ = toolchain; }
+    GameCodeMode GetCodeMode() const { return codeMode_; }
+    void SetCodeMode(GameCodeMode mode) { codeMode_ = mode; }
+    // Size limit of the compile cache under outputPath/COMPILE_CACHE_DIR;
+    // 0 turns the cache off. Call before Initialize or between compiles.
+    void SetCacheLimit(uint64_t bytes);
+    // Directory the level's asset references are relative to, usually the
+    // level file's; when empty, assets are not cooked. Set between compiles.
+    const fs::path& GetAssetPath() const { return assetPath_; }
+    void SetAssetPath(const fs::path& assetPath) { assetPath_ = assetPath; }
+    CompileCacheStats GetCacheStats() const { return cache_.GetStats(); }
 
 private:
+    bool BeginCompile();
+    bool RunCompile(const LevelData& level, const std::string& gameName);
+    void EndCompile(bool succeeded);
+    void SetStage(CompileStage stage, size_t total);
+    void LogCacheUse();
+    bool IsCancelRequested() const { return state_.load() == CompileState::Cancelling; }
     bool CopyEngineFiles(const fs::path& destination);
+    bool CookLevelAssets(const LevelData& level, const fs::path& destination);
     bool GenerateGameCode(const LevelData& level, const fs::path& destination);
+    // Name and contents of each file GenerateGameCode writes
+    void GenerateGameFiles(const LevelData& level, std::vector<std::pair<std::string, std::string>>& files);
     bool BuildGame(const fs::path& destination);
+    CompileCache* GetCache() { return cacheLimit_ > 0 && cache_.IsOpen() ? &cache_ : nullptr; }
 
     fs::path enginePath_;
     fs::path templatePath_;
     fs::path outputPath_;
-    std::string compilationLog_;
-    bool isCompiling_;
+    fs::path assetPath_;
+    BuildToolchain toolchain_;
+    GameCodeMode codeMode_;
+    CompileCache cache_;
+    uint64_t cacheLimit_;
+    CompileCacheStats cacheAtStart_;
+    CompileLog compilationLog_;
+    std::atomic<CompileState> state_;
+    std::atomic<CompileStage> stage_;
+    std::atomic<size_t> stageCompleted_;
+    std::atomic<size_t> stageTotal_;
+    LevelData compileLevel_;  // StartCompile's copy; each snapshot restores only what changed
+    std::future<void> compileTask_;
+    // A compile runs for minutes; on the shared pool it would hold up loads
+    // and saves queued behind it
+    ThreadPool compilePool_;
 };
 
 // Editor UI class
@@ -142,9 +644,18 @@ public:
 
     // Event handlers
     void OnNewLevel();
+    // Saves to levelPath_, asking for a file first when there is none
     void OnSaveLevel();
+    void OnSaveLevelAs();
     void OnLoadLevel();
     void OnCompileLevel();
+    void OnCancelCompile();
+    // WM_TIMER for COMPILE_TIMER_ID, set while OnCompileLevel's compile runs
+    void OnCompileTimer();
+    // WM_SAVE_PROGRESS and WM_SAVE_FINISHED, posted while OnSaveLevel's
+    // background save runs
+    void OnSaveProgress(size_t objectsWritten, size_t objectCount);
+    void OnSaveFinished(bool succeeded);
 
     // Window procedure
     static LRESULT CALLBACK StaticWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
@@ -155,12 +666,15 @@ private:
     HWND CreateEditorWindow();
     void SetupMenus();
     bool ProcessMessage();
+    void SetStatusText(const std::string& text);
 
     HINSTANCE hInstance_;
     HWND hWnd_;
     LevelData levelData_;
     std::unique_ptr<EditorUI> editorUI_;
     std::unique_ptr<CompilerSystem> compilerSystem_;
+    fs::path levelPath_;  // file the level was loaded from or last saved to
+    size_t compileLogCursor_ = 0;  // compile log entries already shown
     bool isRunning_;
 
     // Resource IDs - moved to this header to prevent redefinition
@@ -170,9 +684,20 @@ private:
     static const int IDM_COMPILE = 1004;
     static const int IDM_EXIT = 1005;
     static const int IDM_ABOUT = 1006;
+    static const int IDM_CANCEL_COMPILE = 1007;
+    static const int IDM_SAVE_AS = 1008;
 
     static const int ID_TOOLBAR = 2001;
     static const int ID_STATUSBAR = 2002;
     static const int ID_OBJECTLIST = 2003;
     static const int ID_PROPERTYLIST = 2004;
+
+    // Posted from the saving thread: objects written/total in wParam/lParam,
+    // then success in wParam
+    static const UINT WM_SAVE_PROGRESS = WM_APP + 1;
+    static const UINT WM_SAVE_FINISHED = WM_APP + 2;
+
+    // Polls the background compile's state, progress and log
+    static const UINT_PTR COMPILE_TIMER_ID = 1;
+    static const UINT COMPILE_POLL_MS = 100;
 };
\ No newline at end of file
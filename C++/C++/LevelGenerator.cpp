@@ -0,0 +1,111 @@
+#include "LevelGenerator.h"
+#include <cmath>
+#include <random>
+#include <string>
+
+namespace {
+
+    // Keys shared by all objects, so they intern once like in authored levels
+    const char* const PROPERTY_KEYS[] = {
+        "health", "damage", "speed", "radius", "intensity", "color", "offset",
+        "mesh", "material", "team", "script", "sound", "spawnDelay", "layer"
+    };
+    const size_t PROPERTY_KEY_COUNT = sizeof(PROPERTY_KEYS) / sizeof(PROPERTY_KEYS[0]);
+
+    const char* const STRING_VALUES[] = {
+        "rock", "tree", "crate", "barrel", "red", "blue", "door_open", "alarm",
+        "wood", "metal", "stone", "glass"
+    };
+    const size_t STRING_VALUE_COUNT = sizeof(STRING_VALUES) / sizeof(STRING_VALUES[0]);
+
+    const char* const TYPE_PREFIXES[OBJECT_TYPE_COUNT] = { "Mesh", "Light", "Camera", "Trigger", "Spawn" };
+
+    // [0, 1) from one generator output
+    double Unit(std::mt19937& random) {
+        return random() / 4294967296.0;
+    }
+
+    float Range(std::mt19937& random, float low, float high) {
+        return low + static_cast<float>(Unit(random)) * (high - low);
+    }
+
+    size_t Below(std::mt19937& random, size_t count) {
+        return static_cast<size_t>(Unit(random) * count);
+    }
+
+    ObjectType PickType(std::mt19937& random, const float* weights, float totalWeight) {
+        float pick = Range(random, 0.0f, totalWeight);
+        for (size_t i = 0; i + 1 < OBJECT_TYPE_COUNT; ++i) {
+            if (pick < weights[i]) {
+                return static_cast<ObjectType>(i);
+            }
+            pick -= weights[i];
+        }
+        return static_cast<ObjectType>(OBJECT_TYPE_COUNT - 1);
+    }
+
+    // Text in the forms level files hold, so properties parse to every PropertyType
+    std::string MakeValue(std::mt19937& random) {
+        switch (random() % 4) {
+        case 0:
+            return std::to_string(static_cast<int>(Below(random, 1000)));
+        case 1:
+            return std::to_string(Below(random, 100)) + "." + std::to_string(Below(random, 10));
+        case 2:
+            return std::to_string(Below(random, 10)) + "," + std::to_string(Below(random, 10)) + "," + std::to_string(Below(random, 10));
+        default:
+            return STRING_VALUES[Below(random, STRING_VALUE_COUNT)];
+        }
+    }
+
+}
+
+void GenerateLevel(const LevelGeneratorOptions& options, LevelData& level) {
+    level.Clear();
+    level.Reserve(options.objectCount);
+
+    std::mt19937 random(options.seed);
+    float extent = options.extent > 0.0f ? options.extent : 0.5f * std::cbrt(static_cast<float>(options.objectCount) * 1000.0f);
+
+    // Negative weights count as 0; with nothing left every type is equally likely
+    float weights[OBJECT_TYPE_COUNT];
+    float totalWeight = 0.0f;
+    for (size_t i = 0; i < OBJECT_TYPE_COUNT; ++i) {
+        weights[i] = options.typeWeights[i] > 0.0f ? options.typeWeights[i] : 0.0f;
+        totalWeight += weights[i];
+    }
+    if (totalWeight <= 0.0f) {
+        for (float& weight : weights) {
+            weight = 1.0f;
+        }
+        totalWeight = static_cast<float>(OBJECT_TYPE_COUNT);
+    }
+
+    size_t maxProperties = options.maxProperties > PROPERTY_KEY_COUNT ? PROPERTY_KEY_COUNT : options.maxProperties;
+    size_t minProperties = options.minProperties > maxProperties ? maxProperties : options.minProperties;
+
+    for (size_t i = 0; i < options.objectCount; ++i) {
+        ObjectType type = PickType(random, weights, totalWeight);
+        Transform transform;
+        transform.position = { Range(random, -extent, extent), Range(random, -extent, extent), Range(random, -extent, extent) };
+        transform.rotation = { 0.0f, Range(random, -180.0f, 180.0f), 0.0f };
+        float scale = Range(random, 0.5f, 4.0f);
+        transform.scale = { scale, scale, scale };
+
+        LevelObject* object = level.GetObject(level.CreateObject(std::string(TYPE_PREFIXES[static_cast<size_t>(type)]) + std::to_string(i), type, transform));
+        if (!object) {
+            continue;
+        }
+
+        // Distinct keys: a random start in the key list, then consecutive keys
+        size_t propertyCount = minProperties + Below(random, maxProperties - minProperties + 1);
+        size_t firstKey = Below(random, PROPERTY_KEY_COUNT);
+        for (size_t p = 0; p < propertyCount; ++p) {
+            object->SetProperty(PROPERTY_KEYS[(firstKey + p) % PROPERTY_KEY_COUNT], MakeValue(random));
+        }
+    }
+
+    for (size_t i = 0; i < options.settingCount; ++i) {
+        level.SetSetting("Setting" + std::to_string(i), MakeValue(random));
+    }
+}
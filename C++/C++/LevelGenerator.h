@@ -0,0 +1,28 @@
+#pragma once
+
+#include "LevelEditor.h"
+#include <cstdint>
+
+// Deterministic synthetic levels for benchmarks
+//
+// The same options give the same level on every platform: values come
+// straight from std::mt19937, whose output the standard fixes, rather than
+// from the <random> distributions, which each library implements its own way.
+
+struct LevelGeneratorOptions {
+    size_t objectCount = 1000;
+    uint32_t seed = 1;
+    // Relative share of each ObjectType, indexed by its value
+    float typeWeights[OBJECT_TYPE_COUNT] = { 60.0f, 15.0f, 2.0f, 13.0f, 10.0f };
+    // Each object gets between minProperties and maxProperties, mixing int,
+    // float, vec3 and string values
+    size_t minProperties = 1;
+    size_t maxProperties = 6;
+    size_t settingCount = 8;
+    // Half-size of the cube objects are placed in; 0 keeps about one object
+    // per 1000 cubic units whatever the count
+    float extent = 0.0f;
+};
+
+// Replaces the contents of level
+void GenerateLevel(const LevelGeneratorOptions& options, LevelData& level);
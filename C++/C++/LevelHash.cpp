@@ -0,0 +1,206 @@
+#include "LevelHash.h"
+#include "LevelEditor.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+    const uint64_t HASH_MULTIPLIER = 0x9E3779B97F4A7C15ull;
+
+    int32_t CellCoordinate(float value) {
+        float cell = std::floor(value / CONTENT_CELL_SIZE);
+        // NaN and out-of-range positions share the cells at the ends
+        if (!(cell > static_cast<float>(std::numeric_limits<int32_t>::min()))) {
+            return std::numeric_limits<int32_t>::min();
+        }
+        if (cell >= static_cast<float>(std::numeric_limits<int32_t>::max())) {
+            return std::numeric_limits<int32_t>::max();
+        }
+        return static_cast<int32_t>(cell);
+    }
+
+    uint64_t HashFloat3(const Float3& value, uint64_t seed) {
+        return HashFloat(value.z, HashFloat(value.y, HashFloat(value.x, seed)));
+    }
+
+    uint64_t HashCellKey(const ContentCellKey& key, uint64_t seed) {
+        seed = CombineHash(seed, key.type);
+        seed = CombineHash(seed, static_cast<uint32_t>(key.x));
+        seed = CombineHash(seed, static_cast<uint32_t>(key.y));
+        return CombineHash(seed, static_cast<uint32_t>(key.z));
+    }
+
+}
+
+uint64_t MixHash(uint64_t value) {
+    // splitmix64 finalizer
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ull;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBull;
+    value ^= value >> 31;
+    return value;
+}
+
+uint64_t CombineHash(uint64_t seed, uint64_t value) {
+    return MixHash(seed * HASH_MULTIPLIER + value + 1);
+}
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed ^ (size * HASH_MULTIPLIER);
+
+    // Eight bytes per step; the tail is zero-padded into one more word
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        hash = (hash ^ MixHash(word)) * HASH_MULTIPLIER;
+        bytes += 8;
+        size -= 8;
+    }
+    if (size > 0) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes, size);
+        hash = (hash ^ MixHash(word)) * HASH_MULTIPLIER;
+    }
+    return MixHash(hash);
+}
+
+uint64_t HashFloat(float value, uint64_t seed) {
+    if (value == 0.0f) {
+        value = 0.0f;
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return CombineHash(seed, bits);
+}
+
+ContentCellKey GetContentCellKey(uint32_t type, float x, float y, float z) {
+    return { type, CellCoordinate(x), CellCoordinate(y), CellCoordinate(z) };
+}
+
+// Implementation of LevelObject content hashing
+uint64_t LevelObject::ComputeContentHash() const {
+    uint64_t hash = HashString(GetName());
+    hash = CombineHash(hash, static_cast<uint64_t>(type_));
+    hash = HashFloat3(GetPosition(), hash);
+    hash = HashFloat3(GetRotation(), hash);
+    hash = HashFloat3(GetScale(), hash);
+
+    // Entries are ordered by pool id, which differs between levels, so they
+    // are summed by content instead of chained
+    uint64_t properties = 0;
+    for (const PropertyEntry& entry : properties_) {
+        const PropertyValue& value = entry.value;
+        uint64_t entryHash = HashString(strings_->Get(entry.key));
+        entryHash = CombineHash(entryHash, static_cast<uint64_t>(value.type) << 8 | value.precision);
+        switch (value.type) {
+        case PropertyType::Float:
+            entryHash = HashFloat(value.f, entryHash);
+            break;
+        case PropertyType::Int:
+            entryHash = CombineHash(entryHash, static_cast<uint32_t>(value.i));
+            break;
+        case PropertyType::Vec3:
+            entryHash = HashFloat3(value.v, entryHash);
+            break;
+        case PropertyType::String:
+            entryHash = HashString(strings_->Get(value.s), entryHash);
+            break;
+        }
+        properties += MixHash(entryHash);
+    }
+    return CombineHash(hash, properties);
+}
+
+// Implementation of the LevelData content tree
+uint64_t LevelData::GetContentHash() const {
+    RefreshContentHashes();
+    if (!cellsHashValid_) {
+        cellsHash_ = HashString("LEVEL_CONTENT");
+        for (const auto& [key, cell] : contentCells_) {
+            cellsHash_ = CombineHash(HashCellKey(key, cellsHash_), cell.hash);
+        }
+        cellsHashValid_ = true;
+    }
+
+    // Settings are few and change without a hook, so they are chained every time
+    uint64_t hash = cellsHash_;
+    for (const auto& [key, value] : settings_) {
+        hash = HashString(value, HashString(key, hash));
+    }
+    return hash;
+}
+
+uint64_t LevelData::GetObjectHash(const LevelObject* object) const {
+    RefreshContentHashes();
+    return object->contentHash_;
+}
+
+const std::map<ContentCellKey, ContentCell>& LevelData::GetContentCells() const {
+    RefreshContentHashes();
+    return contentCells_;
+}
+
+void LevelData::BuildContentHashes() const {
+    contentCells_.clear();
+    hashDirtySlots_.clear();
+    for (LevelObject* object : objects_) {
+        object->hashFlags_ = 0;
+        AddContentHash(object);
+    }
+    cellsHashValid_ = false;
+    hashBuilt_ = true;
+}
+
+void LevelData::RefreshContentHashes() const {
+    if (!hashBuilt_) {
+        BuildContentHashes();
+        return;
+    }
+
+    for (uint32_t slotIndex : hashDirtySlots_) {
+        // The object may have been removed since, and its slot reused
+        uint32_t denseIndex = slots_[slotIndex].denseIndex;
+        if (denseIndex >= denseSlots_.size() || denseSlots_[denseIndex] != slotIndex) {
+            continue;
+        }
+        LevelObject* object = objects_[denseIndex];
+        if (!(object->hashFlags_ & LevelObject::HASH_DIRTY)) {
+            continue;
+        }
+        if (object->hashFlags_ & LevelObject::HASH_IN_CELL) {
+            RemoveContentHash(object);
+        }
+        AddContentHash(object);
+    }
+    hashDirtySlots_.clear();
+}
+
+void LevelData::AddContentHash(LevelObject* object) const {
+    Float3 position = transforms_.GetPosition(object->transformRow_);
+    object->contentHash_ = object->ComputeContentHash();
+    object->contentCell_ = GetContentCellKey(static_cast<uint32_t>(object->GetType()), position.x, position.y, position.z);
+    object->hashFlags_ = LevelObject::HASH_IN_CELL;
+
+    ContentCell& cell = contentCells_[object->contentCell_];
+    cell.hash += object->contentHash_;
+    ++cell.objectCount;
+    cellsHashValid_ = false;
+}
+
+void LevelData::RemoveContentHash(LevelObject* object) const {
+    if (!(object->hashFlags_ & LevelObject::HASH_IN_CELL)) {
+        return;
+    }
+
+    // Emptied cells go, so a level matches one that never had the object
+    auto it = contentCells_.find(object->contentCell_);
+    it->second.hash -= object->contentHash_;
+    if (--it->second.objectCount == 0) {
+        contentCells_.erase(it);
+    }
+    object->hashFlags_ &= static_cast<uint8_t>(~LevelObject::HASH_IN_CELL);
+    cellsHashValid_ = false;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Stable 64-bit content hashes
+//
+// Values depend only on the content hashed, never on pointers, StringPool ids
+// or insertion order, so they can be stored and compared across runs and
+// between levels. Floats are hashed by bit pattern with -0 folded into +0.
+// Multi-byte reads assume a little-endian host, like the binary level format.
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+inline uint64_t HashString(std::string_view text, uint64_t seed = 0) { return HashBytes(text.data(), text.size(), seed); }
+uint64_t HashFloat(float value, uint64_t seed);
+// Chains value onto seed; the order of calls matters
+uint64_t CombineHash(uint64_t seed, uint64_t value);
+// Finalizer; sums of mixed hashes stay well distributed
+uint64_t MixHash(uint64_t value);
+
+// Edge of the cubic cells objects are grouped into for the level content tree
+const float CONTENT_CELL_SIZE = 256.0f;
+
+// Leaf of the level content tree: objects of one type whose position falls in one cell
+struct ContentCellKey {
+    uint32_t type;
+    int32_t x;
+    int32_t y;
+    int32_t z;
+
+    bool operator==(const ContentCellKey& other) const {
+        return type == other.type && x == other.x && y == other.y && z == other.z;
+    }
+    bool operator!=(const ContentCellKey& other) const { return !(*this == other); }
+    bool operator<(const ContentCellKey& other) const {
+        if (type != other.type) {
+            return type < other.type;
+        }
+        if (x != other.x) {
+            return x < other.x;
+        }
+        if (y != other.y) {
+            return y < other.y;
+        }
+        return z < other.z;
+    }
+};
+
+// Object hashes are added rather than chained, so a cell does not depend on
+// the order its objects were added in and one object moves in or out in O(1)
+struct ContentCell {
+    uint64_t hash = 0;
+    uint32_t objectCount = 0;
+};
+
+ContentCellKey GetContentCellKey(uint32_t type, float x, float y, float z);
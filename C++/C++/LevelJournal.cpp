@@ -0,0 +1,480 @@
+#include "LevelJournal.h"
+#include "LevelNumbers.h"
+#include "LevelSnapshot.h"
+#include "ThreadPool.h"
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+
+namespace {
+
+    struct JournalHeader {
+        uint64_t base = 0;
+        uint64_t parent = 0;
+    };
+
+    bool ParseId(std::string_view line, std::string_view key, uint64_t& id) {
+        if (line.size() <= key.size() || line.compare(0, key.size(), key) != 0) {
+            return false;
+        }
+        const char* end = line.data() + line.size();
+        std::from_chars_result result = std::from_chars(line.data() + key.size(), end, id);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    bool ReadJournalHeader(std::istream& in, JournalHeader& header) {
+        std::string version;
+        std::string base;
+        std::string parent;
+        return std::getline(in, version) && std::getline(in, base) && std::getline(in, parent)
+            && version == std::string("LEVEL_JOURNAL_VERSION=") + LEVEL_JOURNAL_VERSION
+            && ParseId(base, "BASE=", header.base)
+            && ParseId(parent, "PARENT=", header.parent);
+    }
+
+    bool ReadJournalHeader(const fs::path& path, JournalHeader& header) {
+        std::ifstream file(path, std::ios::in);
+        return file.is_open() && ReadJournalHeader(file, header);
+    }
+
+    bool WriteJournalHeader(const fs::path& path, const JournalHeader& header) {
+        std::ofstream file(path, std::ios::out | std::ios::trunc);
+        file << "LEVEL_JOURNAL_VERSION=" << LEVEL_JOURNAL_VERSION << "\n";
+        file << "BASE=" << header.base << "\n";
+        file << "PARENT=" << header.parent << "\n";
+        file.close();
+        return !file.fail();
+    }
+
+    void WriteVector(std::ostream& file, const char* key, const Float3& value) {
+        file << key << "=";
+        WriteFloat3(file, value);
+        file << "\n";
+    }
+
+    // Writes SELECT only when the target differs from the previous line's
+    void Select(std::ostream& file, const LevelObject* object, const LevelObject*& selected) {
+        if (object != selected) {
+            file << "SELECT=" << object->GetName() << "\n";
+            selected = object;
+        }
+    }
+
+    // Objects between progress reports of a background save
+    const size_t SAVE_PROGRESS_INTERVAL = 4096;
+
+    void GetTextView(const SnapshotObject& object, ObjectTextView& view) {
+        view.name = object.name;
+        view.type = object.type;
+        view.transform = object.transform;
+        view.properties.clear();
+        for (const SnapshotProperty& property : object.properties) {
+            view.properties.push_back({ property.key, &property.value, property.text });
+        }
+    }
+
+    // The text LevelData::WriteText produces, from a snapshot; both visit
+    // objects in slot order
+    void WriteSnapshotText(std::ostream& file, const LevelSnapshot& snapshot, uint64_t journalId,
+        SaveProgress& state, const SaveProgressCallback& progress) {
+        WriteLevelTextHeader(file, journalId, snapshot.GetSettings(), snapshot.GetObjectCount());
+
+        ObjectTextView view;
+        snapshot.ForEachObject([&](const SnapshotObject& object) {
+            GetTextView(object, view);
+            WriteObjectText(file, view);
+
+            if (++state.objectsWritten % SAVE_PROGRESS_INTERVAL == 0 && progress) {
+                progress(state);
+            }
+        });
+    }
+
+    std::shared_future<bool> MakeReady(bool value) {
+        std::promise<bool> promise;
+        promise.set_value(value);
+        return promise.get_future().share();
+    }
+
+}
+
+fs::path GetJournalPath(const fs::path& levelPath) {
+    fs::path path = levelPath;
+    path += ".journal";
+    return path;
+}
+
+fs::path GetCompactingJournalPath(const fs::path& levelPath) {
+    fs::path path = levelPath;
+    path += ".journal.compacting";
+    return path;
+}
+
+uint64_t ReadLevelJournalId(const fs::path& levelPath) {
+    std::ifstream file(levelPath, std::ios::in);
+    std::string version;
+    std::string line;
+    uint64_t id = 0;
+    if (std::getline(file, version) && std::getline(file, line) && ParseId(line, "JOURNAL_ID=", id)) {
+        return id;
+    }
+    return 0;
+}
+
+uint64_t NewJournalId() {
+    static std::mt19937_64 generator(std::random_device{}() ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    static std::mutex mutex;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t id;
+    do {
+        id = generator();
+    } while (id == 0);
+    return id;
+}
+
+// Incremental saving for LevelData
+bool LevelData::SaveIncremental(const fs::path& path) {
+    // Until a background save has renamed its file, the snapshot on disk is not the one edits follow
+    WaitForBackgroundSave();
+
+    // Append only when the file on disk is the snapshot (or live journal) these edits follow
+    fs::path journalPath = GetJournalPath(path);
+    JournalHeader header;
+    bool haveJournal = ReadJournalHeader(journalPath, header);
+    uint64_t onDisk = haveJournal ? header.base : ReadLevelJournalId(path);
+    if (journalId_ == 0 || onDisk != journalId_) {
+        return SaveToFile(path);
+    }
+    if (edits_.empty()) {
+        return true;
+    }
+
+    if (!haveJournal) {
+        header.base = journalId_;
+        header.parent = 0;
+        if (!WriteJournalHeader(journalPath, header)) {
+            return false;
+        }
+    }
+
+    std::ofstream file(journalPath, std::ios::out | std::ios::app);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    // Values are read from the level now, so repeated edits of one field cost one line
+    const LevelObject* selected = nullptr;
+    for (const Edit& edit : edits_) {
+        const LevelObject* object = GetEditedObject(edit);
+        switch (edit.kind) {
+        case EditKind::Add:
+            if (object) {
+                object->Serialize(file);
+                selected = object;
+            }
+            break;
+        case EditKind::Remove:
+            file << "REMOVE=" << editText_[edit.key] << "\n";
+            selected = nullptr;
+            break;
+        case EditKind::Transform:
+            if (object) {
+                Select(file, object, selected);
+                WriteVector(file, "POSITION", object->GetPosition());
+                WriteVector(file, "ROTATION", object->GetRotation());
+                WriteVector(file, "SCALE", object->GetScale());
+            }
+            break;
+        case EditKind::Property:
+            if (object) {
+                Select(file, object, selected);
+                const PropertyValue* value = object->FindPropertyById(edit.key);
+                if (value) {
+                    file << "PROPERTY=" << strings_.Get(edit.key) << "," << FormatPropertyValue(*value, strings_) << "\n";
+                }
+                else {
+                    file << "REMOVE_PROPERTY=" << strings_.Get(edit.key) << "\n";
+                }
+            }
+            break;
+        case EditKind::Setting:
+            if (settings_.count(editText_[edit.key]) != 0) {
+                file << "SETTING=" << editText_[edit.key] << "," << GetSetting(editText_[edit.key]) << "\n";
+            }
+            else {
+                file << "REMOVE_SETTING=" << editText_[edit.key] << "\n";
+            }
+            break;
+        }
+    }
+    file << "COMMIT\n";
+
+    file.close();
+    if (file.fail()) {
+        return false;
+    }
+
+    ResetEdits();
+    return true;
+}
+
+bool LevelData::LoadJournal(const fs::path& path) {
+    // Levels written before journaling have no id and no journal
+    uint64_t snapshotId = ReadLevelJournalId(path);
+    uint64_t id = snapshotId;
+
+    JournalHeader header;
+    if (snapshotId != 0 && ReadJournalHeader(GetJournalPath(path), header)) {
+        bool applies = header.base == snapshotId;
+
+        // An unfinished compaction: the frozen journal leads from the snapshot to the live one
+        if (!applies && header.parent == snapshotId) {
+            applies = ReplayJournal(GetCompactingJournalPath(path), snapshotId);
+        }
+        if (applies && ReplayJournal(GetJournalPath(path), header.base)) {
+            id = header.base;
+        }
+    }
+
+    journalId_ = id;
+    ResetEdits();
+    return true;
+}
+
+bool LevelData::ReplayJournal(const fs::path& journalPath, uint64_t baseId) {
+    std::ifstream file(journalPath, std::ios::in);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+    file.close();
+
+    // Cut off a batch left incomplete by a crash; the header always precedes COMMIT
+    size_t commit = text.rfind("\nCOMMIT\n");
+    text.resize(commit != std::string::npos ? commit + 8 : 0);
+
+    std::istringstream in(text);
+    JournalHeader header;
+    if (!ReadJournalHeader(in, header) || header.base != baseId) {
+        return false;
+    }
+
+    LevelObject* target = nullptr;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line == "OBJECT") {
+            // An added object replaces any object of the same name
+            auto object = LevelObject::Deserialize(in);
+            RemoveObject(object->GetName());
+            target = GetObject(AddObject(std::move(object)));
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            continue;
+        }
+        std::string key = line.substr(0, equals);
+        std::string value = line.substr(equals + 1);
+        float v[3];
+
+        if (key == "REMOVE") {
+            RemoveObject(value);
+            target = nullptr;
+        }
+        else if (key == "SELECT") {
+            target = GetObject(value);
+        }
+        else if (key == "SETTING") {
+            size_t commaPos = value.find(',');
+            if (commaPos != std::string::npos) {
+                settings_[value.substr(0, commaPos)] = value.substr(commaPos + 1);
+            }
+        }
+        else if (key == "REMOVE_SETTING") {
+            settings_.erase(value);
+        }
+        else if (!target) {
+            continue;
+        }
+        else if (key == "POSITION" && ParseFloatList(value, v, 3) == 3) {
+            target->SetPosition(v[0], v[1], v[2]);
+        }
+        else if (key == "ROTATION" && ParseFloatList(value, v, 3) == 3) {
+            target->SetRotation(v[0], v[1], v[2]);
+        }
+        else if (key == "SCALE" && ParseFloatList(value, v, 3) == 3) {
+            target->SetScale(v[0], v[1], v[2]);
+        }
+        else if (key == "PROPERTY") {
+            size_t commaPos = value.find(',');
+            if (commaPos != std::string::npos) {
+                target->SetProperty(std::string_view(value).substr(0, commaPos), std::string_view(value).substr(commaPos + 1));
+            }
+        }
+        else if (key == "REMOVE_PROPERTY") {
+            target->RemoveProperty(value);
+        }
+    }
+    return true;
+}
+
+std::shared_future<bool> LevelData::CompactJournal(const fs::path& path) {
+    return CompactJournal(path, ThreadPool::GetShared());
+}
+
+std::shared_future<bool> LevelData::CompactJournal(const fs::path& path, ThreadPool& pool) {
+    if (compaction_.valid() && compaction_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return compaction_;
+    }
+
+    // Flush pending edits so snapshot and journal together hold the whole level
+    if (!SaveIncremental(path)) {
+        return MakeReady(false);
+    }
+
+    fs::path journalPath = GetJournalPath(path);
+    fs::path frozenPath = GetCompactingJournalPath(path);
+    if (!fs::exists(journalPath)) {
+        return MakeReady(true);
+    }
+    if (fs::exists(frozenPath)) {
+        // Left over from an interrupted compaction; memory already has its edits
+        return MakeReady(SaveToFile(path));
+    }
+
+    std::error_code error;
+    fs::rename(journalPath, frozenPath, error);
+    if (error) {
+        return MakeReady(false);
+    }
+
+    // Edits from here on go to a fresh journal for the snapshot being built
+    JournalHeader header;
+    header.base = NewJournalId();
+    header.parent = journalId_;
+    if (!WriteJournalHeader(journalPath, header)) {
+        fs::remove(journalPath, error);
+        fs::rename(frozenPath, journalPath, error);
+        return MakeReady(false);
+    }
+
+    uint64_t baseId = journalId_;
+    uint64_t nextId = header.base;
+    journalId_ = nextId;
+
+    auto done = std::make_shared<std::promise<bool>>();
+    compaction_ = done->get_future().share();
+    pool.Submit([path, frozenPath, baseId, nextId, done]() {
+        fs::path tempPath = path;
+        tempPath += ".tmp";
+
+        bool compacted = false;
+        try {
+            LevelData level;
+            compacted = ReadLevelJournalId(path) == baseId
+                && level.LoadText(path)
+                && level.ReplayJournal(frozenPath, baseId)
+                && level.WriteSnapshot(tempPath, nextId);
+
+            // A full save since the compaction started has already replaced the snapshot
+            std::error_code renameError;
+            if (compacted && ReadLevelJournalId(path) == baseId) {
+                fs::rename(tempPath, path, renameError);
+                compacted = !renameError;
+            }
+            else {
+                compacted = false;
+            }
+        }
+        catch (const std::exception&) {
+            compacted = false;
+        }
+
+        std::error_code cleanupError;
+        fs::remove(compacted ? frozenPath : tempPath, cleanupError);
+        done->set_value(compacted);
+    });
+    return compaction_;
+}
+
+std::shared_future<bool> LevelData::SaveToFileAsync(const fs::path& path, SaveProgressCallback progress) {
+    return SaveToFileAsync(path, ThreadPool::GetShared(), std::move(progress));
+}
+
+std::shared_future<bool> LevelData::SaveToFileAsync(const fs::path& path, ThreadPool& pool, SaveProgressCallback progress) {
+    WaitForBackgroundSave();
+
+    // The snapshot is immutable, so the worker needs nothing else from the
+    // level. Later edits are journaled against the new id; if the save fails
+    // the file keeps the old one and the next SaveIncremental saves in full.
+    LevelSnapshot snapshot = CopySnapshot();
+    uint64_t journalId = NewJournalId();
+    journalId_ = journalId;
+    ResetEdits();
+
+    std::shared_future<bool> compaction = compaction_;
+    auto done = std::make_shared<std::promise<bool>>();
+    backgroundSave_ = done->get_future().share();
+    pool.Submit([path, snapshot, journalId, compaction, progress, done]() {
+        // A running compaction renames its own snapshot over path when it ends
+        if (compaction.valid()) {
+            compaction.wait();
+        }
+
+        fs::path tempPath = path;
+        tempPath += ".saving";
+
+        SaveProgress state;
+        state.objectCount = snapshot.GetObjectCount();
+        bool saved = false;
+        try {
+            std::ofstream file(tempPath, std::ios::out);
+            if (file.is_open()) {
+                WriteSnapshotText(file, snapshot, journalId, state, progress);
+                file.close();
+                saved = !file.fail();
+            }
+
+            std::error_code error;
+            if (saved) {
+                fs::rename(tempPath, path, error);
+                saved = !error;
+            }
+            if (saved) {
+                fs::remove(GetJournalPath(path), error);
+                fs::remove(GetCompactingJournalPath(path), error);
+            }
+            else {
+                fs::remove(tempPath, error);
+            }
+        }
+        catch (const std::exception&) {
+            saved = false;
+        }
+
+        state.finished = true;
+        state.succeeded = saved;
+        if (progress) {
+            progress(state);
+        }
+        done->set_value(saved);
+    });
+    return backgroundSave_;
+}
+
+bool LevelData::IsSaving() const {
+    return backgroundSave_.valid() && backgroundSave_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+void LevelData::WaitForBackgroundSave() {
+    if (backgroundSave_.valid()) {
+        backgroundSave_.wait();
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "LevelEditor.h"
+#include <cstdint>
+
+// Edit journal for text levels
+//
+// A text level saved with SaveToFile is a full snapshot whose second line is
+// JOURNAL_ID=<id>. SaveIncremental appends the edits made since then to
+// "<level>.journal" as one batch per save:
+//
+//   LEVEL_JOURNAL_VERSION=1.0
+//   BASE=<id of the snapshot this journal applies to>
+//   PARENT=<id of the previous snapshot while a compaction runs, else 0>
+//   OBJECT ... END_OBJECT        (object added or replaced, as in the level)
+//   REMOVE=<name>
+//   SELECT=<name>                (target of the lines below)
+//   POSITION= / ROTATION= / SCALE= / PROPERTY=<key>,<value>
+//   REMOVE_PROPERTY=<key>
+//   SETTING=<key>,<value>
+//   REMOVE_SETTING=<key>
+//   COMMIT                       (end of batch)
+//
+// Lines after the last COMMIT belong to an interrupted save and are ignored.
+//
+// CompactJournal renames the journal to "<level>.journal.compacting", starts
+// a fresh journal whose PARENT is the current snapshot and rebuilds the
+// snapshot from the frozen journal in the background. If that is cut short,
+// loading replays the frozen journal before the live one.
+
+const char* const LEVEL_JOURNAL_VERSION = "1.0";
+
+fs::path GetJournalPath(const fs::path& levelPath);
+fs::path GetCompactingJournalPath(const fs::path& levelPath);
+
+// JOURNAL_ID of a text level, 0 for levels written before journaling
+uint64_t ReadLevelJournalId(const fs::path& levelPath);
+
+// Random non-zero id for a new snapshot
+uint64_t NewJournalId();
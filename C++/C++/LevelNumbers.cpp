@@ -0,0 +1,135 @@
+#include "LevelNumbers.h"
+#include <charconv>
+#include <cstdint>
+
+namespace {
+
+    // Every integer up to 2^24 and every power of ten up to 10^10 is exact in
+    // a float, so one division gives the correctly rounded result
+    const uint32_t MAX_EXACT_MANTISSA = 1u << 24;
+    const int MAX_EXACT_FRACTION_DIGITS = 10;
+
+    const float POWERS_OF_TEN[MAX_EXACT_FRACTION_DIGITS + 1] = {
+        1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+    };
+
+    inline bool IsDigit(char c) {
+        return static_cast<unsigned char>(c - '0') < 10;
+    }
+
+    inline bool IsSpace(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    // [-]digits[.digits] with a small enough mantissa; nullptr sends the
+    // caller to from_chars
+    const char* ParseExactDecimal(const char* first, const char* last, float& value) {
+        const char* p = first;
+        bool negative = p != last && *p == '-';
+        if (negative) {
+            ++p;
+        }
+        if (p == last || !IsDigit(*p)) {
+            return nullptr;
+        }
+
+        uint32_t mantissa = 0;
+        for (; p != last && IsDigit(*p); ++p) {
+            mantissa = mantissa * 10 + static_cast<uint32_t>(*p - '0');
+            if (mantissa > MAX_EXACT_MANTISSA) {
+                return nullptr;
+            }
+        }
+
+        int fractionDigits = 0;
+        if (p != last && *p == '.') {
+            ++p;
+            const char* fraction = p;
+            for (; p != last && IsDigit(*p); ++p) {
+                mantissa = mantissa * 10 + static_cast<uint32_t>(*p - '0');
+                if (mantissa > MAX_EXACT_MANTISSA || p - fraction >= MAX_EXACT_FRACTION_DIGITS) {
+                    return nullptr;
+                }
+            }
+            fractionDigits = static_cast<int>(p - fraction);
+            if (fractionDigits == 0) {
+                return nullptr;
+            }
+        }
+        if (p != last && (*p == 'e' || *p == 'E')) {
+            return nullptr;
+        }
+
+        float magnitude = static_cast<float>(mantissa) / POWERS_OF_TEN[fractionDigits];
+        value = negative ? -magnitude : magnitude;
+        return p;
+    }
+
+}
+
+char* FormatFloat(char* first, float value) {
+    return std::to_chars(first, first + FLOAT_TEXT_MAX, value).ptr;
+}
+
+void AppendFloat3(std::string& out, const Float3& value) {
+    char buffer[3 * FLOAT_TEXT_MAX + 2];
+    char* end = FormatFloat(buffer, value.x);
+    *end++ = ',';
+    end = FormatFloat(end, value.y);
+    *end++ = ',';
+    end = FormatFloat(end, value.z);
+    out.append(buffer, end);
+}
+
+void WriteFloat3(std::ostream& out, const Float3& value) {
+    char buffer[3 * FLOAT_TEXT_MAX + 2];
+    char* end = FormatFloat(buffer, value.x);
+    *end++ = ',';
+    end = FormatFloat(end, value.y);
+    *end++ = ',';
+    end = FormatFloat(end, value.z);
+    out.write(buffer, end - buffer);
+}
+
+const char* ParseFloat(const char* first, const char* last, float& value) {
+    if (const char* end = ParseExactDecimal(first, last, value)) {
+        return end;
+    }
+
+    std::from_chars_result result = std::from_chars(first, last, value);
+    return result.ec == std::errc() ? result.ptr : nullptr;
+}
+
+bool ParseFloat(std::string_view text, float& value) {
+    const char* last = text.data() + text.size();
+    return ParseFloat(text.data(), last, value) == last;
+}
+
+int ParseFloatList(std::string_view text, float* values, int count) {
+    const char* p = text.data();
+    const char* last = text.data() + text.size();
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) {
+            if (p == last || *p != ',') {
+                return i;
+            }
+            ++p;
+        }
+
+        // As with sscanf's %f, a number may follow whitespace and one '+'
+        while (p != last && IsSpace(*p)) {
+            ++p;
+        }
+        if (p != last && *p == '+') {
+            ++p;
+            if (p != last && (*p == '+' || *p == '-')) {
+                return i;
+            }
+        }
+        p = ParseFloat(p, last, values[i]);
+        if (!p) {
+            return i;
+        }
+    }
+    return count;
+}
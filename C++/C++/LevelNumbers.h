@@ -0,0 +1,31 @@
+#pragma once
+
+#include "TransformStore.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Float text for the level formats. Floats are written in the shortest form
+// that reads back to the same bits, and parsing never depends on the C
+// locale. Plain decimals ("-12.375", the common case in level files) are
+// converted directly; anything else goes through std::from_chars.
+
+// Room FormatFloat needs for any float
+const size_t FLOAT_TEXT_MAX = 24;
+
+// Writes value at first and returns the end of the text
+char* FormatFloat(char* first, float value);
+void AppendFloat3(std::string& out, const Float3& value);
+// "x,y,z"
+void WriteFloat3(std::ostream& out, const Float3& value);
+
+// Parses the float at the start of [first, last); returns the end of its
+// text, or nullptr when there is no number there. Leading whitespace and
+// '+' are not numbers, so " 1.5" and "+1.5" stay text as property values.
+const char* ParseFloat(const char* first, const char* last, float& value);
+// The whole of text must be one float
+bool ParseFloat(std::string_view text, float& value);
+// Reads up to count comma-separated floats into values and returns how many
+// were read. Like sscanf's "%f,%f,%f": each number may have leading
+// whitespace and a '+', and reading stops at the first one that does not parse.
+int ParseFloatList(std::string_view text, float* values, int count);
@@ -0,0 +1,235 @@
+#include "LevelProperties.h"
+#include "LevelNumbers.h"
+#include <algorithm>
+#include <charconv>
+#include <map>
+#include <sstream>
+
+namespace {
+
+    // std::string keeps up to 15 characters inline on MSVC and libstdc++
+    const size_t STRING_INLINE_CAPACITY = 15;
+
+    // Tree node: left/parent/right links, colour and nil flags padded to a pointer, then the pair
+    const size_t MAP_NODE_BYTES = 3 * sizeof(void*) + sizeof(void*) + sizeof(std::pair<const std::string, std::string>);
+
+    size_t StringHeapBytes(size_t length) {
+        return length > STRING_INLINE_CAPACITY ? length + 1 : 0;
+    }
+
+    bool FormatFloat(char* first, char* last, float value, uint8_t precision, char*& end) {
+        std::to_chars_result result = precision == PropertyValue::SHORTEST
+            ? std::to_chars(first, last, value)
+            : std::to_chars(first, last, value, std::chars_format::fixed, precision);
+        end = result.ptr;
+        return result.ec == std::errc();
+    }
+
+    void AppendFloat(std::string& out, float value, uint8_t precision) {
+        char buffer[64];
+        char* end = buffer;
+        if (FormatFloat(buffer, buffer + sizeof(buffer), value, precision, end)) {
+            out.append(buffer, end);
+        }
+    }
+
+    // True when value written with precision gives back exactly text
+    bool FormatsAs(float value, uint8_t precision, std::string_view text) {
+        char buffer[64];
+        char* end = buffer;
+        return FormatFloat(buffer, buffer + sizeof(buffer), value, precision, end)
+            && std::string_view(buffer, end - buffer) == text;
+    }
+
+    // Parses a float and works out which precision reproduces the text.
+    // Tries the shortest form first, then fixed notation with the number of
+    // fraction digits the text has ("1.0", "2.50").
+    bool ParseExactFloat(std::string_view text, float& value, uint8_t& precision) {
+        if (!ParseFloat(text, value)) {
+            return false;
+        }
+
+        if (FormatsAs(value, PropertyValue::SHORTEST, text)) {
+            precision = PropertyValue::SHORTEST;
+            return true;
+        }
+
+        size_t dot = text.find('.');
+        if (dot == std::string_view::npos || text.find_first_of("eE") != std::string_view::npos) {
+            return false;
+        }
+        size_t digits = text.size() - dot - 1;
+        if (digits == 0 || digits > 9) {
+            return false;
+        }
+        precision = static_cast<uint8_t>(digits);
+        return FormatsAs(value, precision, text);
+    }
+
+    bool ParseExactInt(std::string_view text, int32_t& value) {
+        const char* end = text.data() + text.size();
+        std::from_chars_result result = std::from_chars(text.data(), end, value);
+        if (result.ec != std::errc() || result.ptr != end) {
+            return false;
+        }
+
+        // Rejects forms such as "007" that would not format back the same
+        char buffer[16];
+        std::to_chars_result written = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        return std::string_view(buffer, written.ptr - buffer) == text;
+    }
+
+    // "x,y,z" where every component reproduces with the first one's precision
+    bool ParseExactVec3(std::string_view text, Float3& value, uint8_t& precision) {
+        size_t first = text.find(',');
+        if (first == std::string_view::npos) {
+            return false;
+        }
+        size_t second = text.find(',', first + 1);
+        if (second == std::string_view::npos || text.find(',', second + 1) != std::string_view::npos) {
+            return false;
+        }
+
+        std::string_view parts[3] = {
+            text.substr(0, first),
+            text.substr(first + 1, second - first - 1),
+            text.substr(second + 1)
+        };
+        float components[3];
+        if (!ParseExactFloat(parts[0], components[0], precision)) {
+            return false;
+        }
+        for (int i = 1; i < 3; ++i) {
+            uint8_t componentPrecision;
+            if (!ParseExactFloat(parts[i], components[i], componentPrecision)) {
+                return false;
+            }
+            if (componentPrecision != precision && !FormatsAs(components[i], precision, parts[i])) {
+                return false;
+            }
+        }
+
+        value = { components[0], components[1], components[2] };
+        return true;
+    }
+
+}
+
+PropertyValue PropertyValue::MakeFloat(float value, uint8_t precision) {
+    PropertyValue result;
+    result.type = PropertyType::Float;
+    result.precision = precision;
+    result.v = { value, 0.0f, 0.0f };
+    return result;
+}
+
+PropertyValue PropertyValue::MakeInt(int32_t value) {
+    PropertyValue result;
+    result.type = PropertyType::Int;
+    result.precision = SHORTEST;
+    result.v = { 0.0f, 0.0f, 0.0f };
+    result.i = value;
+    return result;
+}
+
+PropertyValue PropertyValue::MakeVec3(const Float3& value, uint8_t precision) {
+    PropertyValue result;
+    result.type = PropertyType::Vec3;
+    result.precision = precision;
+    result.v = value;
+    return result;
+}
+
+PropertyValue PropertyValue::MakeString(uint32_t id) {
+    PropertyValue result;
+    result.type = PropertyType::String;
+    result.precision = SHORTEST;
+    result.v = { 0.0f, 0.0f, 0.0f };
+    result.s = id;
+    return result;
+}
+
+PropertyValue ParsePropertyValue(std::string_view text, StringPool& strings) {
+    int32_t intValue;
+    if (ParseExactInt(text, intValue)) {
+        return PropertyValue::MakeInt(intValue);
+    }
+
+    float floatValue;
+    uint8_t precision;
+    if (ParseExactFloat(text, floatValue, precision)) {
+        return PropertyValue::MakeFloat(floatValue, precision);
+    }
+
+    Float3 vectorValue;
+    if (ParseExactVec3(text, vectorValue, precision)) {
+        return PropertyValue::MakeVec3(vectorValue, precision);
+    }
+
+    return PropertyValue::MakeString(strings.Intern(text));
+}
+
+std::string FormatPropertyValue(const PropertyValue& value, const StringPool& strings) {
+    std::string text;
+    switch (value.type) {
+    case PropertyType::Float:
+        AppendFloat(text, value.f, value.precision);
+        break;
+    case PropertyType::Int:
+        text = std::to_string(value.i);
+        break;
+    case PropertyType::Vec3:
+        AppendFloat(text, value.v.x, value.precision);
+        text += ',';
+        AppendFloat(text, value.v.y, value.precision);
+        text += ',';
+        AppendFloat(text, value.v.z, value.precision);
+        break;
+    case PropertyType::String:
+        text = strings.Get(value.s);
+        break;
+    }
+    return text;
+}
+
+void GetKeyTextOrder(const PropertyList& properties, const StringPool& strings, PropertyOrder& order) {
+    order.clear();
+    for (uint32_t i = 0; i < properties.size(); ++i) {
+        order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return strings.Get(properties[a].key) < strings.Get(properties[b].key);
+    });
+}
+
+size_t EstimatePropertyMapBytes(const PropertyList& properties, const StringPool& strings) {
+    // The map object itself plus the sentinel node MSVC allocates for every map
+    size_t bytes = sizeof(std::map<std::string, std::string>) + MAP_NODE_BYTES;
+    for (const PropertyEntry& entry : properties) {
+        bytes += MAP_NODE_BYTES;
+        bytes += StringHeapBytes(strings.Get(entry.key).size());
+        bytes += StringHeapBytes(FormatPropertyValue(entry.value, strings).size());
+    }
+    return bytes;
+}
+
+std::string PropertyMemoryReport::Format() const {
+    static const char* typeNames[4] = { "float", "int", "vec3", "string" };
+
+    std::ostringstream out;
+    out << "Objects:           " << objectCount << "\n";
+    out << "Properties:        " << propertyCount << " (";
+    for (int i = 0; i < 4; ++i) {
+        out << (i > 0 ? ", " : "") << typeCounts[i] << " " << typeNames[i];
+    }
+    out << ")\n";
+    out << "Interned strings:  " << internedStrings << "\n";
+    out << "Property lists:    " << listBytes << " bytes\n";
+    out << "String pool:       " << poolBytes << " bytes\n";
+    out << "Typed total:       " << GetTypedBytes() << " bytes\n";
+    out << "std::map estimate: " << mapBytes << " bytes\n";
+    if (GetTypedBytes() > 0) {
+        out << "Ratio:             " << static_cast<double>(mapBytes) / GetTypedBytes() << "x\n";
+    }
+    return out.str();
+}
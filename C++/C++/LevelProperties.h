@@ -0,0 +1,76 @@
+#pragma once
+
+#include "SmallVector.h"
+#include "StringPool.h"
+#include "TransformStore.h"
+#include <string>
+#include <string_view>
+
+// Typed object properties. Keys and string values are ids into the level's
+// StringPool; numbers are stored as numbers and formatted back to exactly the
+// text they were parsed from.
+
+enum class PropertyType : uint8_t {
+    Float,
+    Int,
+    Vec3,
+    String
+};
+
+struct PropertyValue {
+    // precision value for floats written in shortest round-trip form
+    static const uint8_t SHORTEST = 0xFF;
+
+    PropertyType type;
+    uint8_t precision;  // fraction digits of Float/Vec3 text, or SHORTEST
+    union {
+        float f;
+        int32_t i;
+        Float3 v;
+        uint32_t s;  // StringPool id
+    };
+
+    static PropertyValue MakeFloat(float value, uint8_t precision = SHORTEST);
+    static PropertyValue MakeInt(int32_t value);
+    static PropertyValue MakeVec3(const Float3& value, uint8_t precision = SHORTEST);
+    static PropertyValue MakeString(uint32_t id);
+};
+
+static_assert(sizeof(PropertyValue) == 16, "PropertyValue should stay 16 bytes");
+
+struct PropertyEntry {
+    uint32_t key;  // StringPool id
+    PropertyValue value;
+};
+
+// Entries sorted by key id; two fit without a heap allocation
+typedef SmallVector<PropertyEntry, 2> PropertyList;
+
+// Positions of entries in key text order. Key ids depend on the order a
+// level happened to intern its keys, so writers go through this instead.
+typedef SmallVector<uint32_t, 8> PropertyOrder;
+void GetKeyTextOrder(const PropertyList& properties, const StringPool& strings, PropertyOrder& order);
+
+// Picks the narrowest type whose text form reproduces text exactly:
+// "3" is Int, "1.5" and "2.50" are Float, "1,2,3" is Vec3, anything else is
+// interned as a String.
+PropertyValue ParsePropertyValue(std::string_view text, StringPool& strings);
+std::string FormatPropertyValue(const PropertyValue& value, const StringPool& strings);
+
+// Property memory of a level compared with one std::map<std::string, std::string>
+// per object. Payload bytes only; allocator headers and padding are ignored.
+struct PropertyMemoryReport {
+    size_t objectCount = 0;
+    size_t propertyCount = 0;
+    size_t typeCounts[4] = {};
+    size_t internedStrings = 0;
+    size_t listBytes = 0;  // PropertyList members plus spilled entries
+    size_t poolBytes = 0;  // the level's StringPool
+    size_t mapBytes = 0;   // estimate for the std::map layout
+
+    size_t GetTypedBytes() const { return listBytes + poolBytes; }
+    std::string Format() const;
+};
+
+// Bytes a std::map<std::string, std::string> holding these properties would use
+size_t EstimatePropertyMapBytes(const PropertyList& properties, const StringPool& strings);
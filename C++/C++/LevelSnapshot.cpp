@@ -0,0 +1,474 @@
+#include "LevelSnapshot.h"
+#include "LevelEditor.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+    // std::string keeps up to 15 characters inline on MSVC and libstdc++
+    const size_t STRING_INLINE_CAPACITY = 15;
+
+    // Red-black tree node: three links and a colour word, then the key/value pair
+    const size_t SETTING_NODE_BYTES = 4 * sizeof(void*) + sizeof(std::pair<const std::string, std::string>);
+
+    typedef std::map<std::string, std::string> SettingsMap;
+
+    struct SlotChange {
+        uint32_t slot;
+        const SnapshotObject* from;
+        const SnapshotObject* to;
+    };
+
+    struct BuildStats {
+        size_t added = 0;
+        size_t released = 0;
+    };
+
+    size_t StringBytes(const std::string& text) {
+        return text.capacity() > STRING_INLINE_CAPACITY ? text.capacity() + 1 : 0;
+    }
+
+    size_t ObjectBytes(const SnapshotObject& object) {
+        size_t bytes = sizeof(SnapshotObject) + StringBytes(object.name) + object.properties.capacity() * sizeof(SnapshotProperty);
+        for (const SnapshotProperty& property : object.properties) {
+            bytes += StringBytes(property.key) + StringBytes(property.text);
+        }
+        return bytes;
+    }
+
+    size_t SettingsBytes(const SettingsMap& settings) {
+        size_t bytes = sizeof(SettingsMap);
+        for (const auto& [key, value] : settings) {
+            bytes += SETTING_NODE_BYTES + StringBytes(key) + StringBytes(value);
+        }
+        return bytes;
+    }
+
+    uint32_t Digit(uint32_t slot, uint32_t height) {
+        return (slot >> (height * SNAPSHOT_NODE_BITS)) & (SNAPSHOT_NODE_SIZE - 1);
+    }
+
+    // Number of slots a trie of this height can address
+    uint64_t Capacity(uint32_t height) {
+        return static_cast<uint64_t>(1) << ((height + 1) * SNAPSHOT_NODE_BITS);
+    }
+
+    const SnapshotNode* AsNode(const std::shared_ptr<const void>& entry) {
+        return static_cast<const SnapshotNode*>(entry.get());
+    }
+
+    // Copies node and sets the sorted slots [first, last) to source(slot).
+    // Every node on the way is copied once, whatever the number of slots below it.
+    template <typename Source>
+    std::shared_ptr<const SnapshotNode> Update(const SnapshotNode* node, uint32_t height, const uint32_t* first, const uint32_t* last, Source& source, BuildStats& stats) {
+        auto copy = node ? std::make_shared<SnapshotNode>(*node) : std::make_shared<SnapshotNode>();
+        stats.added += sizeof(SnapshotNode);
+        if (node) {
+            stats.released += sizeof(SnapshotNode);
+        }
+
+        while (first != last) {
+            uint32_t digit = Digit(*first, height);
+            const uint32_t* groupEnd = first;
+            while (groupEnd != last && Digit(*groupEnd, height) == digit) {
+                ++groupEnd;
+            }
+
+            std::shared_ptr<const void>& entry = copy->entries[digit];
+            if (height == 0) {
+                if (entry) {
+                    stats.released += ObjectBytes(*static_cast<const SnapshotObject*>(entry.get()));
+                }
+                std::shared_ptr<const SnapshotObject> state = source(*first);
+                if (state) {
+                    stats.added += ObjectBytes(*state);
+                }
+                entry = std::move(state);
+            }
+            else {
+                entry = Update(AsNode(entry), height - 1, first, groupEnd, source, stats);
+            }
+            first = groupEnd;
+        }
+        return copy;
+    }
+
+    // Wraps root in parents until it has the given height
+    std::shared_ptr<const SnapshotNode> Lift(std::shared_ptr<const SnapshotNode> root, uint32_t height, uint32_t targetHeight) {
+        for (; height < targetHeight && root; ++height) {
+            auto parent = std::make_shared<SnapshotNode>();
+            parent->entries[0] = root;
+            root = parent;
+        }
+        return root;
+    }
+
+    // Collects the slots whose states differ, skipping shared subtrees
+    void Diff(const SnapshotNode* a, const SnapshotNode* b, uint32_t height, uint32_t base, std::vector<SlotChange>& changes) {
+        if (a == b) {
+            return;
+        }
+        for (uint32_t i = 0; i < SNAPSHOT_NODE_SIZE; ++i) {
+            const void* from = a ? a->entries[i].get() : nullptr;
+            const void* to = b ? b->entries[i].get() : nullptr;
+            if (from == to) {
+                continue;
+            }
+
+            uint32_t slot = base + (i << (height * SNAPSHOT_NODE_BITS));
+            if (height == 0) {
+                changes.push_back({ slot, static_cast<const SnapshotObject*>(from), static_cast<const SnapshotObject*>(to) });
+            }
+            else {
+                Diff(static_cast<const SnapshotNode*>(from), static_cast<const SnapshotNode*>(to), height - 1, slot, changes);
+            }
+        }
+    }
+
+    void VisitObjects(const SnapshotNode* node, uint32_t height, const std::function<void(const SnapshotObject&)>& visit) {
+        for (const std::shared_ptr<const void>& entry : node->entries) {
+            if (!entry) {
+                continue;
+            }
+            if (height == 0) {
+                visit(*static_cast<const SnapshotObject*>(entry.get()));
+            }
+            else {
+                VisitObjects(AsNode(entry), height - 1, visit);
+            }
+        }
+    }
+
+    bool SameValue(const PropertyValue& a, const PropertyValue& b) {
+        if (a.type != b.type || a.precision != b.precision) {
+            return false;
+        }
+        switch (a.type) {
+        case PropertyType::Float:
+            return a.f == b.f;
+        case PropertyType::Int:
+            return a.i == b.i;
+        case PropertyType::Vec3:
+            return a.v.x == b.v.x && a.v.y == b.v.y && a.v.z == b.v.z;
+        case PropertyType::String:
+            return a.s == b.s;
+        }
+        return false;
+    }
+
+}
+
+// Implementation of LevelSnapshot
+LevelSnapshot::LevelSnapshot() : height_(0), objectCount_(0), totalBytes_(0), addedBytes_(0) {
+}
+
+const SnapshotObject* LevelSnapshot::GetObject(uint32_t slot) const {
+    if (Capacity(height_) <= slot) {
+        return nullptr;
+    }
+
+    const SnapshotNode* node = root_.get();
+    for (uint32_t height = height_; node && height > 0; --height) {
+        node = AsNode(node->entries[Digit(slot, height)]);
+    }
+    return node ? static_cast<const SnapshotObject*>(node->entries[Digit(slot, 0)].get()) : nullptr;
+}
+
+void LevelSnapshot::ForEachObject(const std::function<void(const SnapshotObject&)>& visit) const {
+    if (root_) {
+        VisitObjects(root_.get(), height_, visit);
+    }
+}
+
+// Snapshots for LevelData
+LevelSnapshot LevelData::TakeSnapshot() {
+    if (!HasChangesSinceSnapshot() && !copyOwnsBase_) {
+        return lastSnapshot_;
+    }
+
+    LevelSnapshot snapshot = HasChangesSinceSnapshot() ? BuildSnapshot() : lastSnapshot_;
+    // A base left by CopySnapshot is in no undo history, so the history
+    // shares none of this snapshot yet
+    if (copyOwnsBase_) {
+        snapshot.addedBytes_ = snapshot.totalBytes_;
+        copyOwnsBase_ = false;
+    }
+    ClearSnapshotChanges();
+    trackChanges_ = true;
+    lastSnapshot_ = snapshot;
+    return snapshot;
+}
+
+LevelSnapshot LevelData::CopySnapshot() {
+    if (!HasChangesSinceSnapshot()) {
+        return lastSnapshot_;
+    }
+
+    LevelSnapshot snapshot = BuildSnapshot();
+    if (!trackChanges_ || copyOwnsBase_) {
+        ClearSnapshotChanges();
+        trackChanges_ = true;
+        copyOwnsBase_ = true;
+        lastSnapshot_ = snapshot;
+    }
+    return snapshot;
+}
+
+LevelSnapshot LevelData::BuildSnapshot() const {
+    // Without tracking there is no valid base, so every live slot is written
+    LevelSnapshot base = trackChanges_ ? lastSnapshot_ : LevelSnapshot();
+    std::vector<uint32_t> changed = trackChanges_ ? changedSlots_ : denseSlots_;
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+    LevelSnapshot snapshot;
+    BuildStats stats;
+    std::shared_ptr<const SnapshotNode> root = base.root_;
+    uint32_t height = base.height_;
+
+    // Grow until the highest slot fits; the old root becomes the first child
+    while (!changed.empty() && Capacity(height) <= changed.back()) {
+        if (root) {
+            auto parent = std::make_shared<SnapshotNode>();
+            parent->entries[0] = root;
+            root = parent;
+            stats.added += sizeof(SnapshotNode);
+        }
+        ++height;
+    }
+
+    auto source = [this](uint32_t slotIndex) -> std::shared_ptr<const SnapshotObject> {
+        const LevelObject* object = GetSlotObject(slotIndex);
+        if (!object) {
+            return nullptr;
+        }
+
+        auto state = std::make_shared<SnapshotObject>();
+        state->name = std::string(object->GetName());
+        state->type = object->GetType();
+        state->transform.position = object->GetPosition();
+        state->transform.rotation = object->GetRotation();
+        state->transform.scale = object->GetScale();
+        state->properties.reserve(object->GetPropertyCount());
+        PropertyOrder order;
+        object->GetPropertyOrder(order);
+        for (uint32_t index : order) {
+            const PropertyEntry& entry = object->GetProperties()[index];
+            SnapshotProperty property;
+            property.key = strings_.Get(entry.key);
+            property.value = entry.value;
+            if (entry.value.type == PropertyType::String) {
+                property.text = strings_.Get(entry.value.s);
+            }
+            state->properties.push_back(std::move(property));
+        }
+        return state;
+    };
+
+    if (!changed.empty()) {
+        root = Update(root.get(), height, changed.data(), changed.data() + changed.size(), source, stats);
+    }
+
+    if (settingsChanged_ || !base.settings_) {
+        auto settings = std::make_shared<const SettingsMap>(settings_);
+        stats.added += SettingsBytes(*settings);
+        if (base.settings_) {
+            stats.released += SettingsBytes(*base.settings_);
+        }
+        snapshot.settings_ = settings;
+    }
+    else {
+        snapshot.settings_ = base.settings_;
+    }
+
+    snapshot.root_ = root;
+    snapshot.height_ = height;
+    snapshot.objectCount_ = objects_.size();
+    snapshot.addedBytes_ = stats.added;
+    snapshot.totalBytes_ = base.totalBytes_ + stats.added - stats.released;
+    return snapshot;
+}
+
+void LevelData::RestoreSnapshot(const LevelSnapshot& snapshot) {
+    if (!snapshot.IsValid()) {
+        return;
+    }
+
+    // Brings lastSnapshot_ up to date, so it describes the level exactly
+    LevelSnapshot current = TakeSnapshot();
+
+    uint32_t height = std::max(current.height_, snapshot.height_);
+    std::shared_ptr<const SnapshotNode> from = Lift(current.root_, current.height_, height);
+    std::shared_ptr<const SnapshotNode> to = Lift(snapshot.root_, snapshot.height_, height);
+    std::vector<SlotChange> changes;
+    Diff(from.get(), to.get(), height, 0, changes);
+
+    // Remove first, so names freed here can be taken by objects re-created below
+    for (const SlotChange& change : changes) {
+        if (change.from && (!change.to || change.from->name != change.to->name || change.from->type != change.to->type)) {
+            RemoveAt(change.slot);
+        }
+    }
+
+    for (const SlotChange& change : changes) {
+        if (!change.to) {
+            continue;
+        }
+        if (change.from && change.from->name == change.to->name && change.from->type == change.to->type) {
+            ApplySnapshotObject(objects_[slots_[change.slot].denseIndex], *change.to);
+        }
+        else if (!Contains(change.to->name)) {
+            ClaimSlot(change.slot);
+            ObjectHandle handle = InsertAt(change.slot, NewObject(change.to->name, change.to->type), change.to->transform);
+            ApplySnapshotObject(GetObject(handle), *change.to);
+        }
+    }
+
+    if (current.settings_ != snapshot.settings_) {
+        const SettingsMap& target = snapshot.GetSettings();
+        for (auto it = settings_.begin(); it != settings_.end();) {
+            if (target.count(it->first) == 0) {
+                std::string key = it->first;
+                it = settings_.erase(it);
+                RecordSettingEdit(key);
+            }
+            else {
+                ++it;
+            }
+        }
+        for (const auto& [key, value] : target) {
+            auto it = settings_.find(key);
+            if (it == settings_.end() || it->second != value) {
+                SetSetting(key, value);
+            }
+        }
+    }
+
+    // The level now matches snapshot exactly
+    ClearSnapshotChanges();
+    lastSnapshot_ = snapshot;
+}
+
+void LevelData::ClearSnapshotChanges() {
+    for (uint32_t slotIndex : changedSlots_) {
+        if (LevelObject* object = GetSlotObject(slotIndex)) {
+            object->snapshotDirty_ = false;
+        }
+    }
+    changedSlots_.clear();
+    settingsChanged_ = false;
+}
+
+void LevelData::ApplySnapshotObject(LevelObject* object, const SnapshotObject& state) {
+    const Transform& transform = state.transform;
+    object->SetPosition(transform.position.x, transform.position.y, transform.position.z);
+    object->SetRotation(transform.rotation.x, transform.rotation.y, transform.rotation.z);
+    object->SetScale(transform.scale.x, transform.scale.y, transform.scale.z);
+
+    // Drop keys the state does not have, walking backwards so erasing is safe
+    for (uint32_t i = object->properties_.size(); i > 0; --i) {
+        std::string_view key = strings_.Get(object->properties_[i - 1].key);
+        bool kept = std::any_of(state.properties.begin(), state.properties.end(), [key](const SnapshotProperty& property) {
+            return property.key == key;
+        });
+        if (!kept) {
+            object->RemoveProperty(key);
+        }
+    }
+
+    for (const SnapshotProperty& property : state.properties) {
+        PropertyValue value = property.value;
+        if (value.type == PropertyType::String) {
+            value.s = strings_.Intern(property.text);
+        }
+        const PropertyValue* existing = object->FindProperty(property.key);
+        if (!existing || !SameValue(*existing, value)) {
+            object->StoreProperty(property.key, value);
+        }
+    }
+}
+
+// Implementation of UndoHistory
+UndoHistory::UndoHistory(LevelData& level, size_t memoryBudget)
+    : level_(level), current_(0), memoryBudget_(memoryBudget), generation_(level.GetEditGeneration()) {
+    states_.push_back({ level_.TakeSnapshot(), "Initial state" });
+}
+
+bool UndoHistory::HasUncommittedEdits() const {
+    return level_.GetEditGeneration() != generation_;
+}
+
+void UndoHistory::Commit(const std::string& label) {
+    if (!HasUncommittedEdits()) {
+        return;
+    }
+
+    states_.erase(states_.begin() + static_cast<std::ptrdiff_t>(current_ + 1), states_.end());
+    states_.push_back({ level_.TakeSnapshot(), label });
+    current_ = states_.size() - 1;
+    generation_ = level_.GetEditGeneration();
+    EnforceBudget();
+}
+
+bool UndoHistory::Undo() {
+    if (HasUncommittedEdits()) {
+        Commit("Uncommitted edits");
+    }
+    if (!CanUndo()) {
+        return false;
+    }
+
+    --current_;
+    level_.RestoreSnapshot(states_[current_].snapshot);
+    generation_ = level_.GetEditGeneration();
+    return true;
+}
+
+bool UndoHistory::Redo() {
+    // Editing after an undo starts a new branch, which drops the redo states
+    if (HasUncommittedEdits()) {
+        Commit("Uncommitted edits");
+    }
+    if (!CanRedo()) {
+        return false;
+    }
+
+    ++current_;
+    level_.RestoreSnapshot(states_[current_].snapshot);
+    generation_ = level_.GetEditGeneration();
+    return true;
+}
+
+void UndoHistory::SetMemoryBudget(size_t bytes) {
+    memoryBudget_ = bytes;
+    EnforceBudget();
+}
+
+size_t UndoHistory::GetMemoryUsage() const {
+    size_t bytes = states_.front().snapshot.GetTotalBytes();
+    for (size_t i = 1; i < states_.size(); ++i) {
+        bytes += states_[i].snapshot.GetAddedBytes();
+    }
+    return bytes;
+}
+
+void UndoHistory::EnforceBudget() {
+    // The current state always stays, even if it alone is over budget
+    while (current_ > 0 && GetMemoryUsage() > memoryBudget_) {
+        states_.pop_front();
+        --current_;
+    }
+}
+
+std::string UndoHistory::FormatMemoryReport() const {
+    std::ostringstream out;
+    out << "Undo states:  " << states_.size() << " (" << GetMemoryUsage() << " of " << memoryBudget_ << " bytes)\n";
+    for (size_t i = 0; i < states_.size(); ++i) {
+        const LevelSnapshot& snapshot = states_[i].snapshot;
+        out << (i == current_ ? "> " : "  ") << i << " " << states_[i].label
+            << ": " << snapshot.GetObjectCount() << " objects, "
+            << (i == 0 ? snapshot.GetTotalBytes() : snapshot.GetAddedBytes()) << " bytes"
+            << (i == 0 ? " (base)" : "") << "\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "LevelProperties.h"
+#include "TransformStore.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Copy-on-write level snapshots
+//
+// A snapshot is an immutable 32-way trie indexed by object slot (the index
+// part of an ObjectHandle). Each leaf entry is the state of one object. A new
+// snapshot copies only the trie paths of the slots changed since the previous
+// one and shares everything else, so it costs O(changed objects). Restoring
+// compares two tries and skips subtrees they share.
+
+class LevelData;
+enum class ObjectType;
+
+struct SnapshotProperty {
+    std::string key;
+    PropertyValue value;
+    std::string text;  // value of String properties; the level's pool ids are not kept
+};
+
+struct SnapshotObject {
+    std::string name;
+    ObjectType type;
+    Transform transform;
+    std::vector<SnapshotProperty> properties;  // in key text order
+};
+
+const uint32_t SNAPSHOT_NODE_BITS = 5;
+const uint32_t SNAPSHOT_NODE_SIZE = 1 << SNAPSHOT_NODE_BITS;
+
+// Trie node: inner nodes hold child nodes, leaves (height 0) hold SnapshotObjects
+struct SnapshotNode {
+    std::shared_ptr<const void> entries[SNAPSHOT_NODE_SIZE];
+};
+
+class LevelSnapshot {
+public:
+    LevelSnapshot();
+
+    bool IsValid() const { return settings_ != nullptr; }
+    size_t GetObjectCount() const { return objectCount_; }
+    const SnapshotObject* GetObject(uint32_t slot) const;
+    // Visits every object in slot order
+    void ForEachObject(const std::function<void(const SnapshotObject&)>& visit) const;
+    const std::map<std::string, std::string>& GetSettings() const { return *settings_; }
+
+    // Bytes reachable from this snapshot, and bytes it allocated that the
+    // snapshot it was built from does not share
+    size_t GetTotalBytes() const { return totalBytes_; }
+    size_t GetAddedBytes() const { return addedBytes_; }
+
+private:
+    friend class LevelData;
+
+    std::shared_ptr<const SnapshotNode> root_;
+    uint32_t height_;
+    size_t objectCount_;
+    std::shared_ptr<const std::map<std::string, std::string>> settings_;
+    size_t totalBytes_;
+    size_t addedBytes_;
+};
+
+// Undo/redo over level snapshots. Call Commit after every edit; states past
+// the memory budget are dropped oldest first.
+class UndoHistory {
+public:
+    explicit UndoHistory(LevelData& level, size_t memoryBudget = 64 * 1024 * 1024);
+
+    // Records the level as it is now and drops any redo states
+    void Commit(const std::string& label);
+    // Uncommitted edits are committed before moving
+    bool Undo();
+    bool Redo();
+
+    bool CanUndo() const { return current_ > 0; }
+    bool CanRedo() const { return current_ + 1 < states_.size(); }
+    const std::string& GetUndoLabel() const { return states_[current_].label; }
+    const std::string& GetRedoLabel() const { return states_[current_ + 1].label; }
+
+    void SetMemoryBudget(size_t bytes);
+    // The oldest state counts in full, later ones only with what they added
+    size_t GetMemoryUsage() const;
+    size_t GetStateCount() const { return states_.size(); }
+    std::string FormatMemoryReport() const;
+
+private:
+    struct State {
+        LevelSnapshot snapshot;
+        std::string label;
+    };
+
+    bool HasUncommittedEdits() const;
+    void EnforceBudget();
+
+    LevelData& level_;
+    std::deque<State> states_;
+    size_t current_;
+    size_t memoryBudget_;
+    uint64_t generation_;  // level edit generation states_[current_] was taken or restored at
+};
@@ -0,0 +1,424 @@
+#include "LevelStreaming.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+
+namespace {
+
+    // Loads allowed in flight at once, so a focus jump does not queue work
+    // for cells that will be unwanted by the time it runs
+    const size_t MAX_PENDING_LOADS = 8;
+
+    // Per-object bookkeeping in LevelData: entries in objects_, denseSlots_,
+    // slots_ and a type bucket, a name index node and two spatial index nodes
+    const size_t LEVEL_OBJECT_OVERHEAD = 4 * sizeof(void*) + 64 + 2 * 64;
+
+    // String values interned in the level pool are not counted
+    size_t EstimateObjectBytes(const LevelObject& object) {
+        return sizeof(LevelObject) + object.GetName().size() + object.GetProperties().GetHeapBytes() +
+            TransformStore::ComponentCount * sizeof(float) + LEVEL_OBJECT_OVERHEAD;
+    }
+
+    float DistanceToCell(const StreamedCellEntry& entry, const Float3& point) {
+        const float p[3] = { point.x, point.y, point.z };
+        float squared = 0.0f;
+        for (int axis = 0; axis < 3; ++axis) {
+            float outside = std::max(std::max(entry.minBounds[axis] - p[axis], 0.0f), p[axis] - entry.maxBounds[axis]);
+            squared += outside * outside;
+        }
+        return std::sqrt(squared);
+    }
+
+}
+
+bool PartitionLevel(const LevelData& level, float cellSize, const fs::path& path) {
+    if (!(cellSize > 0.0f)) {
+        return false;
+    }
+
+    // Group objects by cell; the map keeps the directory in a stable order
+    const auto& objects = level.GetObjects();
+    std::map<std::array<int32_t, 3>, std::vector<uint32_t>> cellObjects;
+    for (uint32_t row = 0; row < objects.size(); ++row) {
+        Float3 position = objects[row]->GetPosition();
+        std::array<int32_t, 3> coord = {
+            static_cast<int32_t>(std::floor(position.x / cellSize)),
+            static_cast<int32_t>(std::floor(position.y / cellSize)),
+            static_cast<int32_t>(std::floor(position.z / cellSize))
+        };
+        cellObjects[coord].push_back(row);
+    }
+
+    std::vector<Float3> minBounds(objects.size());
+    std::vector<Float3> maxBounds(objects.size());
+    level.GetTransforms().ComputeObjectBounds(minBounds.data(), maxBounds.data());
+
+    std::ostringstream settings;
+    for (const auto& [key, value] : level.GetSettings()) {
+        settings << "SETTING=" << key << "," << value << "\n";
+    }
+    std::string settingsText = settings.str();
+
+    std::vector<StreamedCellEntry> directory;
+    std::vector<std::string> cellText;
+    directory.reserve(cellObjects.size());
+    cellText.reserve(cellObjects.size());
+
+    uint64_t offset = sizeof(StreamedLevelHeader) + cellObjects.size() * sizeof(StreamedCellEntry) + settingsText.size();
+    for (const auto& [coord, rows] : cellObjects) {
+        StreamedCellEntry entry = {};
+        for (int axis = 0; axis < 3; ++axis) {
+            entry.coord[axis] = coord[axis];
+            entry.minBounds[axis] = std::numeric_limits<float>::max();
+            entry.maxBounds[axis] = -std::numeric_limits<float>::max();
+        }
+        entry.objectCount = static_cast<uint32_t>(rows.size());
+
+        std::ostringstream text;
+        for (uint32_t row : rows) {
+            objects[row]->Serialize(text);
+            entry.memoryEstimate += EstimateObjectBytes(*objects[row]);
+
+            const Float3& lo = minBounds[row];
+            const Float3& hi = maxBounds[row];
+            entry.minBounds[0] = std::min(entry.minBounds[0], lo.x);
+            entry.minBounds[1] = std::min(entry.minBounds[1], lo.y);
+            entry.minBounds[2] = std::min(entry.minBounds[2], lo.z);
+            entry.maxBounds[0] = std::max(entry.maxBounds[0], hi.x);
+            entry.maxBounds[1] = std::max(entry.maxBounds[1], hi.y);
+            entry.maxBounds[2] = std::max(entry.maxBounds[2], hi.z);
+        }
+
+        cellText.push_back(text.str());
+        entry.offset = offset;
+        entry.size = cellText.back().size();
+        offset += entry.size;
+        directory.push_back(entry);
+    }
+
+    StreamedLevelHeader header = {};
+    header.magic = STREAMED_LEVEL_MAGIC;
+    header.version = STREAMED_LEVEL_VERSION;
+    header.cellCount = static_cast<uint32_t>(directory.size());
+    header.cellSize = cellSize;
+    header.settingsOffset = sizeof(StreamedLevelHeader) + directory.size() * sizeof(StreamedCellEntry);
+    header.settingsSize = settingsText.size();
+    header.fileSize = offset;
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(directory.data()), static_cast<std::streamsize>(directory.size() * sizeof(StreamedCellEntry)));
+    file.write(settingsText.data(), static_cast<std::streamsize>(settingsText.size()));
+    for (const std::string& text : cellText) {
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+    file.close();
+    return !file.fail();
+}
+
+bool IsStreamedLevelFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    return file.gcount() == sizeof(magic) && magic == STREAMED_LEVEL_MAGIC;
+}
+
+std::string StreamingStats::Format() const {
+    std::ostringstream out;
+    out << "Cells:           " << residentCells << " resident, " << loadingCells << " loading of " << cellCount << "\n";
+    out << "Objects:         " << residentObjects << "\n";
+    out << "Resident:        " << residentBytes << " bytes\n";
+    out << "Loading:         " << loadingBytes << " bytes\n";
+    out << "Budget:          " << memoryBudget << " bytes (peak " << peakBytes << ")\n";
+    out << "Loaded/evicted:  " << cellsLoaded << " / " << cellsEvicted << " (" << loadsDiscarded << " discarded)\n";
+    out << "Average load:    " << averageLoadMs << " ms\n";
+    return out.str();
+}
+
+LevelStreamer::LevelStreamer(LevelData& level) : LevelStreamer(level, ThreadPool::GetShared()) {}
+
+LevelStreamer::LevelStreamer(LevelData& level, ThreadPool& pool)
+    : level_(level), pool_(pool), cellSize_(0.0f), loadRadius_(0.0f), unloadRadius_(0.0f),
+    memoryBudget_(256 * 1024 * 1024), committedBytes_(0), totalLoadMs_(0.0) {
+}
+
+LevelStreamer::~LevelStreamer() {
+    Close();
+}
+
+bool LevelStreamer::Open(const fs::path& path) {
+    Close();
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    StreamedLevelHeader header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (file.gcount() != sizeof(header) || header.magic != STREAMED_LEVEL_MAGIC ||
+        header.version != STREAMED_LEVEL_VERSION || header.fileSize != fs::file_size(path) || !(header.cellSize > 0.0f)) {
+        return false;
+    }
+
+    // Every section has to lie inside the file before any worker seeks to it
+    uint64_t directoryEnd = sizeof(header) + static_cast<uint64_t>(header.cellCount) * sizeof(StreamedCellEntry);
+    if (directoryEnd > header.fileSize || header.settingsOffset < directoryEnd ||
+        header.settingsSize > header.fileSize - header.settingsOffset) {
+        return false;
+    }
+
+    std::vector<StreamedCellEntry> entries(header.cellCount);
+    file.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(StreamedCellEntry)));
+    for (const StreamedCellEntry& entry : entries) {
+        if (entry.offset < directoryEnd || entry.offset > header.fileSize || entry.size > header.fileSize - entry.offset) {
+            return false;
+        }
+    }
+
+    std::string settingsText(static_cast<size_t>(header.settingsSize), '\0');
+    file.seekg(static_cast<std::streamoff>(header.settingsOffset));
+    file.read(settingsText.data(), static_cast<std::streamsize>(settingsText.size()));
+    if (!file) {
+        return false;
+    }
+
+    LevelTextChunk settings;
+    ParseLevelText(settingsText, settings);
+
+    level_.Clear();
+    for (const auto& [key, value] : settings.settings) {
+        level_.SetSetting(key, value);
+    }
+
+    path_ = path;
+    cellSize_ = header.cellSize;
+    entries_ = std::move(entries);
+    cells_ = std::vector<Cell>(entries_.size());
+    if (loadRadius_ <= 0.0f) {
+        SetRadii(2.0f * cellSize_, 3.0f * cellSize_);
+    }
+    totals_ = StreamingStats();
+    totals_.cellCount = entries_.size();
+    totalLoadMs_ = 0.0;
+    return true;
+}
+
+void LevelStreamer::Close() {
+    for (uint32_t i = 0; i < cells_.size(); ++i) {
+        if (cells_[i].state == CellState::Loading) {
+            cells_[i].task.wait();
+            cells_[i].pending.reset();
+            cells_[i].state = CellState::Unloaded;
+        }
+        else if (cells_[i].state == CellState::Resident) {
+            Evict(i);
+        }
+    }
+
+    cells_.clear();
+    entries_.clear();
+    committedBytes_ = 0;
+    path_.clear();
+}
+
+void LevelStreamer::SetRadii(float loadRadius, float unloadRadius) {
+    loadRadius_ = loadRadius;
+    unloadRadius_ = std::max(loadRadius, unloadRadius);
+}
+
+void LevelStreamer::SetMemoryBudget(size_t bytes) {
+    memoryBudget_ = bytes;
+}
+
+void LevelStreamer::Update(const Float3& focus) {
+    for (uint32_t i = 0; i < cells_.size(); ++i) {
+        cells_[i].distance = DistanceToCell(entries_[i], focus);
+    }
+
+    // Finished loads first, so their budget is settled before anything else
+    size_t pendingLoads = 0;
+    for (uint32_t i = 0; i < cells_.size(); ++i) {
+        Cell& cell = cells_[i];
+        if (cell.state != CellState::Loading) {
+            continue;
+        }
+        if (cell.task.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            FinishLoad(i);
+        }
+        else {
+            ++pendingLoads;
+        }
+    }
+
+    candidates_.clear();
+    for (uint32_t i = 0; i < cells_.size(); ++i) {
+        Cell& cell = cells_[i];
+        if (cell.state == CellState::Resident && cell.distance > unloadRadius_) {
+            Evict(i);
+        }
+        else if (cell.state == CellState::Unloaded && cell.distance <= loadRadius_) {
+            candidates_.push_back(i);
+        }
+    }
+
+    // Nearest first; stop at the first cell that does not fit so a far cell
+    // never takes the place of a nearer one
+    std::sort(candidates_.begin(), candidates_.end(), [this](uint32_t a, uint32_t b) {
+        return cells_[a].distance < cells_[b].distance;
+    });
+    for (uint32_t i : candidates_) {
+        if (pendingLoads >= MAX_PENDING_LOADS) {
+            break;
+        }
+        if (!MakeRoom(static_cast<size_t>(entries_[i].memoryEstimate), cells_[i].distance)) {
+            break;
+        }
+        StartLoad(i);
+        ++pendingLoads;
+    }
+}
+
+void LevelStreamer::Flush(const Float3& focus) {
+    for (;;) {
+        Update(focus);
+
+        bool loading = false;
+        for (Cell& cell : cells_) {
+            if (cell.state == CellState::Loading) {
+                cell.task.wait();
+                loading = true;
+            }
+        }
+        if (!loading) {
+            break;
+        }
+    }
+}
+
+bool LevelStreamer::MakeRoom(size_t bytes, float distance) {
+    while (committedBytes_ + bytes > memoryBudget_) {
+        uint32_t farthest = static_cast<uint32_t>(cells_.size());
+        for (uint32_t i = 0; i < cells_.size(); ++i) {
+            if (cells_[i].state == CellState::Resident && cells_[i].distance > distance &&
+                (farthest == cells_.size() || cells_[i].distance > cells_[farthest].distance)) {
+                farthest = i;
+            }
+        }
+        if (farthest == cells_.size()) {
+            return false;
+        }
+        Evict(farthest);
+    }
+    return true;
+}
+
+void LevelStreamer::StartLoad(uint32_t index) {
+    Cell& cell = cells_[index];
+    const StreamedCellEntry& entry = entries_[index];
+
+    cell.state = CellState::Loading;
+    cell.requested = std::chrono::steady_clock::now();
+    cell.pending = std::make_shared<PendingCell>();
+    committedBytes_ += static_cast<size_t>(entry.memoryEstimate);
+    totals_.peakBytes = std::max(totals_.peakBytes, committedBytes_);
+
+    // The task owns what it writes to, so a cell can be dropped while it runs
+    std::shared_ptr<PendingCell> pending = cell.pending;
+    fs::path path = path_;
+    uint64_t offset = entry.offset;
+    uint64_t size = entry.size;
+    cell.task = pool_.Submit([pending, path, offset, size]() {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            return;
+        }
+        pending->text.resize(static_cast<size_t>(size));
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(pending->text.data(), static_cast<std::streamsize>(size));
+        if (!file) {
+            return;
+        }
+        pending->ok = ParseLevelText(pending->text, pending->chunk);
+    });
+}
+
+void LevelStreamer::FinishLoad(uint32_t index) {
+    Cell& cell = cells_[index];
+    const StreamedCellEntry& entry = entries_[index];
+    std::shared_ptr<PendingCell> pending = std::move(cell.pending);
+
+    // The focus may have moved on while the cell was read
+    if (!pending->ok || cell.distance > unloadRadius_) {
+        cell.state = CellState::Unloaded;
+        committedBytes_ -= static_cast<size_t>(entry.memoryEstimate);
+        ++totals_.loadsDiscarded;
+        return;
+    }
+
+    LevelTextChunk& chunk = pending->chunk;
+    cell.handles.reserve(chunk.objects.size());
+    size_t property = 0;
+    for (size_t i = 0; i < chunk.objects.size(); ++i) {
+        const LevelTextObject& parsed = chunk.objects[i];
+        ObjectHandle handle = level_.CreateObject(parsed.name, parsed.type, parsed.transform);
+        LevelObject* object = level_.GetObject(handle);
+        for (; property < chunk.propertyEnds[i]; ++property) {
+            if (object) {
+                object->SetProperty(chunk.properties[property].first, chunk.properties[property].second);
+            }
+        }
+        if (object) {
+            cell.handles.push_back(handle);
+        }
+    }
+
+    cell.state = CellState::Resident;
+    ++totals_.cellsLoaded;
+    totalLoadMs_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cell.requested).count();
+}
+
+void LevelStreamer::Evict(uint32_t index) {
+    Cell& cell = cells_[index];
+    for (const ObjectHandle& handle : cell.handles) {
+        level_.RemoveObject(handle);
+    }
+    cell.handles.clear();
+    cell.handles.shrink_to_fit();
+
+    cell.state = CellState::Unloaded;
+    committedBytes_ -= static_cast<size_t>(entries_[index].memoryEstimate);
+    ++totals_.cellsEvicted;
+}
+
+StreamingStats LevelStreamer::GetStats() const {
+    StreamingStats stats = totals_;
+    stats.memoryBudget = memoryBudget_;
+    for (uint32_t i = 0; i < cells_.size(); ++i) {
+        if (cells_[i].state == CellState::Resident) {
+            ++stats.residentCells;
+            stats.residentObjects += cells_[i].handles.size();
+            stats.residentBytes += static_cast<size_t>(entries_[i].memoryEstimate);
+        }
+        else if (cells_[i].state == CellState::Loading) {
+            ++stats.loadingCells;
+            stats.loadingBytes += static_cast<size_t>(entries_[i].memoryEstimate);
+        }
+    }
+    stats.averageLoadMs = totals_.cellsLoaded > 0 ? totalLoadMs_ / totals_.cellsLoaded : 0.0;
+    return stats;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "LevelEditor.h"
+#include "LevelTextParser.h"
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Cell-partitioned levels for streaming
+//
+// PartitionLevel splits a level into cubic cells by object position and
+// writes a single file:
+//
+//   StreamedLevelHeader
+//   StreamedCellEntry[cellCount]   (cell directory)
+//   char[]                         (settings as SETTING= lines)
+//   char[] per cell                (the cell's OBJECT ... END_OBJECT blocks)
+//
+// Every cell is level text that ParseLevelText reads on its own, so a cell
+// loads with one seek and one read. Offsets are absolute file offsets and all
+// integers are little-endian.
+
+const uint32_t STREAMED_LEVEL_MAGIC = 0x534C5550; // "PULS"
+const uint32_t STREAMED_LEVEL_VERSION = 1;
+
+struct StreamedLevelHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t cellCount;
+    float cellSize;
+    uint64_t settingsOffset;
+    uint64_t settingsSize;
+    uint64_t fileSize;
+};
+
+struct StreamedCellEntry {
+    int32_t coord[3];
+    uint32_t objectCount;
+    float minBounds[3];  // bounds of the cell's objects, which may reach past the cell
+    float maxBounds[3];
+    uint64_t offset;
+    uint64_t size;
+    uint64_t memoryEstimate;  // bytes the objects take once added to a level
+};
+
+static_assert(sizeof(StreamedLevelHeader) == 40, "StreamedLevelHeader layout changed");
+static_assert(sizeof(StreamedCellEntry) == 64, "StreamedCellEntry layout changed");
+
+bool PartitionLevel(const LevelData& level, float cellSize, const fs::path& path);
+bool IsStreamedLevelFile(const fs::path& path);
+
+struct StreamingStats {
+    size_t cellCount = 0;
+    size_t residentCells = 0;
+    size_t loadingCells = 0;
+    size_t residentObjects = 0;
+    size_t residentBytes = 0;  // directory estimates of resident cells
+    size_t loadingBytes = 0;   // reserved against the budget by loads in flight
+    size_t memoryBudget = 0;
+    size_t peakBytes = 0;
+    // Since Open
+    size_t cellsLoaded = 0;
+    size_t cellsEvicted = 0;
+    size_t loadsDiscarded = 0;  // finished after the cell was no longer wanted
+    double averageLoadMs = 0.0; // request to resident
+
+    std::string Format() const;
+};
+
+// Streams the cells of a partitioned level into a LevelData around a focus
+// point. Files are read and parsed on a thread pool; objects are added to and
+// removed from the level only inside Update, on the caller's thread. Edits to
+// streamed objects are lost when their cell is evicted.
+class LevelStreamer {
+public:
+    explicit LevelStreamer(LevelData& level);
+    LevelStreamer(LevelData& level, ThreadPool& pool);
+    ~LevelStreamer();
+
+    LevelStreamer(const LevelStreamer&) = delete;
+    LevelStreamer& operator=(const LevelStreamer&) = delete;
+
+    // Reads the cell directory, clears the level and applies the settings.
+    // No cells are loaded until the first Update.
+    bool Open(const fs::path& path);
+    // Waits for loads in flight and removes every streamed object
+    void Close();
+
+    // Cells whose bounds come within loadRadius of the focus are loaded,
+    // nearest first; resident cells farther than unloadRadius are evicted.
+    void SetRadii(float loadRadius, float unloadRadius);
+    // When a wanted cell does not fit, resident cells farther from the focus
+    // than it are evicted, farthest first
+    void SetMemoryBudget(size_t bytes);
+
+    // Adds finished cells to the level, evicts and starts new loads
+    void Update(const Float3& focus);
+    // Updates until every wanted cell that fits the budget is resident
+    void Flush(const Float3& focus);
+
+    StreamingStats GetStats() const;
+    float GetCellSize() const { return cellSize_; }
+    const std::vector<StreamedCellEntry>& GetCells() const { return entries_; }
+    bool IsCellResident(size_t cell) const { return cells_[cell].state == CellState::Resident; }
+
+private:
+    enum class CellState : uint8_t {
+        Unloaded,
+        Loading,
+        Resident
+    };
+
+    // Filled by a worker; properties in chunk view text
+    struct PendingCell {
+        std::string text;
+        LevelTextChunk chunk;
+        bool ok = false;
+    };
+
+    struct Cell {
+        CellState state = CellState::Unloaded;
+        float distance = 0.0f;
+        std::shared_ptr<PendingCell> pending;
+        std::future<void> task;
+        std::chrono::steady_clock::time_point requested;
+        std::vector<ObjectHandle> handles;
+    };
+
+    void FinishLoad(uint32_t cell);
+    void StartLoad(uint32_t cell);
+    void Evict(uint32_t cell);
+    bool MakeRoom(size_t bytes, float distance);
+
+    LevelData& level_;
+    ThreadPool& pool_;
+    fs::path path_;
+    float cellSize_;
+    std::vector<StreamedCellEntry> entries_;
+    std::vector<Cell> cells_;
+    std::vector<uint32_t> candidates_;  // reused by Update
+
+    float loadRadius_;
+    float unloadRadius_;
+    size_t memoryBudget_;
+    size_t committedBytes_;  // resident plus loading
+    StreamingStats totals_;
+    double totalLoadMs_;
+};
@@ -0,0 +1,201 @@
+#include "LevelTextParser.h"
+#include "LevelBinary.h"
+#include "LevelXml.h"
+#include "LevelCompression.h"
+#include "LevelNumbers.h"
+#include "ThreadPool.h"
+#include <charconv>
+#include <fstream>
+
+namespace {
+
+    // Returns the next line without its terminator and advances pos past it
+    std::string_view NextLine(std::string_view text, size_t& pos) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+
+        std::string_view line = text.substr(pos, end - pos);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        pos = end < text.size() ? end + 1 : end;
+        return line;
+    }
+
+    bool IsObjectLine(std::string_view text, size_t lineStart) {
+        std::string_view rest = text.substr(lineStart);
+        if (rest.compare(0, 6, "OBJECT") != 0) {
+            return false;
+        }
+        return rest.size() == 6 || rest[6] == '\n' || rest[6] == '\r';
+    }
+
+    // Reads lines up to END_OBJECT, mirroring LevelObject::Deserialize.
+    // Properties go to chunk.properties rather than onto the object.
+    void ParseObject(std::string_view text, size_t& pos, LevelTextChunk& chunk) {
+        std::string_view name;
+        int type = 0;
+        float position[3] = { 0, 0, 0 };
+        float rotation[3] = { 0, 0, 0 };
+        float scale[3] = { 1, 1, 1 };
+
+        while (pos < text.size()) {
+            std::string_view line = NextLine(text, pos);
+            if (line == "END_OBJECT") {
+                break;
+            }
+
+            size_t equals = line.find('=');
+            if (equals == std::string_view::npos) {
+                continue;
+            }
+            std::string_view key = line.substr(0, equals);
+            std::string_view value = line.substr(equals + 1);
+
+            if (key == "NAME") {
+                name = value;
+            }
+            else if (key == "TYPE") {
+                std::from_chars(value.data(), value.data() + value.size(), type);
+            }
+            else if (key == "POSITION") {
+                ParseFloatList(value, position, 3);
+            }
+            else if (key == "ROTATION") {
+                ParseFloatList(value, rotation, 3);
+            }
+            else if (key == "SCALE") {
+                ParseFloatList(value, scale, 3);
+            }
+            else if (key == "PROPERTY") {
+                size_t commaPos = value.find(',');
+                if (commaPos != std::string_view::npos) {
+                    chunk.properties.emplace_back(value.substr(0, commaPos), value.substr(commaPos + 1));
+                }
+            }
+        }
+
+        LevelTextObject object;
+        object.name = name;
+        object.type = static_cast<ObjectType>(type);
+        object.transform.position = { position[0], position[1], position[2] };
+        object.transform.rotation = { rotation[0], rotation[1], rotation[2] };
+        object.transform.scale = { scale[0], scale[1], scale[2] };
+        chunk.objects.push_back(object);
+        chunk.propertyEnds.push_back(chunk.properties.size());
+    }
+
+}
+
+std::vector<std::string_view> SplitLevelText(std::string_view text, size_t maxChunks) {
+    std::vector<std::string_view> chunks;
+    if (maxChunks < 1) {
+        maxChunks = 1;
+    }
+
+    size_t chunkStart = 0;
+    for (size_t i = 1; i < maxChunks; ++i) {
+        size_t target = text.size() / maxChunks * i;
+        if (target <= chunkStart) {
+            continue;
+        }
+
+        // Move the split forward to the start of the next OBJECT line
+        size_t split = std::string_view::npos;
+        for (size_t pos = text.find('\n', target - 1); pos != std::string_view::npos; pos = text.find('\n', pos + 1)) {
+            if (IsObjectLine(text, pos + 1)) {
+                split = pos + 1;
+                break;
+            }
+        }
+        if (split == std::string_view::npos) {
+            break;
+        }
+
+        chunks.push_back(text.substr(chunkStart, split - chunkStart));
+        chunkStart = split;
+    }
+
+    chunks.push_back(text.substr(chunkStart));
+    return chunks;
+}
+
+bool ParseLevelText(std::string_view text, LevelTextChunk& chunk) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        std::string_view line = NextLine(text, pos);
+        if (line == "OBJECT") {
+            ParseObject(text, pos, chunk);
+        }
+        else if (line.compare(0, 8, "SETTING=") == 0) {
+            std::string_view value = line.substr(8);
+            size_t commaPos = value.find(',');
+            if (commaPos != std::string_view::npos) {
+                chunk.settings.emplace_back(std::string(value.substr(0, commaPos)), std::string(value.substr(commaPos + 1)));
+            }
+        }
+    }
+    return true;
+}
+
+// Parallel text loading for LevelData
+bool LevelData::LoadFromFileParallel(const fs::path& path) {
+    return LoadFromFileParallel(path, ThreadPool::GetShared());
+}
+
+bool LevelData::LoadFromFileParallel(const fs::path& path, ThreadPool& pool) {
+    WaitForBackgroundSave();
+    if (IsBinaryLevelFile(path) || IsXmlLevelFile(path) || IsCompressedLevelFile(path)) {
+        return LoadFromFile(path);
+    }
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string text(static_cast<size_t>(fs::file_size(path)), '\0');
+    file.read(text.data(), static_cast<std::streamsize>(text.size()));
+    text.resize(static_cast<size_t>(file.gcount()));
+    file.close();
+
+    // A few chunks per worker keeps the pool busy when object sizes vary
+    std::vector<std::string_view> pieces = SplitLevelText(text, static_cast<size_t>(pool.GetThreadCount()) * 4);
+    std::vector<LevelTextChunk> chunks(pieces.size());
+    pool.ParallelFor(pieces.size(), [&](size_t i) {
+        ParseLevelText(pieces[i], chunks[i]);
+    });
+
+    // Clear existing data and merge in file order
+    Clear();
+
+    size_t objectCount = 0;
+    for (const auto& chunk : chunks) {
+        objectCount += chunk.objects.size();
+    }
+    Reserve(objectCount);
+
+    for (auto& chunk : chunks) {
+        AddTextChunk(chunk);
+    }
+
+    return LoadJournal(path);
+}
+
+void LevelData::AddTextChunk(LevelTextChunk& chunk) {
+    size_t property = 0;
+    for (size_t i = 0; i < chunk.objects.size(); ++i) {
+        const LevelTextObject& parsed = chunk.objects[i];
+        LevelObject* object = CreateLoadedObject(parsed.name, parsed.type, parsed.transform);
+        for (; property < chunk.propertyEnds[i]; ++property) {
+            if (object) {
+                object->SetProperty(chunk.properties[property].first, chunk.properties[property].second);
+            }
+        }
+    }
+    for (auto& [key, value] : chunk.settings) {
+        settings_[key] = std::move(value);
+    }
+}
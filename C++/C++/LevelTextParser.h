@@ -0,0 +1,33 @@
+#pragma once
+
+#include "LevelEditor.h"
+#include <string_view>
+#include <utility>
+
+// In-memory parser for the LEVEL_FILE_VERSION=1.0 text format.
+// Works on string views over a buffer holding the whole file, so independent
+// chunks can be parsed on different threads.
+
+// An OBJECT block without its properties; name views the parsed text
+struct LevelTextObject {
+    std::string_view name;
+    ObjectType type;
+    Transform transform;
+};
+
+struct LevelTextChunk {
+    std::vector<LevelTextObject> objects;
+    // PROPERTY key/value views into the parsed text. Properties are applied
+    // once an object is in its level so they intern into the level's pool;
+    // objects[i] owns entries [propertyEnds[i - 1], propertyEnds[i]).
+    std::vector<std::pair<std::string_view, std::string_view>> properties;
+    std::vector<size_t> propertyEnds;
+    std::vector<std::pair<std::string, std::string>> settings;
+};
+
+// Splits level text into at most maxChunks pieces. Every piece after the
+// first starts on an OBJECT line, so each one parses independently.
+std::vector<std::string_view> SplitLevelText(std::string_view text, size_t maxChunks);
+
+// Parses one piece produced by SplitLevelText
+bool ParseLevelText(std::string_view text, LevelTextChunk& chunk);
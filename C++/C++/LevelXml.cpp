@@ -0,0 +1,568 @@
+#include "LevelXml.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+namespace {
+
+    bool IsXmlSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    bool ParseFloat(std::string_view text, float& value) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    bool ParseInt(std::string_view text, int& value) {
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    // Writes text with the five predefined XML entities escaped
+    void WriteEscaped(std::ostream& out, std::string_view text) {
+        size_t runStart = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            const char* entity = nullptr;
+            switch (text[i]) {
+            case '&': entity = "&amp;"; break;
+            case '<': entity = "&lt;"; break;
+            case '>': entity = "&gt;"; break;
+            case '"': entity = "&quot;"; break;
+            case '\'': entity = "&apos;"; break;
+            default: continue;
+            }
+            out.write(text.data() + runStart, static_cast<std::streamsize>(i - runStart));
+            out << entity;
+            runStart = i + 1;
+        }
+        out.write(text.data() + runStart, static_cast<std::streamsize>(text.size() - runStart));
+    }
+
+    void WriteVector(std::ostream& out, const char* element, const Float3& v) {
+        out << "      <" << element << " x=\"" << v.x << "\" y=\"" << v.y << "\" z=\"" << v.z << "\"/>\n";
+    }
+
+    // Appends the UTF-8 encoding of a code point; returns the number of bytes written
+    size_t EncodeUtf8(unsigned long codePoint, char* out) {
+        if (codePoint < 0x80) {
+            out[0] = static_cast<char>(codePoint);
+            return 1;
+        }
+        if (codePoint < 0x800) {
+            out[0] = static_cast<char>(0xC0 | (codePoint >> 6));
+            out[1] = static_cast<char>(0x80 | (codePoint & 0x3F));
+            return 2;
+        }
+        if (codePoint < 0x10000) {
+            out[0] = static_cast<char>(0xE0 | (codePoint >> 12));
+            out[1] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out[2] = static_cast<char>(0x80 | (codePoint & 0x3F));
+            return 3;
+        }
+        out[0] = static_cast<char>(0xF0 | (codePoint >> 18));
+        out[1] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out[2] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out[3] = static_cast<char>(0x80 | (codePoint & 0x3F));
+        return 4;
+    }
+
+}
+
+// Implementation of XmlPullParser
+XmlPullParser::XmlPullParser(std::istream& input, size_t bufferSize)
+    : input_(input), buffer_(bufferSize < 256 ? 256 : bufferSize), pos_(0), end_(0), eof_(false),
+      attributeCount_(0), pendingEnd_(false) {
+}
+
+bool XmlPullParser::Fill(size_t keepFrom) {
+    if (eof_) {
+        return false;
+    }
+
+    // Slide the unconsumed bytes to the front; only grow when a single token fills the window
+    size_t keep = end_ - keepFrom;
+    if (keepFrom > 0) {
+        std::memmove(buffer_.data(), buffer_.data() + keepFrom, keep);
+        pos_ -= keepFrom;
+        end_ = keep;
+    }
+    if (end_ == buffer_.size()) {
+        buffer_.resize(buffer_.size() * 2);
+    }
+
+    input_.read(buffer_.data() + end_, static_cast<std::streamsize>(buffer_.size() - end_));
+    size_t count = static_cast<size_t>(input_.gcount());
+    end_ += count;
+    if (count == 0) {
+        eof_ = true;
+    }
+    return count > 0;
+}
+
+bool XmlPullParser::EnsureAvailable(size_t count) {
+    while (end_ - pos_ < count) {
+        if (!Fill(pos_)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool XmlPullParser::FindTagEnd(size_t& end) {
+    size_t offset = 0;
+    char quote = 0;
+    for (;;) {
+        for (size_t i = pos_ + offset; i < end_; ++i) {
+            char c = buffer_[i];
+            if (quote) {
+                if (c == quote) quote = 0;
+            }
+            else if (c == '"' || c == '\'') {
+                quote = c;
+            }
+            else if (c == '>') {
+                end = i;
+                return true;
+            }
+        }
+
+        offset = end_ - pos_;
+        if (!Fill(pos_)) {
+            return false;
+        }
+    }
+}
+
+bool XmlPullParser::FindSequence(const char* sequence, size_t length, size_t& found) {
+    size_t offset = 0;
+    for (;;) {
+        const char* begin = buffer_.data() + pos_ + offset;
+        const char* end = buffer_.data() + end_;
+        const char* match = std::search(begin, end, sequence, sequence + length);
+        if (match != end) {
+            found = static_cast<size_t>(match - buffer_.data());
+            return true;
+        }
+
+        // Rescan the tail in case the sequence straddles the refill
+        size_t scanned = end_ - pos_;
+        offset = scanned >= length ? scanned - length + 1 : 0;
+        if (!Fill(pos_)) {
+            return false;
+        }
+    }
+}
+
+XmlEvent XmlPullParser::Fail(const char* message) {
+    error_ = message;
+    return XmlEvent::Error;
+}
+
+std::string_view XmlPullParser::GetAttribute(std::string_view name) const {
+    for (size_t i = 0; i < attributeCount_; ++i) {
+        if (attributes_[i].name == name) {
+            return attributes_[i].value;
+        }
+    }
+    return std::string_view();
+}
+
+std::string_view XmlPullParser::Decode(char* begin, char* end) {
+    char* amp = static_cast<char*>(std::memchr(begin, '&', static_cast<size_t>(end - begin)));
+    if (!amp) {
+        return std::string_view(begin, static_cast<size_t>(end - begin));
+    }
+
+    // Entities are never shorter than their replacement, so decode in place
+    char* out = amp;
+    char* in = amp;
+    while (in < end) {
+        if (*in != '&') {
+            *out++ = *in++;
+            continue;
+        }
+
+        char* semicolon = static_cast<char*>(std::memchr(in, ';', static_cast<size_t>(end - in)));
+        if (!semicolon) {
+            *out++ = *in++;
+            continue;
+        }
+
+        std::string_view entity(in + 1, static_cast<size_t>(semicolon - in - 1));
+        if (entity == "lt") *out++ = '<';
+        else if (entity == "gt") *out++ = '>';
+        else if (entity == "amp") *out++ = '&';
+        else if (entity == "quot") *out++ = '"';
+        else if (entity == "apos") *out++ = '\'';
+        else if (entity.size() > 1 && entity[0] == '#') {
+            unsigned long codePoint = 0;
+            bool hex = entity[1] == 'x' || entity[1] == 'X';
+            const char* digits = entity.data() + (hex ? 2 : 1);
+            auto result = std::from_chars(digits, entity.data() + entity.size(), codePoint, hex ? 16 : 10);
+            if (result.ec != std::errc() || result.ptr != entity.data() + entity.size() || codePoint > 0x10FFFF) {
+                *out++ = *in++;
+                continue;
+            }
+            out += EncodeUtf8(codePoint, out);
+        }
+        else {
+            // Unknown entity, keep it verbatim
+            *out++ = *in++;
+            continue;
+        }
+        in = semicolon + 1;
+    }
+
+    return std::string_view(begin, static_cast<size_t>(out - begin));
+}
+
+XmlEvent XmlPullParser::Next() {
+    attributeCount_ = 0;
+    text_ = std::string_view();
+
+    if (pendingEnd_) {
+        // Second half of a self-closing element, name_ still points at its name
+        pendingEnd_ = false;
+        return XmlEvent::EndElement;
+    }
+
+    for (;;) {
+        if (pos_ >= end_ && !Fill(pos_)) {
+            return XmlEvent::EndDocument;
+        }
+
+        if (buffer_[pos_] != '<') {
+            // Character data up to the next tag
+            const char* start = buffer_.data() + pos_;
+            const char* lt = static_cast<const char*>(std::memchr(start, '<', end_ - pos_));
+            if (!lt && !eof_ && (pos_ > 0 || end_ < buffer_.size())) {
+                Fill(pos_);
+                continue;
+            }
+
+            size_t textEnd = lt ? static_cast<size_t>(lt - buffer_.data()) : end_;
+            char* textBegin = buffer_.data() + pos_;
+            pos_ = textEnd;
+            text_ = Decode(textBegin, buffer_.data() + textEnd);
+            return XmlEvent::Text;
+        }
+
+        if (!EnsureAvailable(2)) {
+            return Fail("Unexpected end of document");
+        }
+
+        char kind = buffer_[pos_ + 1];
+        if (kind == '?') {
+            size_t found;
+            if (!FindSequence("?>", 2, found)) return Fail("Unterminated processing instruction");
+            pos_ = found + 2;
+            continue;
+        }
+
+        if (kind == '!') {
+            if (EnsureAvailable(4) && std::memcmp(buffer_.data() + pos_, "<!--", 4) == 0) {
+                size_t found;
+                if (!FindSequence("-->", 3, found)) return Fail("Unterminated comment");
+                pos_ = found + 3;
+                continue;
+            }
+            if (EnsureAvailable(9) && std::memcmp(buffer_.data() + pos_, "<![CDATA[", 9) == 0) {
+                size_t found;
+                if (!FindSequence("]]>", 3, found)) return Fail("Unterminated CDATA section");
+                text_ = std::string_view(buffer_.data() + pos_ + 9, found - pos_ - 9);
+                pos_ = found + 3;
+                return XmlEvent::Text;
+            }
+
+            size_t tagEnd;
+            if (!FindTagEnd(tagEnd)) return Fail("Unterminated declaration");
+            pos_ = tagEnd + 1;
+            continue;
+        }
+
+        size_t tagEnd;
+        if (!FindTagEnd(tagEnd)) {
+            return Fail("Unterminated tag");
+        }
+
+        if (kind == '/') {
+            const char* begin = buffer_.data() + pos_ + 2;
+            const char* end = buffer_.data() + tagEnd;
+            while (end > begin && IsXmlSpace(end[-1])) --end;
+            name_ = std::string_view(begin, static_cast<size_t>(end - begin));
+            pos_ = tagEnd + 1;
+            return XmlEvent::EndElement;
+        }
+
+        return ParseStartElement(tagEnd);
+    }
+}
+
+XmlEvent XmlPullParser::ParseStartElement(size_t tagEnd) {
+    char* p = buffer_.data() + pos_ + 1;
+    char* end = buffer_.data() + tagEnd;
+    bool selfClosing = end > p && end[-1] == '/';
+    if (selfClosing) {
+        --end;
+    }
+
+    char* nameBegin = p;
+    while (p < end && !IsXmlSpace(*p)) ++p;
+    if (p == nameBegin) {
+        return Fail("Element without a name");
+    }
+    name_ = std::string_view(nameBegin, static_cast<size_t>(p - nameBegin));
+
+    for (;;) {
+        while (p < end && IsXmlSpace(*p)) ++p;
+        if (p == end) {
+            break;
+        }
+
+        char* attrName = p;
+        while (p < end && *p != '=' && !IsXmlSpace(*p)) ++p;
+        size_t attrNameLength = static_cast<size_t>(p - attrName);
+        while (p < end && IsXmlSpace(*p)) ++p;
+        if (p == end || *p != '=') {
+            return Fail("Attribute without a value");
+        }
+        ++p;
+        while (p < end && IsXmlSpace(*p)) ++p;
+        if (p == end || (*p != '"' && *p != '\'')) {
+            return Fail("Attribute value is not quoted");
+        }
+
+        char quote = *p++;
+        char* valueBegin = p;
+        while (p < end && *p != quote) ++p;
+        if (p == end) {
+            return Fail("Unterminated attribute value");
+        }
+
+        // Reuse attribute slots so steady-state parsing does not allocate
+        if (attributeCount_ == attributes_.size()) {
+            attributes_.emplace_back();
+        }
+        XmlAttribute& attribute = attributes_[attributeCount_++];
+        attribute.name = std::string_view(attrName, attrNameLength);
+        attribute.value = Decode(valueBegin, p);
+        ++p;
+    }
+
+    pos_ = tagEnd + 1;
+    pendingEnd_ = selfClosing;
+    return XmlEvent::StartElement;
+}
+
+// Implementation of XmlLevelReader
+XmlLevelReader::XmlLevelReader() : done_(true) {
+}
+
+bool XmlLevelReader::Open(const fs::path& path) {
+    file_.close();
+    file_.clear();
+    file_.open(path, std::ios::in | std::ios::binary);
+    if (!file_.is_open()) {
+        return false;
+    }
+
+    parser_ = std::make_unique<XmlPullParser>(file_);
+    settings_.clear();
+    error_.clear();
+    done_ = false;
+    return true;
+}
+
+bool XmlLevelReader::Fail(const std::string& message) {
+    error_ = message;
+    done_ = true;
+    return false;
+}
+
+std::unique_ptr<LevelObject> XmlLevelReader::ReadNextObject() {
+    while (!done_) {
+        switch (parser_->Next()) {
+        case XmlEvent::StartElement: {
+            std::string_view name = parser_->GetName();
+            if (name == "object") {
+                return ReadObject();
+            }
+            if (name == "setting") {
+                settings_[std::string(parser_->GetAttribute("key"))] = std::string(parser_->GetAttribute("value"));
+            }
+            else if (name == "level") {
+                std::string_view version = parser_->GetAttribute("version");
+                if (!version.empty() && version != "1.0") {
+                    Fail("Unsupported level version: " + std::string(version));
+                }
+            }
+            break;
+        }
+        case XmlEvent::Error:
+            Fail(parser_->GetError());
+            break;
+        case XmlEvent::EndDocument:
+            done_ = true;
+            break;
+        default:
+            break;
+        }
+    }
+    return nullptr;
+}
+
+std::unique_ptr<LevelObject> XmlLevelReader::ReadObject() {
+    int type = 0;
+    std::string_view typeText = parser_->GetAttribute("type");
+    if (!typeText.empty() && !ParseInt(typeText, type)) {
+        Fail("Invalid object type: " + std::string(typeText));
+        return nullptr;
+    }
+
+    auto object = std::make_unique<LevelObject>(std::string(parser_->GetAttribute("name")), static_cast<ObjectType>(type));
+
+    // Read child elements until the matching </object>
+    int depth = 0;
+    for (;;) {
+        XmlEvent event = parser_->Next();
+        if (event == XmlEvent::Error) {
+            Fail(parser_->GetError());
+            return nullptr;
+        }
+        if (event == XmlEvent::EndDocument) {
+            Fail("Unterminated object element");
+            return nullptr;
+        }
+
+        if (event == XmlEvent::EndElement) {
+            if (depth == 0) {
+                return object;
+            }
+            --depth;
+        }
+        else if (event == XmlEvent::StartElement) {
+            std::string_view name = parser_->GetName();
+            if (depth++ > 0) {
+                continue;
+            }
+
+            if (name == "position" || name == "rotation" || name == "scale") {
+                float defaultValue = name == "scale" ? 1.0f : 0.0f;
+                float v[3] = { defaultValue, defaultValue, defaultValue };
+                const char* axes[3] = { "x", "y", "z" };
+                for (int i = 0; i < 3; ++i) {
+                    std::string_view text = parser_->GetAttribute(axes[i]);
+                    if (!text.empty() && !ParseFloat(text, v[i])) {
+                        Fail("Invalid number in " + std::string(name) + ": " + std::string(text));
+                        return nullptr;
+                    }
+                }
+
+                if (name == "position") object->SetPosition(v[0], v[1], v[2]);
+                else if (name == "rotation") object->SetRotation(v[0], v[1], v[2]);
+                else object->SetScale(v[0], v[1], v[2]);
+            }
+            else if (name == "property") {
+                object->SetProperty(parser_->GetAttribute("key"), parser_->GetAttribute("value"));
+            }
+        }
+    }
+}
+
+bool IsXmlLevelFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    char head[64] = {};
+    file.read(head, sizeof(head));
+    size_t count = static_cast<size_t>(file.gcount());
+
+    size_t i = 0;
+    if (count >= 3 && std::memcmp(head, "\xEF\xBB\xBF", 3) == 0) {
+        i = 3;
+    }
+    while (i < count && IsXmlSpace(head[i])) ++i;
+    return i < count && head[i] == '<';
+}
+
+// XML I/O for LevelData
+bool LevelData::SaveToXmlFile(const fs::path& path) const {
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    // Enough digits for every float to survive a round trip
+    file << std::setprecision(std::numeric_limits<float>::max_digits10);
+
+    file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    file << "<level version=\"1.0\">\n";
+
+    file << "  <settings>\n";
+    for (const auto& [key, value] : settings_) {
+        file << "    <setting key=\"";
+        WriteEscaped(file, key);
+        file << "\" value=\"";
+        WriteEscaped(file, value);
+        file << "\"/>\n";
+    }
+    file << "  </settings>\n";
+
+    file << "  <objects count=\"" << objects_.size() << "\">\n";
+    PropertyOrder order;
+    for (const auto& obj : objects_) {
+        file << "    <object name=\"";
+        WriteEscaped(file, obj->GetName());
+        file << "\" type=\"" << static_cast<int>(obj->GetType()) << "\">\n";
+
+        WriteVector(file, "position", obj->GetPosition());
+        WriteVector(file, "rotation", obj->GetRotation());
+        WriteVector(file, "scale", obj->GetScale());
+
+        obj->GetPropertyOrder(order);
+        for (uint32_t p : order) {
+            file << "      <property key=\"";
+            WriteEscaped(file, obj->GetPropertyKey(p));
+            file << "\" value=\"";
+            WriteEscaped(file, obj->GetPropertyText(p));
+            file << "\"/>\n";
+        }
+        file << "    </object>\n";
+    }
+    file << "  </objects>\n";
+    file << "</level>\n";
+
+    file.close();
+    return !file.fail();
+}
+
+bool LevelData::LoadFromXmlFile(const fs::path& path) {
+    XmlLevelReader reader;
+    if (!reader.Open(path)) {
+        return false;
+    }
+
+    // Clear existing data
+    Clear();
+
+    while (auto object = reader.ReadNextObject()) {
+        if (Contains(object->GetName())) {
+            droppedDuplicates_.emplace_back(object->GetName());
+            continue;
+        }
+        AddObject(std::move(object));
+    }
+    if (reader.HasError()) {
+        Clear();
+        return false;
+    }
+
+    settings_ = reader.GetSettings();
+    return true;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "LevelEditor.h"
+#include <fstream>
+#include <istream>
+#include <string_view>
+
+// XML level format
+//
+// <?xml version="1.0" encoding="UTF-8"?>
+// <level version="1.0">
+//   <settings>
+//     <setting key="GameTitle" value="My Game"/>
+//   </settings>
+//   <objects count="1">
+//     <object name="Door" type="0">
+//       <position x="0" y="0" z="0"/>
+//       <rotation x="0" y="0" z="0"/>
+//       <scale x="1" y="1" z="1"/>
+//       <property key="model" value="models/door.obj"/>
+//       <property key="script" value="scripts/door.lua"/>
+//     </object>
+//   </objects>
+// </level>
+
+enum class XmlEvent {
+    StartElement,
+    EndElement,
+    Text,
+    EndDocument,
+    Error
+};
+
+struct XmlAttribute {
+    std::string_view name;
+    std::string_view value;
+};
+
+// Streaming pull parser over an input stream.
+// Reads through a fixed-size window and never builds a tree. Names, text and
+// attributes are views into the window and stay valid until the next call to Next().
+class XmlPullParser {
+public:
+    explicit XmlPullParser(std::istream& input, size_t bufferSize = 64 * 1024);
+
+    XmlEvent Next();
+
+    std::string_view GetName() const { return name_; }
+    std::string_view GetText() const { return text_; }
+    size_t GetAttributeCount() const { return attributeCount_; }
+    const XmlAttribute& GetAttribute(size_t index) const { return attributes_[index]; }
+    std::string_view GetAttribute(std::string_view name) const;
+    const std::string& GetError() const { return error_; }
+
+private:
+    bool Fill(size_t keepFrom);
+    bool EnsureAvailable(size_t count);
+    bool FindTagEnd(size_t& end);
+    bool FindSequence(const char* sequence, size_t length, size_t& found);
+    XmlEvent ParseStartElement(size_t tagEnd);
+    XmlEvent Fail(const char* message);
+    std::string_view Decode(char* begin, char* end);
+
+    std::istream& input_;
+    std::vector<char> buffer_;
+    size_t pos_;
+    size_t end_;
+    bool eof_;
+
+    std::string_view name_;
+    std::string_view text_;
+    std::vector<XmlAttribute> attributes_;
+    size_t attributeCount_;
+    bool pendingEnd_;
+    std::string error_;
+};
+
+// Reads objects from an XML level one at a time
+class XmlLevelReader {
+public:
+    XmlLevelReader();
+
+    bool Open(const fs::path& path);
+
+    // Returns the next object in the file, or nullptr at the end of the file or on error
+    std::unique_ptr<LevelObject> ReadNextObject();
+
+    bool HasError() const { return !error_.empty(); }
+    const std::string& GetError() const { return error_; }
+
+    // Settings seen so far (the writer places them before the objects)
+    const std::map<std::string, std::string>& GetSettings() const { return settings_; }
+
+private:
+    std::unique_ptr<LevelObject> ReadObject();
+    bool Fail(const std::string& message);
+
+    std::ifstream file_;
+    std::unique_ptr<XmlPullParser> parser_;
+    std::map<std::string, std::string> settings_;
+    std::string error_;
+    bool done_;
+};
+
+// Returns true if the file looks like an XML document
+bool IsXmlLevelFile(const fs::path& path);
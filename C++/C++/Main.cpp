@@ -1,4 +1,5 @@
 #include <windows.h>
+#include "LevelEditor.h"
 #include "Engine.h"
 
 LPCWSTR szTitle = L"PUMA ENGINE";
@@ -78,9 +79,20 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         switch (wmId)
         {
         case 1001: // Level Designer button clicked
-            MessageBox(hWnd, L"Level Designer button clicked!", L"Info", MB_OK);
-            // Replace this with your actual level designer launch function
-            break;
+        {
+            // Runs its own message loop, which keeps the engine's timer going,
+            // until the editor window closes
+            EnableWindow(hBtnLevelDesigner, FALSE);
+            LevelEditor editor(hInst);
+            if (editor.Initialize()) {
+                editor.Run();
+            }
+            else {
+                MessageBox(hWnd, L"Level Designer failed to start!", L"Error", MB_OK);
+            }
+            EnableWindow(hBtnLevelDesigner, TRUE);
+        }
+        break;
         default:
             return DefWindowProc(hWnd, message, wParam, lParam);
         }
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+// Vector that keeps up to N elements inline and only allocates when it grows
+// past that. Elements are moved with memcpy, so T must be trivially copyable.
+// Spilled storage comes from a memory resource (new/delete unless reserve is
+// given one), which is kept in front of the elements for later growth and release.
+template <typename T, uint32_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable<T>::value, "SmallVector only holds trivially copyable types");
+
+public:
+    SmallVector() : size_(0), capacity_(N) {}
+    ~SmallVector() { Release(); }
+
+    SmallVector(const SmallVector& other) : size_(0), capacity_(N) { Assign(other); }
+    SmallVector(SmallVector&& other) noexcept : size_(0), capacity_(N) { Steal(other); }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            size_ = 0;
+            Assign(other);
+        }
+        return *this;
+    }
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            Release();
+            Steal(other);
+        }
+        return *this;
+    }
+
+    uint32_t size() const { return size_; }
+    uint32_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+
+    T* data() { return IsHeap() ? heap_ : reinterpret_cast<T*>(inline_); }
+    const T* data() const { return IsHeap() ? heap_ : reinterpret_cast<const T*>(inline_); }
+    T* begin() { return data(); }
+    T* end() { return data() + size_; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size_; }
+    T& operator[](uint32_t i) { return data()[i]; }
+    const T& operator[](uint32_t i) const { return data()[i]; }
+
+    void push_back(const T& value) { insert(size_, value); }
+
+    void insert(uint32_t index, const T& value) {
+        if (size_ == capacity_) {
+            reserve(capacity_ * 2);
+        }
+        T* elements = data();
+        std::memmove(elements + index + 1, elements + index, (size_ - index) * sizeof(T));
+        elements[index] = value;
+        ++size_;
+    }
+
+    void erase(uint32_t index) {
+        T* elements = data();
+        std::memmove(elements + index, elements + index + 1, (size_ - index - 1) * sizeof(T));
+        --size_;
+    }
+
+    void clear() { size_ = 0; }
+
+    // resource == nullptr keeps the resource of the current heap storage
+    void reserve(uint32_t count, std::pmr::memory_resource* resource = nullptr) {
+        if (count <= capacity_) {
+            return;
+        }
+        if (!resource) {
+            resource = IsHeap() ? GetResource() : std::pmr::new_delete_resource();
+        }
+
+        char* block = static_cast<char*>(resource->allocate(HEADER_SIZE + count * sizeof(T), ALIGNMENT));
+        *reinterpret_cast<std::pmr::memory_resource**>(block) = resource;
+        T* grown = reinterpret_cast<T*>(block + HEADER_SIZE);
+        std::memcpy(grown, data(), size_ * sizeof(T));
+        Release();
+        heap_ = grown;
+        capacity_ = count;
+    }
+
+    // Bytes allocated outside the object itself
+    size_t GetHeapBytes() const { return IsHeap() ? HEADER_SIZE + capacity_ * sizeof(T) : 0; }
+
+private:
+    static constexpr size_t ALIGNMENT = alignof(T) > alignof(void*) ? alignof(T) : alignof(void*);
+    static constexpr size_t HEADER_SIZE = ALIGNMENT > sizeof(void*) ? ALIGNMENT : sizeof(void*);
+
+    bool IsHeap() const { return capacity_ > N; }
+    std::pmr::memory_resource* GetResource() const {
+        return *reinterpret_cast<std::pmr::memory_resource* const*>(reinterpret_cast<const char*>(heap_) - HEADER_SIZE);
+    }
+
+    void Release() {
+        if (IsHeap()) {
+            GetResource()->deallocate(reinterpret_cast<char*>(heap_) - HEADER_SIZE, HEADER_SIZE + capacity_ * sizeof(T), ALIGNMENT);
+            capacity_ = N;
+        }
+    }
+
+    void Assign(const SmallVector& other) {
+        reserve(other.size_);
+        std::memcpy(data(), other.data(), other.size_ * sizeof(T));
+        size_ = other.size_;
+    }
+
+    void Steal(SmallVector& other) {
+        if (other.IsHeap()) {
+            heap_ = other.heap_;
+            capacity_ = other.capacity_;
+            other.capacity_ = N;
+        }
+        else {
+            std::memcpy(inline_, other.inline_, other.size_ * sizeof(T));
+            capacity_ = N;
+        }
+        size_ = other.size_;
+        other.size_ = 0;
+    }
+
+    uint32_t size_;
+    uint32_t capacity_;
+    union {
+        alignas(T) unsigned char inline_[N * sizeof(T)];
+        T* heap_;
+    };
+};
@@ -0,0 +1,437 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+    inline float Component(const Float3& v, int axis) {
+        return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+    }
+
+    inline Aabb Union(const Aabb& a, const Aabb& b) {
+        return { { std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z) },
+                 { std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z) } };
+    }
+
+    // Half the surface area, which is all the insertion cost needs
+    inline float HalfArea(const Aabb& box) {
+        float x = box.max.x - box.min.x;
+        float y = box.max.y - box.min.y;
+        float z = box.max.z - box.min.z;
+        return x * y + y * z + z * x;
+    }
+
+    Plane MakePlane(float a, float b, float c, float d) {
+        float length = std::sqrt(a * a + b * b + c * c);
+        if (length > 0.0f) {
+            a /= length;
+            b /= length;
+            c /= length;
+            d /= length;
+        }
+        return { { a, b, c }, d };
+    }
+
+}
+
+Frustum Frustum::FromMatrix(const Float4x4& viewProjection) {
+    // clip = p * M, so each clip coordinate is a column of M
+    const float (*m)[4] = viewProjection.m;
+    auto wPlus = [m](int j, float sign) {
+        return MakePlane(m[0][3] + sign * m[0][j], m[1][3] + sign * m[1][j],
+                         m[2][3] + sign * m[2][j], m[3][3] + sign * m[3][j]);
+    };
+
+    Frustum frustum;
+    frustum.planes[0] = wPlus(0, 1.0f);   // left:   w + x >= 0
+    frustum.planes[1] = wPlus(0, -1.0f);  // right:  w - x >= 0
+    frustum.planes[2] = wPlus(1, 1.0f);   // bottom: w + y >= 0
+    frustum.planes[3] = wPlus(1, -1.0f);  // top:    w - y >= 0
+    frustum.planes[4] = MakePlane(m[0][2], m[1][2], m[2][2], m[3][2]);  // near: z >= 0
+    frustum.planes[5] = wPlus(2, -1.0f);  // far:    w - z >= 0
+    return frustum;
+}
+
+bool Overlaps(const Aabb& a, const Aabb& b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+           a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+bool Contains(const Aabb& outer, const Aabb& inner) {
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+bool OverlapsSphere(const Aabb& box, const Float3& center, float radius) {
+    float dx = std::max(std::max(box.min.x - center.x, 0.0f), center.x - box.max.x);
+    float dy = std::max(std::max(box.min.y - center.y, 0.0f), center.y - box.max.y);
+    float dz = std::max(std::max(box.min.z - center.z, 0.0f), center.z - box.max.z);
+    return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+bool OverlapsFrustum(const Aabb& box, const Frustum& frustum) {
+    // Conservative: a box is only rejected when it lies fully behind one plane
+    for (const Plane& plane : frustum.planes) {
+        float x = plane.normal.x >= 0.0f ? box.max.x : box.min.x;
+        float y = plane.normal.y >= 0.0f ? box.max.y : box.min.y;
+        float z = plane.normal.z >= 0.0f ? box.max.z : box.min.z;
+        if (plane.normal.x * x + plane.normal.y * y + plane.normal.z * z + plane.d < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float IntersectRay(const Aabb& box, const Float3& origin, const Float3& inverseDirection, float maxDistance) {
+    float enter = 0.0f;
+    float exit = maxDistance;
+    for (int axis = 0; axis < 3; ++axis) {
+        float o = Component(origin, axis);
+        float lo = Component(box.min, axis);
+        float hi = Component(box.max, axis);
+        float inverse = Component(inverseDirection, axis);
+        if (std::isinf(inverse)) {
+            // Parallel to this slab
+            if (o < lo || o > hi) {
+                return -1.0f;
+            }
+            continue;
+        }
+
+        float t0 = (lo - o) * inverse;
+        float t1 = (hi - o) * inverse;
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        enter = std::max(enter, t0);
+        exit = std::min(exit, t1);
+        if (enter > exit) {
+            return -1.0f;
+        }
+    }
+    return enter;
+}
+
+AabbTree::AabbTree(float margin) : root_(NULL_NODE), freeList_(NULL_NODE), leafCount_(0), margin_(margin) {}
+
+uint32_t AabbTree::AllocateNode() {
+    uint32_t node;
+    if (freeList_ != NULL_NODE) {
+        node = freeList_;
+        freeList_ = nodes_[node].parent;
+    }
+    else {
+        node = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+        tight_.emplace_back();
+    }
+
+    Node& n = nodes_[node];
+    n.parent = NULL_NODE;
+    n.child1 = NULL_NODE;
+    n.child2 = NULL_NODE;
+    n.height = 0;
+    return node;
+}
+
+void AabbTree::FreeNode(uint32_t node) {
+    nodes_[node].parent = freeList_;
+    nodes_[node].height = -1;
+    freeList_ = node;
+}
+
+uint32_t AabbTree::Insert(const Aabb& bounds, uint32_t userData) {
+    uint32_t leaf = AllocateNode();
+    tight_[leaf] = bounds;
+    nodes_[leaf].bounds = { { bounds.min.x - margin_, bounds.min.y - margin_, bounds.min.z - margin_ },
+                            { bounds.max.x + margin_, bounds.max.y + margin_, bounds.max.z + margin_ } };
+    nodes_[leaf].child2 = userData;
+    InsertLeaf(leaf);
+    ++leafCount_;
+    return leaf;
+}
+
+void AabbTree::Remove(uint32_t leaf) {
+    RemoveLeaf(leaf);
+    FreeNode(leaf);
+    --leafCount_;
+}
+
+bool AabbTree::Update(uint32_t leaf, const Aabb& bounds) {
+    tight_[leaf] = bounds;
+    if (Contains(nodes_[leaf].bounds, bounds)) {
+        return false;
+    }
+
+    RemoveLeaf(leaf);
+    nodes_[leaf].bounds = { { bounds.min.x - margin_, bounds.min.y - margin_, bounds.min.z - margin_ },
+                            { bounds.max.x + margin_, bounds.max.y + margin_, bounds.max.z + margin_ } };
+    InsertLeaf(leaf);
+    return true;
+}
+
+void AabbTree::Clear() {
+    nodes_.clear();
+    tight_.clear();
+    root_ = NULL_NODE;
+    freeList_ = NULL_NODE;
+    leafCount_ = 0;
+}
+
+void AabbTree::InsertLeaf(uint32_t leaf) {
+    if (root_ == NULL_NODE) {
+        root_ = leaf;
+        nodes_[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down towards the sibling with the smallest surface area increase
+    const Aabb leafBounds = nodes_[leaf].bounds;
+    uint32_t index = root_;
+    while (!IsLeaf(index)) {
+        const Node& node = nodes_[index];
+        float area = HalfArea(node.bounds);
+        float combinedArea = HalfArea(Union(node.bounds, leafBounds));
+
+        // Cost of making a new parent for this node and the leaf, and the
+        // minimum cost pushed down to either child
+        float cost = 2.0f * combinedArea;
+        float inheritance = 2.0f * (combinedArea - area);
+
+        float childCost[2];
+        const uint32_t children[2] = { node.child1, node.child2 };
+        for (int c = 0; c < 2; ++c) {
+            const Node& child = nodes_[children[c]];
+            float grown = HalfArea(Union(child.bounds, leafBounds));
+            childCost[c] = (child.child1 == NULL_NODE ? grown : grown - HalfArea(child.bounds)) + inheritance;
+        }
+
+        if (cost < childCost[0] && cost < childCost[1]) {
+            break;
+        }
+        index = childCost[0] < childCost[1] ? children[0] : children[1];
+    }
+
+    uint32_t sibling = index;
+    uint32_t oldParent = nodes_[sibling].parent;
+    uint32_t newParent = AllocateNode();
+    nodes_[newParent].parent = oldParent;
+    nodes_[newParent].bounds = Union(leafBounds, nodes_[sibling].bounds);
+    nodes_[newParent].height = nodes_[sibling].height + 1;
+    nodes_[newParent].child1 = sibling;
+    nodes_[newParent].child2 = leaf;
+
+    if (oldParent == NULL_NODE) {
+        root_ = newParent;
+    }
+    else if (nodes_[oldParent].child1 == sibling) {
+        nodes_[oldParent].child1 = newParent;
+    }
+    else {
+        nodes_[oldParent].child2 = newParent;
+    }
+    nodes_[sibling].parent = newParent;
+    nodes_[leaf].parent = newParent;
+
+    Refit(newParent);
+}
+
+void AabbTree::RemoveLeaf(uint32_t leaf) {
+    if (leaf == root_) {
+        root_ = NULL_NODE;
+        return;
+    }
+
+    uint32_t parent = nodes_[leaf].parent;
+    uint32_t grandParent = nodes_[parent].parent;
+    uint32_t sibling = nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1;
+
+    FreeNode(parent);
+    nodes_[sibling].parent = grandParent;
+    if (grandParent == NULL_NODE) {
+        root_ = sibling;
+        return;
+    }
+
+    if (nodes_[grandParent].child1 == parent) {
+        nodes_[grandParent].child1 = sibling;
+    }
+    else {
+        nodes_[grandParent].child2 = sibling;
+    }
+    Refit(grandParent);
+}
+
+void AabbTree::Refit(uint32_t node) {
+    while (node != NULL_NODE) {
+        node = Balance(node);
+
+        Node& n = nodes_[node];
+        const Node& child1 = nodes_[n.child1];
+        const Node& child2 = nodes_[n.child2];
+        n.height = 1 + std::max(child1.height, child2.height);
+        n.bounds = Union(child1.bounds, child2.bounds);
+        node = n.parent;
+    }
+}
+
+// Rotates the taller child of a up when the children's heights differ by
+// more than one. Returns the node now at a's position.
+uint32_t AabbTree::Balance(uint32_t a) {
+    Node& A = nodes_[a];
+    if (A.child1 == NULL_NODE || A.height < 2) {
+        return a;
+    }
+
+    uint32_t b = A.child1;
+    uint32_t c = A.child2;
+    Node& B = nodes_[b];
+    Node& C = nodes_[c];
+    int32_t balance = C.height - B.height;
+    if (balance >= -1 && balance <= 1) {
+        return a;
+    }
+
+    // The taller child takes a's place; a keeps its other child and the
+    // shorter grandchild
+    const bool rightTaller = balance > 1;
+    uint32_t up = rightTaller ? c : b;
+    Node& Up = nodes_[up];
+    Node& Other = rightTaller ? B : C;
+    uint32_t f = Up.child1;
+    uint32_t g = Up.child2;
+    Node& F = nodes_[f];
+    Node& G = nodes_[g];
+
+    Up.child1 = a;
+    Up.parent = A.parent;
+    A.parent = up;
+    if (Up.parent == NULL_NODE) {
+        root_ = up;
+    }
+    else if (nodes_[Up.parent].child1 == a) {
+        nodes_[Up.parent].child1 = up;
+    }
+    else {
+        nodes_[Up.parent].child2 = up;
+    }
+
+    uint32_t keep = F.height > G.height ? f : g;
+    uint32_t moved = keep == f ? g : f;
+    Up.child2 = keep;
+    if (rightTaller) {
+        A.child2 = moved;
+    }
+    else {
+        A.child1 = moved;
+    }
+    nodes_[moved].parent = a;
+
+    A.bounds = Union(Other.bounds, nodes_[moved].bounds);
+    A.height = 1 + std::max(Other.height, nodes_[moved].height);
+    Up.bounds = Union(A.bounds, nodes_[keep].bounds);
+    Up.height = 1 + std::max(A.height, nodes_[keep].height);
+    return up;
+}
+
+void AabbTree::Build(const Aabb* bounds, const uint32_t* userData, size_t count, uint32_t* leaves) {
+    Clear();
+    if (count == 0) {
+        return;
+    }
+
+    nodes_.reserve(2 * count - 1);
+    tight_.reserve(2 * count - 1);
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t leaf = AllocateNode();
+        tight_[leaf] = bounds[i];
+        nodes_[leaf].bounds = { { bounds[i].min.x - margin_, bounds[i].min.y - margin_, bounds[i].min.z - margin_ },
+                                { bounds[i].max.x + margin_, bounds[i].max.y + margin_, bounds[i].max.z + margin_ } };
+        nodes_[leaf].child2 = userData[i];
+        leaves[i] = leaf;
+        order[i] = leaf;
+    }
+
+    root_ = BuildRange(order.data(), count);
+    nodes_[root_].parent = NULL_NODE;
+    leafCount_ = count;
+}
+
+uint32_t AabbTree::BuildRange(uint32_t* leaves, size_t count) {
+    if (count == 1) {
+        return leaves[0];
+    }
+
+    // Split at the median centre along the axis the centres spread most on;
+    // centres are compared doubled to save the halving
+    float lo[3] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    float hi[3] = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+    for (size_t i = 0; i < count; ++i) {
+        const Aabb& box = nodes_[leaves[i]].bounds;
+        for (int axis = 0; axis < 3; ++axis) {
+            float centre = Component(box.min, axis) + Component(box.max, axis);
+            lo[axis] = std::min(lo[axis], centre);
+            hi[axis] = std::max(hi[axis], centre);
+        }
+    }
+    int axis = 0;
+    if (hi[1] - lo[1] > hi[axis] - lo[axis]) axis = 1;
+    if (hi[2] - lo[2] > hi[axis] - lo[axis]) axis = 2;
+
+    size_t half = count / 2;
+    std::nth_element(leaves, leaves + half, leaves + count, [this, axis](uint32_t l, uint32_t r) {
+        const Aabb& a = nodes_[l].bounds;
+        const Aabb& b = nodes_[r].bounds;
+        return Component(a.min, axis) + Component(a.max, axis) < Component(b.min, axis) + Component(b.max, axis);
+    });
+
+    uint32_t child1 = BuildRange(leaves, half);
+    uint32_t child2 = BuildRange(leaves + half, count - half);
+    uint32_t node = AllocateNode();
+    Node& n = nodes_[node];
+    n.child1 = child1;
+    n.child2 = child2;
+    n.bounds = Union(nodes_[child1].bounds, nodes_[child2].bounds);
+    n.height = 1 + std::max(nodes_[child1].height, nodes_[child2].height);
+    nodes_[child1].parent = node;
+    nodes_[child2].parent = node;
+    return node;
+}
+
+uint32_t AabbTree::RaycastNearest(const Float3& origin, const Float3& direction, float maxDistance, float& distance) const {
+    uint32_t nearest = NULL_NODE;
+    if (root_ == NULL_NODE) {
+        return nearest;
+    }
+
+    const Float3 inverse = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+    float best = maxDistance;
+
+    SmallVector<uint32_t, 64> stack;
+    stack.push_back(root_);
+    while (!stack.empty()) {
+        uint32_t node = stack[stack.size() - 1];
+        stack.erase(stack.size() - 1);
+
+        const Node& current = nodes_[node];
+        if (current.child1 == NULL_NODE) {
+            float hit = IntersectRay(tight_[node], origin, inverse, best);
+            if (hit >= 0.0f && (nearest == NULL_NODE || hit < best)) {
+                best = hit;
+                nearest = node;
+            }
+        }
+        else if (IntersectRay(current.bounds, origin, inverse, best) >= 0.0f) {
+            stack.push_back(current.child1);
+            stack.push_back(current.child2);
+        }
+    }
+
+    if (nearest != NULL_NODE) {
+        distance = best;
+    }
+    return nearest;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "SmallVector.h"
+#include "TransformStore.h"
+#include <cstdint>
+#include <vector>
+
+// Dynamic AABB tree
+//
+// Leaves hold a tight box and a fat box grown by a margin; a leaf only moves
+// in the tree when its tight box leaves the fat one, so small edits cost a
+// couple of comparisons. Inner nodes bound the fat boxes of their children
+// and are kept balanced with rotations on insert and remove.
+
+struct Aabb {
+    Float3 min;
+    Float3 max;
+};
+
+// Points p with dot(normal, p) + d >= 0 are inside
+struct Plane {
+    Float3 normal;
+    float d;
+};
+
+struct Frustum {
+    Plane planes[6];
+
+    // Planes of a row-vector view-projection matrix (XMFLOAT4X4 layout,
+    // Direct3D depth range)
+    static Frustum FromMatrix(const Float4x4& viewProjection);
+};
+
+bool Overlaps(const Aabb& a, const Aabb& b);
+bool Contains(const Aabb& outer, const Aabb& inner);
+bool OverlapsSphere(const Aabb& box, const Float3& center, float radius);
+bool OverlapsFrustum(const Aabb& box, const Frustum& frustum);
+// Distance along direction to where the ray enters box, or a negative value on a miss
+float IntersectRay(const Aabb& box, const Float3& origin, const Float3& inverseDirection, float maxDistance);
+
+class AabbTree {
+public:
+    static const uint32_t NULL_NODE = 0xFFFFFFFF;
+
+    explicit AabbTree(float margin = 0.1f);
+
+    uint32_t Insert(const Aabb& bounds, uint32_t userData);
+    void Remove(uint32_t leaf);
+    // Returns true when the leaf had to be reinserted
+    bool Update(uint32_t leaf, const Aabb& bounds);
+    // Replaces the tree with a balanced one over count boxes (median splits
+    // on the longest axis). leaves[i] receives the leaf of bounds[i].
+    void Build(const Aabb* bounds, const uint32_t* userData, size_t count, uint32_t* leaves);
+    void Clear();
+
+    uint32_t GetUserData(uint32_t leaf) const { return nodes_[leaf].child2; }
+    const Aabb& GetBounds(uint32_t leaf) const { return tight_[leaf]; }
+    size_t GetLeafCount() const { return leafCount_; }
+    int GetHeight() const { return root_ == NULL_NODE ? 0 : nodes_[root_].height; }
+    size_t GetMemoryUsage() const { return nodes_.capacity() * sizeof(Node) + tight_.capacity() * sizeof(Aabb); }
+
+    // Calls visit(userData) for every leaf whose tight box passes test(const Aabb&).
+    // Subtrees whose bounds fail test are skipped.
+    template <typename Test, typename Visitor>
+    void Query(Test test, Visitor visit) const;
+
+    // Nearest leaf whose tight box the ray enters within maxDistance, or NULL_NODE
+    uint32_t RaycastNearest(const Float3& origin, const Float3& direction, float maxDistance, float& distance) const;
+
+private:
+    struct Node {
+        Aabb bounds;      // fat box for leaves
+        uint32_t parent;  // next free node while on the free list
+        uint32_t child1;  // NULL_NODE for leaves
+        uint32_t child2;  // user data for leaves
+        int32_t height;   // 0 for leaves
+    };
+
+    bool IsLeaf(uint32_t node) const { return nodes_[node].child1 == NULL_NODE; }
+    uint32_t AllocateNode();
+    void FreeNode(uint32_t node);
+    void InsertLeaf(uint32_t leaf);
+    void RemoveLeaf(uint32_t leaf);
+    uint32_t Balance(uint32_t node);
+    void Refit(uint32_t node);
+    uint32_t BuildRange(uint32_t* leaves, size_t count);
+
+    std::vector<Node> nodes_;
+    std::vector<Aabb> tight_;  // per node, meaningful for leaves
+    uint32_t root_;
+    uint32_t freeList_;
+    size_t leafCount_;
+    float margin_;
+};
+
+template <typename Test, typename Visitor>
+void AabbTree::Query(Test test, Visitor visit) const {
+    if (root_ == NULL_NODE) {
+        return;
+    }
+
+    SmallVector<uint32_t, 64> stack;
+    stack.push_back(root_);
+    while (!stack.empty()) {
+        uint32_t node = stack[stack.size() - 1];
+        stack.erase(stack.size() - 1);
+
+        const Node& current = nodes_[node];
+        if (current.child1 == NULL_NODE) {
+            if (test(tight_[node])) {
+                visit(current.child2);
+            }
+        }
+        else if (test(current.bounds)) {
+            stack.push_back(current.child1);
+            stack.push_back(current.child2);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#include "StringPool.h"
+#include <cstring>
+
+StringPool::StringPool() : blockBytes_(0), blockUsed_(0), blockCapacity_(0) {
+}
+
+StringPool::~StringPool() {
+}
+
+uint32_t StringPool::Intern(std::string_view text) {
+    auto it = index_.find(text);
+    if (it != index_.end()) {
+        return it->second;
+    }
+
+    char* storage = Allocate(text.size());
+    if (!text.empty()) {
+        std::memcpy(storage, text.data(), text.size());
+    }
+
+    std::string_view stored(storage, text.size());
+    uint32_t id = static_cast<uint32_t>(strings_.size());
+    strings_.push_back(stored);
+    index_.emplace(stored, id);
+    return id;
+}
+
+uint32_t StringPool::Find(std::string_view text) const {
+    auto it = index_.find(text);
+    return it != index_.end() ? it->second : INVALID_ID;
+}
+
+char* StringPool::Allocate(size_t size) {
+    if (blocks_.empty() || blockUsed_ + size > blockCapacity_) {
+        // Oversized strings get a block of their own
+        size_t capacity = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+        blocks_.push_back(std::make_unique<char[]>(capacity));
+        blockBytes_ += capacity;
+        blockUsed_ = 0;
+        blockCapacity_ = capacity;
+    }
+
+    char* storage = blocks_.back().get() + blockUsed_;
+    blockUsed_ += size;
+    return storage;
+}
+
+size_t StringPool::GetMemoryUsage() const {
+    // Hash nodes hold the key/value pair plus the next/previous links
+    size_t nodeSize = sizeof(std::pair<const std::string_view, uint32_t>) + 2 * sizeof(void*);
+    return blockBytes_
+        + blocks_.capacity() * sizeof(std::unique_ptr<char[]>)
+        + strings_.capacity() * sizeof(std::string_view)
+        + index_.bucket_count() * sizeof(void*)
+        + index_.size() * nodeSize;
+}
+
+void StringPool::Clear() {
+    // Assigning empty containers frees the tables too; clear() keeps them
+    index_ = std::unordered_map<std::string_view, uint32_t>();
+    strings_ = std::vector<std::string_view>();
+    blocks_ = std::vector<std::unique_ptr<char[]>>();
+    blockBytes_ = 0;
+    blockUsed_ = 0;
+    blockCapacity_ = 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Interns strings and hands out 32-bit ids. Characters live in large blocks
+// that never move, so views returned by Get() stay valid until Clear().
+// Strings are never removed one at a time: a pool holds every distinct
+// string interned since it was created or cleared, and Clear gives all of
+// its memory back. Not thread-safe.
+class StringPool {
+public:
+    static constexpr uint32_t INVALID_ID = 0xFFFFFFFF;
+
+    StringPool();
+    ~StringPool();
+
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    // Returns the id of text, adding it if it is not in the pool yet
+    uint32_t Intern(std::string_view text);
+    // Returns INVALID_ID when text has never been interned
+    uint32_t Find(std::string_view text) const;
+    std::string_view Get(uint32_t id) const { return strings_[id]; }
+
+    size_t GetCount() const { return strings_.size(); }
+    // Block, table and index bytes; allocator overhead is not included
+    size_t GetMemoryUsage() const;
+    void Clear();
+
+private:
+    static const size_t BLOCK_SIZE = 16 * 1024;
+
+    char* Allocate(size_t size);
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t blockBytes_;
+    size_t blockUsed_;
+    size_t blockCapacity_;
+    std::vector<std::string_view> strings_;
+    std::unordered_map<std::string_view, uint32_t> index_;
+};
@@ -0,0 +1,75 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threadCount) : stopping_(false) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+
+    workers_.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::future<void> ThreadPool::Submit(std::function<void()> task) {
+    std::packaged_task<void()> packaged(std::move(task));
+    std::future<void> result = packaged.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(packaged));
+    }
+    condition_.notify_one();
+    return result;
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body) {
+    std::vector<std::future<void>> pending;
+    pending.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        pending.push_back(Submit([&body, i]() { body(i); }));
+    }
+
+    // get() rethrows the first exception raised by a task
+    for (auto& task : pending) {
+        task.wait();
+    }
+    for (auto& task : pending) {
+        task.get();
+    }
+}
+
+ThreadPool& ThreadPool::GetShared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::WorkerLoop() {
+    for (;;) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if (stopping_ && tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
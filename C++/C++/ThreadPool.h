@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads fed from a shared FIFO queue
+class ThreadPool {
+public:
+    // threadCount == 0 uses one worker per hardware thread
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::future<void> Submit(std::function<void()> task);
+
+    // Runs body(i) for every i in [0, count) and waits for all of them.
+    // Must not be called from one of this pool's own workers.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    unsigned GetThreadCount() const { return static_cast<unsigned>(workers_.size()); }
+
+    // Process-wide pool shared by loaders and the compiler
+    static ThreadPool& GetShared();
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::packaged_task<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stopping_;
+};
@@ -0,0 +1,355 @@
+#include "TransformStore.h"
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+namespace {
+
+    // sin and cos of four angles at once: reduce to [-pi, pi], fold into
+    // [-pi/2, pi/2] and evaluate Taylor polynomials (error below 5e-7)
+    inline void SinCos4(__m128 x, __m128& sinOut, __m128& cosOut) {
+        const __m128 twoPi = _mm_set1_ps(6.283185307f);
+        const __m128 invTwoPi = _mm_set1_ps(0.1591549431f);
+        const __m128 pi = _mm_set1_ps(3.141592654f);
+        const __m128 halfPi = _mm_set1_ps(1.570796327f);
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+
+        __m128 quotient = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, invTwoPi)));
+        x = _mm_sub_ps(x, _mm_mul_ps(quotient, twoPi));
+
+        // sin(pi - x) = sin(x), cos(pi - x) = -cos(x)
+        __m128 sign = _mm_and_ps(x, signMask);
+        __m128 reflected = _mm_sub_ps(_mm_or_ps(pi, sign), x);
+        __m128 fold = _mm_cmpgt_ps(_mm_andnot_ps(signMask, x), halfPi);
+        x = _mm_or_ps(_mm_and_ps(fold, reflected), _mm_andnot_ps(fold, x));
+        __m128 cosSign = _mm_or_ps(_mm_and_ps(fold, signMask), one);
+
+        __m128 x2 = _mm_mul_ps(x, x);
+
+        __m128 s = _mm_set1_ps(-2.5052108e-8f);
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(2.7557319e-6f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-1.9841270e-4f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(8.3333333e-3f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-1.6666667e-1f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), one);
+        sinOut = _mm_mul_ps(s, x);
+
+        __m128 c = _mm_set1_ps(-2.7557319e-7f);
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(2.4801587e-5f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-1.3888889e-3f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(4.1666667e-2f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(-0.5f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), one);
+        cosOut = _mm_mul_ps(c, cosSign);
+    }
+
+    // Rotation rows of four objects, one lane per object
+    struct Rotation4 {
+        __m128 r[3][3];
+    };
+
+    inline Rotation4 RollPitchYaw4(__m128 pitch, __m128 yaw, __m128 roll) {
+        __m128 sp, cp, sy, cy, sr, cr;
+        SinCos4(pitch, sp, cp);
+        SinCos4(yaw, sy, cy);
+        SinCos4(roll, sr, cr);
+
+        Rotation4 rot;
+        __m128 srsp = _mm_mul_ps(sr, sp);
+        __m128 crsp = _mm_mul_ps(cr, sp);
+        rot.r[0][0] = _mm_add_ps(_mm_mul_ps(cr, cy), _mm_mul_ps(srsp, sy));
+        rot.r[0][1] = _mm_mul_ps(sr, cp);
+        rot.r[0][2] = _mm_sub_ps(_mm_mul_ps(srsp, cy), _mm_mul_ps(cr, sy));
+        rot.r[1][0] = _mm_sub_ps(_mm_mul_ps(crsp, sy), _mm_mul_ps(sr, cy));
+        rot.r[1][1] = _mm_mul_ps(cr, cp);
+        rot.r[1][2] = _mm_add_ps(_mm_mul_ps(sr, sy), _mm_mul_ps(crsp, cy));
+        rot.r[2][0] = _mm_mul_ps(cp, sy);
+        rot.r[2][1] = _mm_sub_ps(_mm_setzero_ps(), sp);
+        rot.r[2][2] = _mm_mul_ps(cp, cy);
+        return rot;
+    }
+
+    void RollPitchYaw(float pitch, float yaw, float roll, float r[3][3]) {
+        float sp = std::sin(pitch), cp = std::cos(pitch);
+        float sy = std::sin(yaw), cy = std::cos(yaw);
+        float sr = std::sin(roll), cr = std::cos(roll);
+
+        r[0][0] = cr * cy + sr * sp * sy;
+        r[0][1] = sr * cp;
+        r[0][2] = sr * sp * cy - cr * sy;
+        r[1][0] = cr * sp * sy - sr * cy;
+        r[1][1] = cr * cp;
+        r[1][2] = sr * sy + cr * sp * cy;
+        r[2][0] = cp * sy;
+        r[2][1] = -sp;
+        r[2][2] = cp * cy;
+    }
+
+    inline __m128 Abs4(__m128 v) {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+    }
+
+    inline float HorizontalMin(__m128 v) {
+        v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(v);
+    }
+
+    inline float HorizontalMax(__m128 v) {
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(v);
+    }
+
+}
+
+uint32_t TransformStore::Add(const Transform& transform) {
+    uint32_t row = static_cast<uint32_t>(Size());
+    const Float3* parts[3] = { &transform.position, &transform.rotation, &transform.scale };
+    for (int part = 0; part < 3; ++part) {
+        data_[part * 3 + 0].push_back(parts[part]->x);
+        data_[part * 3 + 1].push_back(parts[part]->y);
+        data_[part * 3 + 2].push_back(parts[part]->z);
+    }
+    return row;
+}
+
+void TransformStore::SwapRemove(uint32_t row) {
+    for (auto& component : data_) {
+        component[row] = component.back();
+        component.pop_back();
+    }
+}
+
+void TransformStore::Reserve(size_t count) {
+    for (auto& component : data_) {
+        component.reserve(count);
+    }
+}
+
+void TransformStore::Clear() {
+    for (auto& component : data_) {
+        component.clear();
+    }
+}
+
+void TransformStore::TranslateRange(size_t begin, size_t end, float dx, float dy, float dz) {
+    float* x = data_[PositionX].data();
+    float* y = data_[PositionY].data();
+    float* z = data_[PositionZ].data();
+    size_t i = begin;
+
+#if defined(__AVX__)
+    const __m256 dx8 = _mm256_set1_ps(dx);
+    const __m256 dy8 = _mm256_set1_ps(dy);
+    const __m256 dz8 = _mm256_set1_ps(dz);
+    for (; i + 8 <= end; i += 8) {
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), dx8));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), dy8));
+        _mm256_storeu_ps(z + i, _mm256_add_ps(_mm256_loadu_ps(z + i), dz8));
+    }
+#endif
+
+    const __m128 dx4 = _mm_set1_ps(dx);
+    const __m128 dy4 = _mm_set1_ps(dy);
+    const __m128 dz4 = _mm_set1_ps(dz);
+    for (; i + 4 <= end; i += 4) {
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), dx4));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), dy4));
+        _mm_storeu_ps(z + i, _mm_add_ps(_mm_loadu_ps(z + i), dz4));
+    }
+
+    for (; i < end; ++i) {
+        x[i] += dx;
+        y[i] += dy;
+        z[i] += dz;
+    }
+}
+
+void TransformStore::Translate(const uint32_t* rows, size_t count, float dx, float dy, float dz) {
+    // Sort the selection so consecutive rows can go through the vector path
+    std::vector<uint32_t> sorted(rows, rows + count);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    size_t runStart = 0;
+    for (size_t i = 1; i <= sorted.size(); ++i) {
+        if (i < sorted.size() && sorted[i] == sorted[i - 1] + 1) {
+            continue;
+        }
+        TranslateRange(sorted[runStart], static_cast<size_t>(sorted[i - 1]) + 1, dx, dy, dz);
+        runStart = i;
+    }
+}
+
+void TransformStore::TranslateAll(float dx, float dy, float dz) {
+    TranslateRange(0, Size(), dx, dy, dz);
+}
+
+void TransformStore::ComputeWorldMatrices(Float4x4* out) const {
+    const size_t count = Size();
+    const float* c[ComponentCount];
+    for (int i = 0; i < ComponentCount; ++i) {
+        c[i] = data_[i].data();
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        Rotation4 rot = RollPitchYaw4(_mm_load_ps(c[RotationX] + i), _mm_load_ps(c[RotationY] + i), _mm_load_ps(c[RotationZ] + i));
+        __m128 scale[3] = { _mm_load_ps(c[ScaleX] + i), _mm_load_ps(c[ScaleY] + i), _mm_load_ps(c[ScaleZ] + i) };
+
+        // World = Scale * Rotation * Translation; transpose each row from SoA lanes to per-object rows
+        for (int row = 0; row < 3; ++row) {
+            __m128 a = _mm_mul_ps(rot.r[row][0], scale[row]);
+            __m128 b = _mm_mul_ps(rot.r[row][1], scale[row]);
+            __m128 d = _mm_mul_ps(rot.r[row][2], scale[row]);
+            __m128 w = _mm_setzero_ps();
+            _MM_TRANSPOSE4_PS(a, b, d, w);
+            _mm_storeu_ps(out[i + 0].m[row], a);
+            _mm_storeu_ps(out[i + 1].m[row], b);
+            _mm_storeu_ps(out[i + 2].m[row], d);
+            _mm_storeu_ps(out[i + 3].m[row], w);
+        }
+
+        __m128 tx = _mm_load_ps(c[PositionX] + i);
+        __m128 ty = _mm_load_ps(c[PositionY] + i);
+        __m128 tz = _mm_load_ps(c[PositionZ] + i);
+        __m128 tw = _mm_set1_ps(1.0f);
+        _MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+        _mm_storeu_ps(out[i + 0].m[3], tx);
+        _mm_storeu_ps(out[i + 1].m[3], ty);
+        _mm_storeu_ps(out[i + 2].m[3], tz);
+        _mm_storeu_ps(out[i + 3].m[3], tw);
+    }
+
+    for (; i < count; ++i) {
+        float r[3][3];
+        RollPitchYaw(c[RotationX][i], c[RotationY][i], c[RotationZ][i], r);
+        const float scale[3] = { c[ScaleX][i], c[ScaleY][i], c[ScaleZ][i] };
+
+        Float4x4& m = out[i];
+        for (int row = 0; row < 3; ++row) {
+            m.m[row][0] = r[row][0] * scale[row];
+            m.m[row][1] = r[row][1] * scale[row];
+            m.m[row][2] = r[row][2] * scale[row];
+            m.m[row][3] = 0.0f;
+        }
+        m.m[3][0] = c[PositionX][i];
+        m.m[3][1] = c[PositionY][i];
+        m.m[3][2] = c[PositionZ][i];
+        m.m[3][3] = 1.0f;
+    }
+}
+
+bool TransformStore::ComputeBounds(Float3& minBounds, Float3& maxBounds) const {
+    const size_t count = Size();
+    if (count == 0) {
+        return false;
+    }
+
+    const float* c[ComponentCount];
+    for (int i = 0; i < ComponentCount; ++i) {
+        c[i] = data_[i].data();
+    }
+
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128 minV[3], maxV[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        minV[axis] = _mm_set1_ps(INFINITY);
+        maxV[axis] = _mm_set1_ps(-INFINITY);
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        Rotation4 rot = RollPitchYaw4(_mm_load_ps(c[RotationX] + i), _mm_load_ps(c[RotationY] + i), _mm_load_ps(c[RotationZ] + i));
+        __m128 scale[3] = { _mm_load_ps(c[ScaleX] + i), _mm_load_ps(c[ScaleY] + i), _mm_load_ps(c[ScaleZ] + i) };
+
+        // Half extent of the transformed unit cube along each world axis
+        for (int axis = 0; axis < 3; ++axis) {
+            __m128 extent = Abs4(_mm_mul_ps(rot.r[0][axis], scale[0]));
+            extent = _mm_add_ps(extent, Abs4(_mm_mul_ps(rot.r[1][axis], scale[1])));
+            extent = _mm_add_ps(extent, Abs4(_mm_mul_ps(rot.r[2][axis], scale[2])));
+            extent = _mm_mul_ps(extent, half);
+
+            __m128 centre = _mm_load_ps(c[PositionX + axis] + i);
+            minV[axis] = _mm_min_ps(minV[axis], _mm_sub_ps(centre, extent));
+            maxV[axis] = _mm_max_ps(maxV[axis], _mm_add_ps(centre, extent));
+        }
+    }
+
+    float lo[3], hi[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        lo[axis] = HorizontalMin(minV[axis]);
+        hi[axis] = HorizontalMax(maxV[axis]);
+    }
+
+    for (; i < count; ++i) {
+        float r[3][3];
+        RollPitchYaw(c[RotationX][i], c[RotationY][i], c[RotationZ][i], r);
+        const float scale[3] = { c[ScaleX][i], c[ScaleY][i], c[ScaleZ][i] };
+
+        for (int axis = 0; axis < 3; ++axis) {
+            float extent = 0.5f * (std::fabs(r[0][axis] * scale[0]) + std::fabs(r[1][axis] * scale[1]) + std::fabs(r[2][axis] * scale[2]));
+            float centre = c[PositionX + axis][i];
+            lo[axis] = (std::min)(lo[axis], centre - extent);
+            hi[axis] = (std::max)(hi[axis], centre + extent);
+        }
+    }
+
+    minBounds = { lo[0], lo[1], lo[2] };
+    maxBounds = { hi[0], hi[1], hi[2] };
+    return true;
+}
+
+void TransformStore::ComputeObjectBounds(Float3* minBounds, Float3* maxBounds) const {
+    const size_t count = Size();
+    const float* c[ComponentCount];
+    for (int i = 0; i < ComponentCount; ++i) {
+        c[i] = data_[i].data();
+    }
+
+    const __m128 half = _mm_set1_ps(0.5f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        Rotation4 rot = RollPitchYaw4(_mm_load_ps(c[RotationX] + i), _mm_load_ps(c[RotationY] + i), _mm_load_ps(c[RotationZ] + i));
+        __m128 scale[3] = { _mm_load_ps(c[ScaleX] + i), _mm_load_ps(c[ScaleY] + i), _mm_load_ps(c[ScaleZ] + i) };
+
+        alignas(16) float lo[3][4];
+        alignas(16) float hi[3][4];
+        for (int axis = 0; axis < 3; ++axis) {
+            __m128 extent = Abs4(_mm_mul_ps(rot.r[0][axis], scale[0]));
+            extent = _mm_add_ps(extent, Abs4(_mm_mul_ps(rot.r[1][axis], scale[1])));
+            extent = _mm_add_ps(extent, Abs4(_mm_mul_ps(rot.r[2][axis], scale[2])));
+            extent = _mm_mul_ps(extent, half);
+
+            __m128 centre = _mm_load_ps(c[PositionX + axis] + i);
+            _mm_store_ps(lo[axis], _mm_sub_ps(centre, extent));
+            _mm_store_ps(hi[axis], _mm_add_ps(centre, extent));
+        }
+        for (int lane = 0; lane < 4; ++lane) {
+            minBounds[i + lane] = { lo[0][lane], lo[1][lane], lo[2][lane] };
+            maxBounds[i + lane] = { hi[0][lane], hi[1][lane], hi[2][lane] };
+        }
+    }
+
+    for (; i < count; ++i) {
+        ComputeObjectBounds(static_cast<uint32_t>(i), minBounds[i], maxBounds[i]);
+    }
+}
+
+void TransformStore::ComputeObjectBounds(uint32_t row, Float3& minBounds, Float3& maxBounds) const {
+    float r[3][3];
+    RollPitchYaw(data_[RotationX][row], data_[RotationY][row], data_[RotationZ][row], r);
+    const float scale[3] = { data_[ScaleX][row], data_[ScaleY][row], data_[ScaleZ][row] };
+
+    float lo[3], hi[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        float extent = 0.5f * (std::fabs(r[0][axis] * scale[0]) + std::fabs(r[1][axis] * scale[1]) + std::fabs(r[2][axis] * scale[2]));
+        float centre = data_[PositionX + axis][row];
+        lo[axis] = centre - extent;
+        hi[axis] = centre + extent;
+    }
+    minBounds = { lo[0], lo[1], lo[2] };
+    maxBounds = { hi[0], hi[1], hi[2] };
+}
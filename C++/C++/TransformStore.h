@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+struct Float3 {
+    float x;
+    float y;
+    float z;
+
+    float operator[](size_t i) const { return i == 0 ? x : (i == 1 ? y : z); }
+};
+
+// Row-major 4x4 matrix (row vectors, same layout as XMFLOAT4X4)
+struct Float4x4 {
+    float m[4][4];
+};
+
+struct Transform {
+    Float3 position = { 0.0f, 0.0f, 0.0f };
+    Float3 rotation = { 0.0f, 0.0f, 0.0f };
+    Float3 scale = { 1.0f, 1.0f, 1.0f };
+};
+
+// Allocator handing out 32-byte aligned blocks so AVX loads never split
+template <typename T>
+struct AlignedAllocator {
+    typedef T value_type;
+    static const size_t ALIGNMENT = 32;
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        void* memory = ::operator new(count * sizeof(T), std::align_val_t(ALIGNMENT));
+        return static_cast<T*>(memory);
+    }
+    void deallocate(T* memory, size_t) {
+        ::operator delete(memory, std::align_val_t(ALIGNMENT));
+    }
+
+    template <typename U> bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+// Structure-of-arrays transform storage. Row i holds the transform of the
+// i-th object in LevelData::GetObjects(); rows move together with objects.
+//
+// Rotations are Euler angles in radians applied roll (z), pitch (x), yaw (y),
+// matching XMMatrixRotationRollPitchYaw. Object bounds are the unit cube
+// centred on the object, transformed by its world matrix.
+class TransformStore {
+public:
+    enum Component {
+        PositionX, PositionY, PositionZ,
+        RotationX, RotationY, RotationZ,
+        ScaleX, ScaleY, ScaleZ,
+        ComponentCount
+    };
+
+    uint32_t Add(const Transform& transform);
+    void SwapRemove(uint32_t row);
+    void Reserve(size_t count);
+    void Clear();
+    size_t Size() const { return data_[0].size(); }
+
+    Float3 GetPosition(uint32_t row) const { return Get(row, PositionX); }
+    Float3 GetRotation(uint32_t row) const { return Get(row, RotationX); }
+    Float3 GetScale(uint32_t row) const { return Get(row, ScaleX); }
+    void SetPosition(uint32_t row, float x, float y, float z) { Set(row, PositionX, x, y, z); }
+    void SetRotation(uint32_t row, float x, float y, float z) { Set(row, RotationX, x, y, z); }
+    void SetScale(uint32_t row, float x, float y, float z) { Set(row, ScaleX, x, y, z); }
+
+    const float* GetComponent(Component component) const { return data_[component].data(); }
+
+    // Batch kernels (SSE, with AVX paths where the compiler targets it)
+    void Translate(const uint32_t* rows, size_t count, float dx, float dy, float dz);
+    void TranslateAll(float dx, float dy, float dz);
+    void ComputeWorldMatrices(Float4x4* out) const;
+    bool ComputeBounds(Float3& minBounds, Float3& maxBounds) const;
+    // Bounds of each row (arrays of Size() entries) or of a single row
+    void ComputeObjectBounds(Float3* minBounds, Float3* maxBounds) const;
+    void ComputeObjectBounds(uint32_t row, Float3& minBounds, Float3& maxBounds) const;
+
+private:
+    Float3 Get(uint32_t row, Component first) const {
+        return { data_[first][row], data_[first + 1][row], data_[first + 2][row] };
+    }
+    void Set(uint32_t row, Component first, float x, float y, float z) {
+        data_[first][row] = x;
+        data_[first + 1][row] = y;
+        data_[first + 2][row] = z;
+    }
+
+    void TranslateRange(size_t begin, size_t end, float dx, float dy, float dz);
+
+    std::vector<float, AlignedAllocator<float>> data_[ComponentCount];
+};
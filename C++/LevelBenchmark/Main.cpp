@@ -0,0 +1,834 @@
+#include "LevelEditor.h"
+#include "LevelBinary.h"
+#include "LevelCompression.h"
+#include "LevelGenerator.h"
+#include "LevelJournal.h"
+#include "LevelNumbers.h"
+#include "LevelStreaming.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <psapi.h>
+
+#pragma comment(lib, "psapi.lib")
+
+// Every heap allocation in the process goes through here so loads can report
+// how many they made, and the suite how much memory each phase peaked at
+static std::atomic<size_t> g_heapAllocations(0);
+static std::atomic<size_t> g_heapBytes(0);
+static std::atomic<size_t> g_peakHeapBytes(0);
+
+void* operator new(size_t size) {
+    ++g_heapAllocations;
+    if (void* memory = std::malloc(size ? size : 1)) {
+        size_t bytes = g_heapBytes += _msize(memory);
+        size_t peak = g_peakHeapBytes.load();
+        while (bytes > peak && !g_peakHeapBytes.compare_exchange_weak(peak, bytes)) {
+        }
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    if (memory) {
+        g_heapBytes -= _msize(memory);
+    }
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+// Times LevelData::LoadFromFile over a level in both formats, reports
+// property memory use and heap allocations, compares full saves with
+// journaled ones, measures undo snapshots, content hashing, float text,
+// block compression, streaming and spatial queries. With --suite it instead
+// times every stage on generated levels of several sizes (LevelGenerator.h).
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    double TimeLoad(const fs::path& path, int iterations, size_t& objectCount) {
+        double totalMs = 0.0;
+        for (int i = 0; i < iterations; ++i) {
+            LevelData level;
+            auto start = Clock::now();
+            if (!level.LoadFromFile(path)) {
+                return -1.0;
+            }
+            totalMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            objectCount = level.GetObjects().size();
+        }
+        return totalMs / iterations;
+    }
+
+    double TimeSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Heap allocations and arena use of a serial and a parallel text load, and
+    // the cost of clearing the result
+    int RunAllocationBenchmark(const fs::path& textPath) {
+        LevelData level;
+        size_t before = g_heapAllocations;
+        auto start = Clock::now();
+        if (!level.LoadFromFile(textPath)) {
+            std::cerr << "Failed to load " << textPath << "\n";
+            return 1;
+        }
+        double serialMs = TimeSince(start);
+        size_t serialAllocations = g_heapAllocations - before;
+
+        const LevelArena& arena = level.GetArena();
+        std::cout << "\nArena:         " << arena.GetBlockCount() << " blocks, " << arena.GetReservedBytes() << " bytes reserved, "
+                  << arena.GetUsedBytes() << " used by " << arena.GetAllocationCount() << " allocations\n";
+
+        start = Clock::now();
+        level.Clear();
+        double clearMs = TimeSince(start);
+
+        before = g_heapAllocations;
+        start = Clock::now();
+        if (!level.LoadFromFileParallel(textPath)) {
+            std::cerr << "Failed to load " << textPath << "\n";
+            return 1;
+        }
+        double parallelMs = TimeSince(start);
+        size_t parallelAllocations = g_heapAllocations - before;
+
+        std::cout << "Serial load:   " << serialMs << " ms, " << serialAllocations << " heap allocations\n";
+        std::cout << "Parallel load: " << parallelMs << " ms, " << parallelAllocations << " heap allocations\n";
+        std::cout << "Clear:         " << clearMs << " ms\n";
+        return 0;
+    }
+
+    // A full snapshot against appending editCount moved objects to the journal
+    int RunSaveBenchmark(const fs::path& textPath, size_t editCount) {
+        fs::path savePath = textPath;
+        savePath.replace_extension(".journaled.txt");
+
+        LevelData level;
+        if (!level.LoadFromFile(textPath) || level.GetObjectCount() == 0) {
+            std::cerr << "Failed to load " << textPath << "\n";
+            return 1;
+        }
+
+        auto start = Clock::now();
+        if (!level.SaveToFile(savePath)) {
+            std::cerr << "Failed to save " << savePath << "\n";
+            return 1;
+        }
+        double fullMs = TimeSince(start);
+
+        const auto& objects = level.GetObjects();
+        size_t step = objects.size() > editCount ? objects.size() / editCount : 1;
+        for (size_t i = 0; i < objects.size(); i += step) {
+            Float3 position = objects[i]->GetPosition();
+            objects[i]->SetPosition(position.x + 1.0f, position.y, position.z);
+        }
+
+        size_t edits = level.GetPendingEditCount();
+        start = Clock::now();
+        if (!level.SaveIncremental(savePath)) {
+            std::cerr << "Failed to append to the journal of " << savePath << "\n";
+            return 1;
+        }
+        double journalMs = TimeSince(start);
+
+        // Background saves: time the caller is blocked for, then until the file is in place.
+        // The first takes a full snapshot, the second only copies the objects moved since.
+        start = Clock::now();
+        std::shared_future<bool> saved = level.SaveToFileAsync(savePath);
+        double asyncCallMs = TimeSince(start);
+        bool asyncSaved = saved.get();
+        double asyncMs = TimeSince(start);
+
+        for (size_t i = 0; i < objects.size(); i += step) {
+            Float3 position = objects[i]->GetPosition();
+            objects[i]->SetPosition(position.x - 1.0f, position.y, position.z);
+        }
+        start = Clock::now();
+        saved = level.SaveToFileAsync(savePath);
+        double editedCallMs = TimeSince(start);
+        if (!asyncSaved || !saved.get()) {
+            std::cerr << "Background save of " << savePath << " failed\n";
+            return 1;
+        }
+
+        std::cout << "\nFull save:     " << fullMs << " ms\n";
+        std::cout << "Journal save:  " << journalMs << " ms (" << edits << " edits)\n";
+        std::cout << "Async save:    " << asyncCallMs << " ms blocking, " << asyncMs << " ms total\n";
+        std::cout << "Async resave:  " << editedCallMs << " ms blocking after " << edits << " edits\n";
+        return 0;
+    }
+
+    // Cost of an undo snapshot after moving editCount objects, against the first full one
+    int RunUndoBenchmark(const fs::path& textPath, size_t editCount) {
+        LevelData level;
+        if (!level.LoadFromFile(textPath) || level.GetObjectCount() == 0) {
+            std::cerr << "Failed to load " << textPath << "\n";
+            return 1;
+        }
+
+        auto start = Clock::now();
+        UndoHistory history(level);
+        double baseMs = TimeSince(start);
+
+        const auto& objects = level.GetObjects();
+        size_t step = objects.size() > editCount ? objects.size() / editCount : 1;
+        for (size_t i = 0; i < objects.size(); i += step) {
+            Float3 position = objects[i]->GetPosition();
+            objects[i]->SetPosition(position.x + 1.0f, position.y, position.z);
+        }
+
+        start = Clock::now();
+        history.Commit("Move");
+        double commitMs = TimeSince(start);
+
+        start = Clock::now();
+        history.Undo();
+        double undoMs = TimeSince(start);
+
+        std::cout << "\nFirst snapshot: " << baseMs << " ms\n";
+        std::cout << "Edit snapshot:  " << commitMs << " ms\n";
+        std::cout << "Undo:           " << undoMs << " ms\n";
+        std::cout << history.FormatMemoryReport();
+        return 0;
+    }
+
+    // Hashing the whole level against rehashing after editCount moves
+    int RunHashBenchmark(const fs::path& textPath, size_t editCount) {
+        LevelData level;
+        if (!level.LoadFromFile(textPath) || level.GetObjectCount() == 0) {
+            std::cerr << "Failed to load " << textPath << "\n";
+            return 1;
+        }
+
+        auto start = Clock::now();
+        uint64_t baseHash = level.GetContentHash();
+        double buildMs = TimeSince(start);
+
+        const auto& objects = level.GetObjects();
+        size_t step = objects.size() > editCount ? objects.size() / editCount : 1;
+        for (size_t i = 0; i < objects.size(); i += step) {
+            Float3 position = objects[i]->GetPosition();
+            objects[i]->SetPosition(position.x + 1.0f, position.y, position.z);
+        }
+
+        start = Clock::now();
+        uint64_t editedHash = level.GetContentHash();
+        double refreshMs = TimeSince(start);
+
+        start = Clock::now();
+        level.GetContentHash();
+        double unchangedMs = TimeSince(start);
+
+        std::cout << "\nContent hash:   " << level.GetContentCells().size() << " cells\n";
+        std::cout << "Full hash:      " << buildMs << " ms\n";
+        std::cout << "After edits:    " << refreshMs << " ms\n";
+        std::cout << "Unchanged:      " << unchangedMs << " ms\n";
+        return editedHash != baseHash ? 0 : 1;
+    }
+
+    // Formatting and parsing every transform vector of the level with the
+    // float codec against the stream and sscanf_s code it replaced
+    int RunNumberBenchmark(const fs::path& textPath) {
+        LevelData level;
+        if (!level.LoadFromFile(textPath) || level.GetObjectCount() == 0) {
+            std::cerr << "Failed to load " << textPath << "\n";
+            return 1;
+        }
+
+        std::vector<Float3> vectors;
+        for (const LevelObject* object : level.GetObjects()) {
+            vectors.push_back(object->GetPosition());
+            vectors.push_back(object->GetRotation());
+            vectors.push_back(object->GetScale());
+        }
+
+        auto start = Clock::now();
+        std::ostringstream streamText;
+        for (const Float3& v : vectors) {
+            streamText << v.x << "," << v.y << "," << v.z << "\n";
+        }
+        double streamFormatMs = TimeSince(start);
+
+        start = Clock::now();
+        std::ostringstream codecText;
+        for (const Float3& v : vectors) {
+            WriteFloat3(codecText, v);
+            codecText << "\n";
+        }
+        double codecFormatMs = TimeSince(start);
+
+        std::vector<std::string> lines;
+        std::string text = codecText.str();
+        for (size_t pos = 0, end; (end = text.find('\n', pos)) != std::string::npos; pos = end + 1) {
+            lines.push_back(text.substr(pos, end - pos));
+        }
+
+        start = Clock::now();
+        size_t inexact = 0;
+        for (size_t i = 0; i < lines.size(); ++i) {
+            float v[3] = {};
+            sscanf_s(lines[i].c_str(), "%f,%f,%f", &v[0], &v[1], &v[2]);
+            inexact += v[0] != vectors[i].x || v[1] != vectors[i].y || v[2] != vectors[i].z;
+        }
+        double scanMs = TimeSince(start);
+
+        start = Clock::now();
+        size_t mismatches = 0;
+        for (size_t i = 0; i < lines.size(); ++i) {
+            float v[3] = {};
+            ParseFloatList(lines[i], v, 3);
+            mismatches += v[0] != vectors[i].x || v[1] != vectors[i].y || v[2] != vectors[i].z;
+        }
+        double codecParseMs = TimeSince(start);
+
+        double megabytes = text.size() / (1024.0 * 1024.0);
+        std::cout << "\nFloat text:     " << vectors.size() << " vectors, " << text.size() << " bytes\n";
+        std::cout << "Stream format:  " << streamFormatMs << " ms\n";
+        std::cout << "Codec format:   " << codecFormatMs << " ms\n";
+        std::cout << "sscanf_s parse: " << scanMs << " ms (" << megabytes / (scanMs / 1000.0) << " MB/s)\n";
+        std::cout << "Codec parse:    " << codecParseMs << " ms (" << megabytes / (codecParseMs / 1000.0) << " MB/s)\n";
+        return mismatches == 0 && inexact == 0 ? 0 : 1;
+    }
+
+    // Single-thread codec throughput over the text file's blocks, then a
+    // compressed save and load against the plain text ones
+    int RunCompressionBenchmark(const fs::path& textPath, int iterations) {
+        std::ifstream file(textPath, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << textPath << "\n";
+            return 1;
+        }
+        std::string text(static_cast<size_t>(fs::file_size(textPath)), '\0');
+        file.read(text.data(), static_cast<std::streamsize>(text.size()));
+        text.resize(static_cast<size_t>(file.gcount()));
+
+        std::vector<std::string> blocks;
+        for (size_t pos = 0; pos < text.size(); pos += DEFAULT_COMPRESSED_BLOCK_SIZE) {
+            size_t size = std::min<size_t>(DEFAULT_COMPRESSED_BLOCK_SIZE, text.size() - pos);
+            std::string block(GetCompressBound(size), '\0');
+            block.resize(CompressBlock(text.data() + pos, size, block.data(), block.size()));
+            blocks.push_back(std::move(block));
+        }
+
+        auto start = Clock::now();
+        size_t storedBytes = 0;
+        std::string scratch(GetCompressBound(DEFAULT_COMPRESSED_BLOCK_SIZE), '\0');
+        for (int i = 0; i < iterations; ++i) {
+            storedBytes = 0;
+            for (size_t pos = 0; pos < text.size(); pos += DEFAULT_COMPRESSED_BLOCK_SIZE) {
+                size_t size = std::min<size_t>(DEFAULT_COMPRESSED_BLOCK_SIZE, text.size() - pos);
+                storedBytes += CompressBlock(text.data() + pos, size, scratch.data(), scratch.size());
+            }
+        }
+        double compressMs = TimeSince(start) / iterations;
+
+        start = Clock::now();
+        bool roundTrip = true;
+        for (int i = 0; i < iterations; ++i) {
+            for (size_t b = 0; b < blocks.size(); ++b) {
+                size_t pos = b * DEFAULT_COMPRESSED_BLOCK_SIZE;
+                size_t size = std::min<size_t>(DEFAULT_COMPRESSED_BLOCK_SIZE, text.size() - pos);
+                roundTrip &= DecompressBlock(blocks[b].data(), blocks[b].size(), scratch.data(), size)
+                    && std::memcmp(scratch.data(), text.data() + pos, size) == 0;
+            }
+        }
+        double decompressMs = TimeSince(start) / iterations;
+
+        LevelData level;
+        if (!roundTrip || !level.LoadFromFile(textPath)) {
+            std::cerr << "Compression round trip failed\n";
+            return 1;
+        }
+        fs::path savedPath = textPath;
+        savedPath.replace_extension(".saved.txt");
+        fs::path compressedPath = textPath;
+        compressedPath.replace_extension(".plz");
+
+        start = Clock::now();
+        level.SaveToFile(savedPath);
+        double textSaveMs = TimeSince(start);
+        start = Clock::now();
+        level.SaveToCompressedFile(compressedPath);
+        double compressedSaveMs = TimeSince(start);
+
+        size_t textObjects = 0;
+        size_t compressedObjects = 0;
+        double textLoadMs = TimeLoad(savedPath, iterations, textObjects);
+        double compressedLoadMs = TimeLoad(compressedPath, iterations, compressedObjects);
+        if (textLoadMs < 0.0 || compressedLoadMs < 0.0 || textObjects != compressedObjects) {
+            std::cerr << "Compressed load failed or object counts differ\n";
+            return 1;
+        }
+
+        double megabytes = text.size() / (1024.0 * 1024.0);
+        std::cout << "\nCompression:    " << storedBytes << " of " << text.size() << " bytes ("
+                  << (storedBytes ? static_cast<double>(text.size()) / storedBytes : 0.0) << "x)\n";
+        std::cout << "Compress:       " << megabytes / (compressMs / 1000.0) << " MB/s\n";
+        std::cout << "Decompress:     " << megabytes / (decompressMs / 1000.0) << " MB/s\n";
+        std::cout << "Text save:      " << textSaveMs << " ms, " << fs::file_size(savedPath) << " bytes\n";
+        std::cout << "Compressed save: " << compressedSaveMs << " ms, " << fs::file_size(compressedPath) << " bytes\n";
+        std::cout << "Text load:      " << textLoadMs << " ms\n";
+        std::cout << "Compressed load: " << compressedLoadMs << " ms\n";
+        return 0;
+    }
+
+    // Partitions the level into a 16x16x16 grid over its bounds, then compares
+    // a full load with streaming the cells around the centre, and walks the
+    // focus across the level under a budget of a quarter of the level
+    int RunStreamingBenchmark(const fs::path& textPath) {
+        fs::path streamedPath = textPath;
+        streamedPath.replace_extension(".pls");
+
+        LevelData source;
+        Float3 minBounds, maxBounds;
+        if (!source.LoadFromFile(textPath) || !source.ComputeBounds(minBounds, maxBounds)) {
+            std::cerr << "Failed to load " << textPath << "\n";
+            return 1;
+        }
+
+        float extent = std::max(std::max(maxBounds.x - minBounds.x, maxBounds.y - minBounds.y), maxBounds.z - minBounds.z);
+        float cellSize = std::max(extent / 16.0f, 1.0f);
+        if (!PartitionLevel(source, cellSize, streamedPath)) {
+            std::cerr << "Failed to partition " << textPath << "\n";
+            return 1;
+        }
+
+        auto start = Clock::now();
+        LevelData full;
+        full.LoadFromFile(textPath);
+        double fullMs = TimeSince(start);
+
+        const Float3 centre = { 0.5f * (minBounds.x + maxBounds.x), 0.5f * (minBounds.y + maxBounds.y), 0.5f * (minBounds.z + maxBounds.z) };
+        LevelData level;
+        LevelStreamer streamer(level);
+        start = Clock::now();
+        if (!streamer.Open(streamedPath)) {
+            std::cerr << "Failed to open " << streamedPath << "\n";
+            return 1;
+        }
+        streamer.SetRadii(cellSize, 1.5f * cellSize);
+        streamer.Flush(centre);
+        double firstMs = TimeSince(start);
+        size_t firstObjects = level.GetObjectCount();
+
+        // Along the diagonal, letting each step's loads finish
+        size_t totalBytes = 0;
+        for (const StreamedCellEntry& cell : streamer.GetCells()) {
+            totalBytes += static_cast<size_t>(cell.memoryEstimate);
+        }
+        streamer.SetMemoryBudget(totalBytes / 4);
+        streamer.SetRadii(3.0f * cellSize, 4.0f * cellSize);
+
+        const int steps = 64;
+        double worstStepMs = 0.0;
+        start = Clock::now();
+        for (int step = 0; step <= steps; ++step) {
+            float t = static_cast<float>(step) / steps;
+            Float3 focus = { minBounds.x + t * (maxBounds.x - minBounds.x), centre.y, minBounds.z + t * (maxBounds.z - minBounds.z) };
+            auto stepStart = Clock::now();
+            streamer.Flush(focus);
+            worstStepMs = std::max(worstStepMs, TimeSince(stepStart));
+        }
+        double walkMs = TimeSince(start);
+
+        std::cout << "\nStreaming:      " << streamer.GetCells().size() << " cells of " << cellSize << " units\n";
+        std::cout << "Full load:      " << fullMs << " ms (" << full.GetObjectCount() << " objects)\n";
+        std::cout << "First cells:    " << firstMs << " ms (" << firstObjects << " objects)\n";
+        std::cout << "Walk:           " << walkMs << " ms over " << steps << " steps, worst " << worstStepMs << " ms\n";
+        std::cout << streamer.GetStats().Format();
+        return 0;
+    }
+
+    // Spatial index over objectCount generated objects: build, queries against
+    // a scan of precomputed bounds, and small moves that update it incrementally
+    int RunSpatialBenchmark(size_t objectCount) {
+        const int queryCount = 1000;
+        const size_t moveCount = 100000;
+        // About one object per 1000 cubic units whatever the count
+        const float extent = 0.5f * std::cbrt(static_cast<float>(objectCount) * 1000.0f);
+
+        std::mt19937 random(12345);
+        std::uniform_real_distribution<float> coordinate(-extent, extent);
+        std::uniform_real_distribution<float> size(0.5f, 4.0f);
+        std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+
+        LevelData level;
+        level.Reserve(objectCount);
+        for (size_t i = 0; i < objectCount; ++i) {
+            auto object = std::make_unique<LevelObject>("Object" + std::to_string(i), ObjectType::Mesh);
+            object->SetPosition(coordinate(random), coordinate(random), coordinate(random));
+            object->SetRotation(0.0f, angle(random), 0.0f);
+            object->SetScale(size(random), size(random), size(random));
+            level.AddObject(std::move(object));
+        }
+
+        auto start = Clock::now();
+        const AabbTree& tree = level.GetSpatialIndex();
+        double buildMs = TimeSince(start);
+
+        std::vector<Float3> minBounds(objectCount);
+        std::vector<Float3> maxBounds(objectCount);
+        level.GetTransforms().ComputeObjectBounds(minBounds.data(), maxBounds.data());
+
+        std::vector<Aabb> boxes(queryCount);
+        std::vector<Float3> directions(queryCount);
+        for (int i = 0; i < queryCount; ++i) {
+            Float3 centre = { coordinate(random), coordinate(random), coordinate(random) };
+            boxes[i] = { { centre.x - 20.0f, centre.y - 20.0f, centre.z - 20.0f }, { centre.x + 20.0f, centre.y + 20.0f, centre.z + 20.0f } };
+            directions[i] = { angle(random), angle(random), angle(random) };
+        }
+
+        std::vector<LevelObject*> results;
+        size_t treeHits = 0;
+        start = Clock::now();
+        for (const Aabb& box : boxes) {
+            level.QueryBox(box, results);
+            treeHits += results.size();
+        }
+        double boxMs = TimeSince(start);
+
+        size_t scanHits = 0;
+        start = Clock::now();
+        for (const Aabb& box : boxes) {
+            for (size_t i = 0; i < objectCount; ++i) {
+                scanHits += Overlaps({ minBounds[i], maxBounds[i] }, box) ? 1 : 0;
+            }
+        }
+        double scanMs = TimeSince(start);
+
+        start = Clock::now();
+        for (const Aabb& box : boxes) {
+            Float3 centre = { 0.5f * (box.min.x + box.max.x), 0.5f * (box.min.y + box.max.y), 0.5f * (box.min.z + box.max.z) };
+            level.QuerySphere(centre, 20.0f, results);
+        }
+        double sphereMs = TimeSince(start);
+
+        size_t rayHits = 0;
+        start = Clock::now();
+        for (int i = 0; i < queryCount; ++i) {
+            Float3 origin = { boxes[i].min.x + 20.0f, boxes[i].min.y + 20.0f, boxes[i].min.z + 20.0f };
+            rayHits += level.Raycast(origin, directions[i], 2.0f * extent) ? 1 : 0;
+        }
+        double rayMs = TimeSince(start);
+
+        // Nudges stay inside the fattened leaf boxes; jumps force reinsertion
+        const auto& objects = level.GetObjects();
+        start = Clock::now();
+        for (size_t i = 0; i < moveCount; ++i) {
+            LevelObject* object = objects[random() % objectCount];
+            Float3 position = object->GetPosition();
+            object->SetPosition(position.x + 0.01f, position.y, position.z);
+        }
+        double nudgeMs = TimeSince(start);
+
+        start = Clock::now();
+        for (size_t i = 0; i < moveCount; ++i) {
+            LevelObject* object = objects[random() % objectCount];
+            object->SetPosition(coordinate(random), coordinate(random), coordinate(random));
+        }
+        double jumpMs = TimeSince(start);
+
+        std::cout << "\nSpatial index: " << objectCount << " objects, height " << tree.GetHeight()
+                  << ", " << tree.GetMemoryUsage() << " bytes\n";
+        std::cout << "Build:          " << buildMs << " ms\n";
+        std::cout << "Box queries:    " << boxMs << " ms (" << queryCount << " queries, " << treeHits << " hits)\n";
+        std::cout << "Linear scan:    " << scanMs << " ms (" << scanHits << " hits)\n";
+        std::cout << "Sphere queries: " << sphereMs << " ms\n";
+        std::cout << "Raycasts:       " << rayMs << " ms (" << rayHits << " hits)\n";
+        std::cout << "Small moves:    " << nudgeMs << " ms (" << moveCount << " updates)\n";
+        std::cout << "Large moves:    " << jumpMs << " ms (" << moveCount << " updates)\n";
+        return treeHits == scanHits ? 0 : 1;
+    }
+
+    int RunLoadBenchmark(const fs::path& textPath, int iterations) {
+        fs::path binaryPath = textPath;
+        binaryPath.replace_extension(".plb");
+
+        if (!ConvertTextLevelToBinary(textPath, binaryPath)) {
+            std::cerr << "Failed to convert " << textPath << " to the binary format\n";
+            return 1;
+        }
+
+        size_t textObjects = 0;
+        size_t binaryObjects = 0;
+        double textMs = TimeLoad(textPath, iterations, textObjects);
+        double binaryMs = TimeLoad(binaryPath, iterations, binaryObjects);
+        if (textMs < 0.0 || binaryMs < 0.0 || textObjects != binaryObjects) {
+            std::cerr << "Load failed or object counts differ\n";
+            return 1;
+        }
+
+        std::cout << "Objects:       " << textObjects << "\n";
+        std::cout << "Text size:     " << fs::file_size(textPath) << " bytes\n";
+        std::cout << "Binary size:   " << fs::file_size(binaryPath) << " bytes\n";
+        std::cout << "Text load:     " << textMs << " ms\n";
+        std::cout << "Binary load:   " << binaryMs << " ms\n";
+        std::cout << "Speedup:       " << (binaryMs > 0.0 ? textMs / binaryMs : 0.0) << "x\n";
+
+        // Property memory of the loaded level against the old per-object std::map
+        LevelData level;
+        level.LoadFromFile(binaryPath);
+        std::cout << "\n" << level.GetPropertyMemoryReport().Format();
+
+        if (RunAllocationBenchmark(textPath) != 0) {
+            return 1;
+        }
+        if (RunSaveBenchmark(textPath, 100) != 0) {
+            return 1;
+        }
+        if (RunUndoBenchmark(textPath, 100) != 0) {
+            return 1;
+        }
+        if (RunHashBenchmark(textPath, 100) != 0) {
+            return 1;
+        }
+        if (RunNumberBenchmark(textPath) != 0) {
+            return 1;
+        }
+        if (RunCompressionBenchmark(textPath, iterations) != 0) {
+            return 1;
+        }
+        if (RunStreamingBenchmark(textPath) != 0) {
+            return 1;
+        }
+        if (RunSpatialBenchmark(100000) != 0) {
+            return 1;
+        }
+        return RunSpatialBenchmark(1000000);
+    }
+
+    // One phase of the scaling suite. Rates are objects per second; peak heap
+    // is the most live operator new memory during the phase, peak working set
+    // the process's highest so far.
+    struct SuiteResult {
+        size_t objects;
+        std::string phase;
+        double ms;
+        double objectsPerSecond;
+        size_t allocations;
+        size_t peakHeapBytes;
+        size_t peakWorkingSetBytes;
+    };
+
+    size_t GetPeakWorkingSet() {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return 0;
+        }
+        return counters.PeakWorkingSetSize;
+    }
+
+    class SuitePhase {
+    public:
+        SuitePhase(std::vector<SuiteResult>& results, size_t objects, const char* phase)
+            : results_(results), objects_(objects), phase_(phase), allocations_(g_heapAllocations), start_(Clock::now()) {
+            g_peakHeapBytes = g_heapBytes.load();
+        }
+
+        ~SuitePhase() {
+            double ms = TimeSince(start_);
+            SuiteResult result;
+            result.objects = objects_;
+            result.phase = phase_;
+            result.ms = ms;
+            result.objectsPerSecond = ms > 0.0 ? objects_ / (ms / 1000.0) : 0.0;
+            result.allocations = g_heapAllocations - allocations_;
+            result.peakHeapBytes = g_peakHeapBytes;
+            result.peakWorkingSetBytes = GetPeakWorkingSet();
+            results_.push_back(result);
+        }
+
+    private:
+        std::vector<SuiteResult>& results_;
+        size_t objects_;
+        const char* phase_;
+        size_t allocations_;
+        Clock::time_point start_;
+    };
+
+    // Generate, save, load, serialize, query and compile generated levels of
+    // each size
+    bool RunSuiteSize(size_t objectCount, const fs::path& workDir, std::vector<SuiteResult>& results) {
+        fs::path levelPath = workDir / ("Suite" + std::to_string(objectCount) + ".txt");
+        fs::remove(GetJournalPath(levelPath));
+
+        LevelGeneratorOptions options;
+        options.objectCount = objectCount;
+        LevelData level;
+        {
+            SuitePhase phase(results, objectCount, "generate");
+            GenerateLevel(options, level);
+        }
+
+        bool ok = true;
+        {
+            SuitePhase phase(results, objectCount, "save");
+            ok &= level.SaveToFile(levelPath);
+        }
+        {
+            LevelData loaded;
+            SuitePhase phase(results, objectCount, "load");
+            ok &= loaded.LoadFromFile(levelPath) && loaded.GetObjectCount() == objectCount;
+        }
+        {
+            LevelData loaded;
+            SuitePhase phase(results, objectCount, "load_parallel");
+            ok &= loaded.LoadFromFileParallel(levelPath) && loaded.GetObjectCount() == objectCount;
+        }
+
+        std::string text;
+        {
+            SuitePhase phase(results, objectCount, "serialize");
+            std::ostringstream out;
+            for (const LevelObject* object : level.GetObjects()) {
+                object->Serialize(out);
+            }
+            text = out.str();
+        }
+        {
+            SuitePhase phase(results, objectCount, "deserialize");
+            std::istringstream in(text);
+            std::string line;
+            size_t count = 0;
+            while (std::getline(in, line)) {
+                if (line == "OBJECT" && LevelObject::Deserialize(in)) {
+                    ++count;
+                }
+            }
+            ok &= count == objectCount;
+        }
+        text.clear();
+        text.shrink_to_fit();
+
+        {
+            // Every object by type and by name, then a property filter over the meshes
+            SuitePhase phase(results, objectCount, "query");
+            size_t found = 0;
+            for (size_t type = 0; type < OBJECT_TYPE_COUNT; ++type) {
+                for (const LevelObject* object : level.GetObjectsByType(static_cast<ObjectType>(type))) {
+                    found += level.GetObject(object->GetName()) == object;
+                }
+            }
+            level.ForEachObjectWith(ObjectType::Mesh, "health", [](const PropertyValue& value) {
+                return value.type == PropertyType::Int && value.i > 500;
+            }, [&](const LevelObject*) {
+                ++found;
+            });
+            ok &= found >= objectCount;
+        }
+
+        {
+            fs::path engineDir = workDir / "Engine";
+            CompilerSystem compiler;
+            SuitePhase phase(results, objectCount, "compile");
+            ok &= compiler.Initialize(engineDir, engineDir, workDir / "Build") && compiler.CompileLevel(level, "SuiteGame");
+        }
+
+        fs::remove(levelPath);
+        return ok;
+    }
+
+    int RunBenchmarkSuite(const std::vector<size_t>& sizes, const fs::path& jsonPath) {
+        fs::path workDir = fs::temp_directory_path() / "LevelBenchmarkSuite";
+        fs::create_directories(workDir / "Engine");
+        {
+            // A stand-in engine tree for the compile phase to copy
+            std::ofstream engineFile(workDir / "Engine" / "Engine.h");
+            engineFile << "#pragma once\n";
+        }
+
+        std::vector<SuiteResult> results;
+        bool ok = true;
+        for (size_t objectCount : sizes) {
+            if (!RunSuiteSize(objectCount, workDir, results)) {
+                std::cerr << "Suite failed at " << objectCount << " objects\n";
+                ok = false;
+            }
+        }
+
+        std::cout << std::left << std::setw(10) << "objects" << std::setw(15) << "phase" << std::right
+                  << std::setw(12) << "ms" << std::setw(14) << "objects/s" << std::setw(12) << "allocs"
+                  << std::setw(14) << "peak heap" << std::setw(14) << "peak WS" << "\n";
+        for (const SuiteResult& result : results) {
+            std::cout << std::left << std::setw(10) << result.objects << std::setw(15) << result.phase << std::right
+                      << std::fixed << std::setprecision(2) << std::setw(12) << result.ms
+                      << std::setprecision(0) << std::setw(14) << result.objectsPerSecond
+                      << std::setw(12) << result.allocations << std::setw(14) << result.peakHeapBytes
+                      << std::setw(14) << result.peakWorkingSetBytes << "\n";
+        }
+        std::cout.unsetf(std::ios::fixed);
+
+        // One JSON object per line, for regression tracking
+        if (!jsonPath.empty()) {
+            std::ofstream json(jsonPath, std::ios::out | std::ios::trunc);
+            for (const SuiteResult& result : results) {
+                json << "{\"objects\":" << result.objects << ",\"phase\":\"" << result.phase << "\",\"ms\":" << result.ms
+                     << ",\"objects_per_second\":" << result.objectsPerSecond << ",\"allocations\":" << result.allocations
+                     << ",\"peak_heap_bytes\":" << result.peakHeapBytes << ",\"peak_working_set_bytes\":" << result.peakWorkingSetBytes
+                     << "}\n";
+            }
+            if (json.fail()) {
+                std::cerr << "Failed to write " << jsonPath << "\n";
+                ok = false;
+            }
+        }
+
+        std::error_code error;
+        fs::remove_all(workDir, error);
+        return ok ? 0 : 1;
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: LevelBenchmark <level.txt> [iterations]\n";
+        std::cerr << "       LevelBenchmark --suite [--sizes 1000,100000,1000000] [--json results.jsonl]\n";
+        return 1;
+    }
+
+    if (std::string(argv[1]) == "--suite") {
+        std::vector<size_t> sizes = { 1000, 100000, 1000000 };
+        fs::path jsonPath;
+        for (int i = 2; i + 1 < argc; i += 2) {
+            std::string option = argv[i];
+            if (option == "--sizes") {
+                sizes.clear();
+                std::istringstream list(argv[i + 1]);
+                std::string size;
+                while (std::getline(list, size, ',')) {
+                    sizes.push_back(static_cast<size_t>(std::stoull(size)));
+                }
+            }
+            else if (option == "--json") {
+                jsonPath = argv[i + 1];
+            }
+        }
+        return RunBenchmarkSuite(sizes, jsonPath);
+    }
+
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+    if (iterations < 1) {
+        iterations = 1;
+    }
+
+    return RunLoadBenchmark(argv[1], iterations);
+}
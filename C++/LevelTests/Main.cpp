@@ -0,0 +1,504 @@
+#include "LevelEditor.h"
+#include "AssetCook.h"
+#include "LevelBinary.h"
+#include "CompileCache.h"
+#include "FileSync.h"
+#include "GameBuild.h"
+#include "LevelNumbers.h"
+#include "LevelSnapshot.h"
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Regression tests for the level library. Each test works in its own
+// directory under the system temporary directory and stops at the first
+// failed check. Prints one line per test; exits with the number that failed.
+// Build tests use GetDefaultToolchain, so on Windows run from a developer
+// command prompt with cl.exe on the path.
+namespace {
+
+#define CHECK(condition)                                                                \
+    do {                                                                                \
+        if (!(condition)) {                                                             \
+            std::cerr << __FILE__ << "(" << __LINE__ << "): CHECK(" #condition ") failed\n"; \
+            return false;                                                               \
+        }                                                                               \
+    } while (false)
+
+    float GetX(LevelData& level, const char* name) {
+        return level.GetObject(name)->GetPosition().x;
+    }
+
+    bool WriteFile(const fs::path& path, const std::string& text) {
+        std::ofstream file(path, std::ios::out | std::ios::binary);
+        file << text;
+        return file.good();
+    }
+
+    // Text files carry a fresh JOURNAL_ID on every save, which is dropped
+    std::string ReadFile(const fs::path& path) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        std::ostringstream contents;
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.compare(0, 11, "JOURNAL_ID=") != 0) {
+                contents << line << "\n";
+            }
+        }
+        return contents.str();
+    }
+
+    std::unique_ptr<LevelObject> MakeObject(const char* name, const char* const* keys, size_t keyCount) {
+        auto object = std::make_unique<LevelObject>(name, ObjectType::Mesh);
+        for (size_t i = 0; i < keyCount; ++i) {
+            object->SetProperty(keys[i], std::string("value of ") + keys[i]);
+        }
+        return object;
+    }
+
+    bool SaveAll(LevelData& level, const fs::path& directory, const std::string& name) {
+        return level.SaveToFile(directory / (name + ".txt")) && level.SaveToBinaryFile(directory / (name + ".plb"))
+            && level.SaveToXmlFile(directory / (name + ".xml")) && level.SaveToCompressedFile(directory / (name + ".plz"));
+    }
+
+    uint32_t FloatBits(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    bool SameFiles(const fs::path& directory, const std::string& first, const std::string& second) {
+        for (const char* extension : { ".txt", ".plb", ".xml", ".plz" }) {
+            if (ReadFile(directory / (first + extension)) != ReadFile(directory / (second + extension))) {
+                std::cerr << first << extension << " and " << second << extension << " differ\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A background save takes a snapshot of its own; undo must not see it
+    bool TestUndoAcrossBackgroundSave(const fs::path& directory) {
+        LevelData level;
+        level.AddObject(std::make_unique<LevelObject>("x", ObjectType::Mesh));
+        UndoHistory history(level);
+
+        level.GetObject("x")->SetPosition(1, 0, 0);
+        history.Commit("x = 1");
+        level.GetObject("x")->SetPosition(2, 0, 0);
+        CHECK(level.SaveToFileAsync(directory / "level.txt").get());
+        history.Commit("x = 2");
+
+        CHECK(history.Undo() && GetX(level, "x") == 1);
+        CHECK(history.Undo() && GetX(level, "x") == 0);
+        CHECK(history.Redo() && GetX(level, "x") == 1);
+        CHECK(history.Redo() && GetX(level, "x") == 2);
+
+        // Saved but uncommitted edits are still committed by Undo
+        level.GetObject("x")->SetPosition(3, 0, 0);
+        CHECK(level.SaveToFileAsync(directory / "level.txt").get());
+        CHECK(history.Undo() && GetX(level, "x") == 2);
+        CHECK(history.Redo() && GetX(level, "x") == 3);
+        return true;
+    }
+
+    // Background saves and compiles copy the level; without an undo history
+    // each copy builds on the last, and one taken later still counts in full
+    bool TestCopiesCostOnlyChanges(const fs::path&) {
+        LevelData level;
+        for (int i = 0; i < 1000; ++i) {
+            level.AddObject(std::make_unique<LevelObject>("object" + std::to_string(i), ObjectType::Mesh));
+        }
+        LevelSnapshot first = level.CopySnapshot();
+        CHECK(first.GetAddedBytes() == first.GetTotalBytes());
+        level.GetObject("object5")->SetPosition(1, 0, 0);
+        LevelSnapshot second = level.CopySnapshot();
+        CHECK(second.GetAddedBytes() * 20 < second.GetTotalBytes());
+        CHECK(level.CopySnapshot().GetAddedBytes() == second.GetAddedBytes());
+
+        UndoHistory history(level);
+        CHECK(history.GetMemoryUsage() == second.GetTotalBytes());
+        level.GetObject("object6")->SetPosition(2, 0, 0);
+        CHECK(level.CopySnapshot().GetAddedBytes() * 20 < second.GetTotalBytes());
+        history.Commit("object6");
+        CHECK(history.GetMemoryUsage() < second.GetTotalBytes() * 11 / 10);
+        CHECK(history.Undo() && GetX(level, "object6") == 0 && GetX(level, "object5") == 1);
+        return true;
+    }
+
+    // Reloading or clearing the level while a background save of it runs
+    // waits for the save, so the load reads the finished file
+    bool TestLoadWaitsForBackgroundSave(const fs::path& directory) {
+        const char* const keys[] = { "mesh", "hp" };
+        LevelData level;
+        for (int i = 0; i < 2000; ++i) {
+            level.AddObject(MakeObject(("object" + std::to_string(i)).c_str(), keys, 2));
+        }
+        std::shared_future<bool> saved = level.SaveToFileAsync(directory / "level.txt");
+        CHECK(level.LoadFromFile(directory / "level.txt") && level.GetObjectCount() == 2000);
+        CHECK(saved.get());
+
+        saved = level.SaveToFileAsync(directory / "level.txt");
+        level.Clear();
+        CHECK(saved.wait_for(std::chrono::seconds(0)) == std::future_status::ready && saved.get());
+        return true;
+    }
+
+    // Properties are written in key text order, so the same object saves to
+    // the same bytes whichever order its level interned the keys in
+    bool TestPropertyOrderIndependentOfInterning(const fs::path& directory) {
+        const char* const keys[] = { "alpha", "mesh", "zeta" };
+        const char* const reversed[] = { "zeta", "mesh", "alpha" };
+
+        LevelData first;
+        first.AddObject(MakeObject("object", keys, 3));
+        LevelData second;
+        second.AddObject(MakeObject("interns first", reversed, 3));
+        second.AddObject(MakeObject("object", keys, 3));
+        CHECK(second.RemoveObject("interns first"));
+        CHECK(second.GetObject("object")->GetPropertyKey(0) == "zeta");
+
+        CHECK(SaveAll(first, directory, "first") && SaveAll(second, directory, "second"));
+        CHECK(SameFiles(directory, "first", "second"));
+
+        // Loading and saving again reproduces each file
+        for (const char* extension : { ".txt", ".plb", ".xml", ".plz" }) {
+            LevelData loaded;
+            CHECK(loaded.LoadFromFile(directory / (std::string("second") + extension)));
+            CHECK(SaveAll(loaded, directory, std::string("loaded") + extension));
+            CHECK(SameFiles(directory, "first", std::string("loaded") + extension));
+        }
+        return true;
+    }
+
+    // Background saves write from a snapshot; the file must match SaveToFile's
+    bool TestBackgroundSaveMatchesSave(const fs::path& directory) {
+        const char* const keys[] = { "mesh", "hp", "zeta" };
+        LevelData level;
+        for (int i = 0; i < 100; ++i) {
+            std::string name = "object" + std::to_string(i);
+            level.AddObject(MakeObject(name.c_str(), keys, i % 4));
+        }
+        level.SetSetting("GameTitle", "Order");
+        level.GetObject("object7")->SetProperty("hp", 7);
+        level.GetObject("object8")->SetPosition(1.5f, -2, 1e-3f);
+
+        // Removals move objects within the level's dense storage; re-adding reuses slots
+        for (int i = 0; i < 100; i += 9) {
+            CHECK(level.RemoveObject("object" + std::to_string(i)));
+        }
+        level.AddObject(MakeObject("object9", keys, 3));
+        level.AddObject(MakeObject("late", keys, 2));
+
+        CHECK(level.SaveToFile(directory / "saved.txt"));
+        CHECK(level.SaveToFileAsync(directory / "background.txt").get());
+        CHECK(ReadFile(directory / "saved.txt") == ReadFile(directory / "background.txt"));
+        return true;
+    }
+
+    // Loads keep the first object of a name and report the rest, which older
+    // versions of the editor could save
+    bool TestLoadReportsDuplicateNames(const fs::path& directory) {
+        LevelData level;
+        level.AddObject(std::make_unique<LevelObject>("first", ObjectType::Mesh));
+        level.AddObject(std::make_unique<LevelObject>("second", ObjectType::Light));
+        level.GetObject("second")->SetPosition(5, 0, 0);
+        CHECK(level.SaveToFile(directory / "level.txt") && level.SaveToXmlFile(directory / "level.xml"));
+
+        for (const char* extension : { ".txt", ".xml" }) {
+            fs::path path = directory / (std::string("level") + extension);
+            std::string text = ReadFile(path);
+            size_t at = text.find("second");
+            CHECK(at != std::string::npos);
+            text.replace(at, 6, "first");
+            CHECK(WriteFile(path, text));
+
+            LevelData loaded;
+            CHECK(loaded.LoadFromFile(path) && loaded.GetObjectCount() == 1 && GetX(loaded, "first") == 0);
+            CHECK(loaded.GetDroppedDuplicateNames() == std::vector<std::string>{ "first" });
+            CHECK(loaded.LoadFromFileParallel(path) && loaded.GetDroppedDuplicateNames().size() == 1);
+            loaded.Clear();
+            CHECK(loaded.GetDroppedDuplicateNames().empty());
+        }
+        return true;
+    }
+
+    // Strings stay interned for the life of a level; Clear and loads free the
+    // pool entirely, its tables included
+    bool TestClearReleasesStrings(const fs::path&) {
+        LevelData level;
+        for (int i = 0; i < 10000; ++i) {
+            auto object = std::make_unique<LevelObject>("object" + std::to_string(i), ObjectType::Mesh);
+            object->SetProperty("key" + std::to_string(i % 100), "value" + std::to_string(i));
+            level.AddObject(std::move(object));
+        }
+        CHECK(level.GetStrings().GetCount() == 10100);
+
+        size_t used = level.GetStrings().GetMemoryUsage();
+        level.Clear();
+        CHECK(level.GetStrings().GetCount() == 0);
+        CHECK(level.GetStrings().GetMemoryUsage() * 100 < used);
+        return true;
+    }
+
+    // Binary records are checked before anything reads them; an object type
+    // past the last one must fail the load, not index past the type lists
+    bool TestBinaryRejectsUnknownObjectType(const fs::path& directory) {
+        LevelData level;
+        level.AddObject(std::make_unique<LevelObject>("object", ObjectType::Light));
+        CHECK(level.SaveToBinaryFile(directory / "level.plb"));
+
+        std::ifstream in(directory / "level.plb", std::ios::in | std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        BinarySectionEntry objects;
+        std::memcpy(&objects, data.data() + sizeof(BinaryLevelHeader), sizeof(objects));
+        CHECK(objects.id == LevelSection::Objects && objects.count == 1);
+
+        size_t typeOffset = static_cast<size_t>(objects.offset) + offsetof(BinaryObjectRecord, type);
+        for (uint32_t type : { static_cast<uint32_t>(OBJECT_TYPE_COUNT), 0xFFFFFFFFu }) {
+            std::memcpy(&data[typeOffset], &type, sizeof(type));
+            CHECK(WriteFile(directory / "bad.plb", data));
+            LevelData loaded;
+            CHECK(!loaded.LoadFromFile(directory / "bad.plb"));
+        }
+        return true;
+    }
+
+    // A material naming itself, or a model through its material, would close
+    // a cycle in the cook graph; the cook must fail rather than wait forever
+    bool TestAssetReferenceCycles(const fs::path& directory) {
+        fs::path assets = directory / "assets";
+        fs::create_directories(assets);
+        CHECK(WriteFile(assets / "self.mtl", "newmtl self\nmap_Kd self.mtl\n"));
+        CHECK(WriteFile(assets / "box.obj", "mtllib box.mtl\nv 0 0 0\nv 1 0 0\nv 0 1 0\nusemtl box\nf 1 2 3\n"));
+        CHECK(WriteFile(assets / "box.mtl", "newmtl box\nmap_Kd box.obj\n"));
+
+        std::string messages;
+        BuildLogCallback log = [&](const std::string& message) { messages += message + "\n"; };
+        for (const char* reference : { "self.mtl", "box.obj" }) {
+            LevelData level;
+            auto object = std::make_unique<LevelObject>("object", ObjectType::Mesh);
+            object->SetProperty("asset", reference);
+            level.AddObject(std::move(object));
+
+            AssetCookStats stats;
+            messages.clear();
+            CHECK(!CookAssets(level, assets, directory / "cooked", 2, log, stats));
+            CHECK(stats.failed == 1 && messages.find("is not a texture") != std::string::npos);
+        }
+        return true;
+    }
+
+    // Removing the last synced file of a directory removes the directory, but
+    // never one holding files the sync did not place
+    bool TestSyncRemovesEmptyDirectories(const fs::path& directory) {
+        fs::path source = directory / "source";
+        fs::path destination = directory / "destination";
+        fs::create_directories(source / "sub" / "deep");
+        fs::create_directories(source / "kept");
+        CHECK(WriteFile(source / "sub" / "deep" / "a.txt", "a"));
+        CHECK(WriteFile(source / "sub" / "b.txt", "b"));
+        CHECK(WriteFile(source / "kept" / "c.txt", "c"));
+        CHECK(SyncDirectory(source, destination, {}).removed == 0);
+        CHECK(WriteFile(destination / "kept" / "generated.txt", "not synced"));
+
+        fs::remove_all(source / "sub");
+        fs::remove(source / "kept" / "c.txt");
+        CHECK(SyncDirectory(source, destination, {}).removed == 3);
+        CHECK(!fs::exists(destination / "sub"));
+        CHECK(fs::exists(destination / "kept" / "generated.txt") && fs::exists(destination));
+        return true;
+    }
+
+    // An object fetched from the compile cache must be newer than the sources
+    // it was built from, or every later build fetches and relinks it again
+    bool TestCachedObjectStaysUpToDate(const fs::path& directory) {
+        fs::path game = directory / "game";
+        fs::create_directories(game);
+        CompileCache cache;
+        CHECK(cache.Open(directory / "cache"));
+        BuildHooks hooks;
+        hooks.cache = &cache;
+        BuildToolchain toolchain = GetDefaultToolchain();
+        BuildLogCallback log = [](const std::string&) {};
+
+        const std::string first = "int main() { return 0; }\n";
+        const std::string second = "int main() { return 1; }\n";
+        GameBuildStats stats;
+        CHECK(WriteFile(game / "Main.cpp", first));
+        CHECK(BuildDirectory(game, "Game", toolchain, log, stats, hooks) && stats.compiled == 1);
+        CHECK(WriteFile(game / "Main.cpp", second));
+        stats = GameBuildStats();
+        CHECK(BuildDirectory(game, "Game", toolchain, log, stats, hooks) && stats.compiled == 1);
+
+        // Reverting is served from the cache, and the build after it has nothing to do
+        CHECK(WriteFile(game / "Main.cpp", first));
+        stats = GameBuildStats();
+        CHECK(BuildDirectory(game, "Game", toolchain, log, stats, hooks) && stats.cached == 1 && stats.compiled == 0);
+        stats = GameBuildStats();
+        CHECK(BuildDirectory(game, "Game", toolchain, log, stats, hooks));
+        CHECK(stats.cached == 0 && stats.compiled == 0 && stats.upToDate == 1 && !stats.linked);
+        return true;
+    }
+
+    // Formatted floats parse back to the same bits, and long decimals parse to
+    // the correctly rounded float
+    bool TestFloatTextRoundTrip(const fs::path&) {
+        std::vector<float> values = { 0.0f, -0.0f, 0.1f, -12.375f, 1.0f / 3.0f, 123456.789f, 16777216.0f, 1 + FLT_EPSILON,
+            FLT_MIN, -FLT_MIN, FLT_MIN / 3, FLT_TRUE_MIN, -FLT_TRUE_MIN, FLT_MAX, -FLT_MAX,
+            std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN() };
+        // Every 65537th bit pattern reaches each exponent, denormals included.
+        // NaN payloads are not kept by the text, so those patterns are skipped.
+        for (uint64_t bits = 0; bits <= 0xFFFFFFFFu; bits += 65537) {
+            uint32_t pattern = static_cast<uint32_t>(bits);
+            float value;
+            std::memcpy(&value, &pattern, sizeof(value));
+            if (!std::isnan(value)) {
+                values.push_back(value);
+            }
+        }
+        for (float value : values) {
+            char text[FLOAT_TEXT_MAX];
+            char* end = FormatFloat(text, value);
+            float parsed = 0;
+            CHECK(ParseFloat(std::string_view(text, end - text), parsed));
+            CHECK(FloatBits(parsed) == FloatBits(value));
+        }
+
+        const struct {
+            const char* text;
+            float value;
+        } decimals[] = {
+            { "3.14159265358979323846", 3.14159265358979323846f },
+            { "0.10000000149011611938", 0.1f },
+            { "-0.000000000012345678901234", -0.000000000012345678901234f },
+            { "16777217", 16777216.0f },
+            { "0.0000000000000000000000000000000000000000000014", FLT_TRUE_MIN },
+            { "340282346638528859811704183484516925440", FLT_MAX },
+        };
+        for (const auto& decimal : decimals) {
+            float parsed = 0;
+            CHECK(ParseFloat(decimal.text, parsed) && FloatBits(parsed) == FloatBits(decimal.value));
+        }
+        return true;
+    }
+
+    // Vectors written by hand or by older tools, which sscanf accepted
+    bool TestParseFloatListLikeSscanf(const fs::path&) {
+        float values[3] = {};
+        CHECK(ParseFloatList("1.5, 2.5,3.5", values, 3) == 3);
+        CHECK(values[0] == 1.5f && values[1] == 2.5f && values[2] == 3.5f);
+        CHECK(ParseFloatList(" +1.5,\t-2, +3e2", values, 3) == 3);
+        CHECK(values[0] == 1.5f && values[1] == -2.0f && values[2] == 300.0f);
+
+        // sscanf's literal comma does not skip whitespace, and one sign is allowed
+        CHECK(ParseFloatList("1.5 ,2.5", values, 3) == 1);
+        CHECK(ParseFloatList("1,+-2,3", values, 3) == 1);
+        CHECK(ParseFloatList("1,+ 2,3", values, 3) == 1);
+        CHECK(ParseFloatList("1,2", values, 3) == 2);
+
+        // Single values stay exact: a property value " 1.5" is text, not a float
+        float value = 0;
+        CHECK(!ParseFloat(" 1.5", value) && !ParseFloat("+1.5", value));
+        return true;
+    }
+
+    // Each compile drops the log entries already read and the runs before the
+    // last one; cursors stay valid across the drop
+    bool TestCompileLogDropsOldRuns(const fs::path&) {
+        CompileLog log;
+        size_t cursor = 0;
+        std::string text;
+        log.Append("setup\n");
+        log.BeginRun();
+        log.Append("one\n");
+        CHECK(log.ReadSince(cursor, text) && text == "setup\none\n");
+
+        // "two" is kept for the reader until it has been read
+        log.BeginRun();
+        log.Append("two\n");
+        log.BeginRun();
+        log.Append("three\n");
+        text.clear();
+        CHECK(log.ReadSince(cursor, text) && text == "two\nthree\n");
+        CHECK(log.GetText() == "three\n");
+
+        log.BeginRun();
+        log.Append("four\n");
+        size_t late = 0;
+        text.clear();
+        CHECK(log.ReadSince(late, text) && text == "four\n");
+        text.clear();
+        CHECK(log.ReadSince(cursor, text) && text == "four\n");
+
+        // Without readers, only the last run before the current one is kept
+        CompileLog unread;
+        for (const char* run : { "a\n", "b\n", "c\n" }) {
+            unread.BeginRun();
+            unread.Append(run);
+        }
+        late = 0;
+        text.clear();
+        CHECK(unread.ReadSince(late, text) && text == "b\nc\n" && late == 3);
+        return true;
+    }
+
+    struct Test {
+        const char* name;
+        bool (*run)(const fs::path& directory);
+    };
+
+    const Test TESTS[] = {
+        { "UndoAcrossBackgroundSave", TestUndoAcrossBackgroundSave },
+        { "CopiesCostOnlyChanges", TestCopiesCostOnlyChanges },
+        { "LoadWaitsForBackgroundSave", TestLoadWaitsForBackgroundSave },
+        { "PropertyOrderIndependentOfInterning", TestPropertyOrderIndependentOfInterning },
+        { "BackgroundSaveMatchesSave", TestBackgroundSaveMatchesSave },
+        { "ClearReleasesStrings", TestClearReleasesStrings },
+        { "LoadReportsDuplicateNames", TestLoadReportsDuplicateNames },
+        { "BinaryRejectsUnknownObjectType", TestBinaryRejectsUnknownObjectType },
+        { "AssetReferenceCycles", TestAssetReferenceCycles },
+        { "SyncRemovesEmptyDirectories", TestSyncRemovesEmptyDirectories },
+        { "CachedObjectStaysUpToDate", TestCachedObjectStaysUpToDate },
+        { "FloatTextRoundTrip", TestFloatTextRoundTrip },
+        { "ParseFloatListLikeSscanf", TestParseFloatListLikeSscanf },
+        { "CompileLogDropsOldRuns", TestCompileLogDropsOldRuns },
+    };
+}
+
+int main() {
+    fs::path root = fs::temp_directory_path() / "LevelTests";
+    int failed = 0;
+    for (const Test& test : TESTS) {
+        fs::path directory = root / test.name;
+        std::error_code error;
+        fs::remove_all(directory, error);
+        fs::create_directories(directory, error);
+
+        bool passed = false;
+        try {
+            passed = test.run(directory);
+        }
+        catch (const std::exception& exception) {
+            std::cerr << test.name << ": " << exception.what() << "\n";
+        }
+        std::cout << (passed ? "PASS " : "FAIL ") << test.name << "\n";
+        if (!passed) {
+            ++failed;
+        }
+        fs::remove_all(directory, error);
+    }
+    return failed;
+}